@@ -0,0 +1,498 @@
+#include "AllocTracker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <unordered_map>
+#include <unistd.h>
+
+#include "Logger.hpp"
+
+const char* const ALLOC_TRACK_ENV = "FUND_ALLOC_TRACK";
+
+namespace {
+
+enum Mode : int { UNDECIDED = -1, OFF = 0, COUNT = 1, TRACK = 2 };
+
+// 这里的全局变量都是常量初始化的，在任何动态初始化（以及其中的分配）之前就绪
+std::atomic<int> MODE{UNDECIDED};
+
+int mode()
+{
+    int current = MODE.load(std::memory_order_relaxed);
+    if (current != UNDECIDED) {
+        return current;
+    }
+    // 第一次分配发生在静态初始化期间，此时只有一个线程
+#ifdef FUND_NO_ALLOC_HOOKS
+    int decided = OFF;
+#else
+    const char* value = std::getenv(ALLOC_TRACK_ENV);
+    int decided = value && *value && std::strcmp(value, "0") != 0 ? TRACK : OFF;
+#endif
+    MODE.compare_exchange_strong(current, decided, std::memory_order_relaxed);
+    return MODE.load(std::memory_order_relaxed);
+}
+
+const char* const STAGE_NAMES[ALLOC_STAGE_COUNT] = {
+    "other", "download", "parse", "load", "grid", "report", "results", "storage"};
+
+// 每个线程一个槽，只有本线程累加（relaxed 原子操作，没有争用）；超出槽数的线程共用最后一个
+const size_t MAX_THREAD_SLOTS = 256;
+
+struct alignas(64) ThreadSlot
+{
+    std::atomic<uint64_t> allocations[ALLOC_STAGE_COUNT];
+    std::atomic<uint64_t> bytes[ALLOC_STAGE_COUNT];
+};
+
+ThreadSlot THREAD_SLOTS[MAX_THREAD_SLOTS];
+std::atomic<size_t> NEXT_THREAD_SLOT{0};
+thread_local ThreadSlot* LOCAL_SLOT = nullptr;
+thread_local uint8_t CURRENT_STAGE = 0;
+thread_local uint32_t CURRENT_FUND = 0;  // 0 表示不属于任何基金
+
+// 存活字节数跨线程增减（在一个线程分配、另一个线程释放），只能共享
+struct LiveBytes
+{
+    std::atomic<int64_t> live{0};
+    std::atomic<int64_t> peak{0};
+
+    void add(int64_t size)
+    {
+        int64_t now = live.fetch_add(size, std::memory_order_relaxed) + size;
+        int64_t high = peak.load(std::memory_order_relaxed);
+        while (now > high && !peak.compare_exchange_weak(high, now, std::memory_order_relaxed)) {
+        }
+    }
+    void sub(int64_t size) { live.fetch_sub(size, std::memory_order_relaxed); }
+};
+
+LiveBytes TOTAL_LIVE;
+LiveBytes STAGE_LIVE[ALLOC_STAGE_COUNT];
+
+struct FundCounters
+{
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> bytes{0};
+    LiveBytes live;
+};
+
+// 基金的计数按编号分块存放，块一经发布不再移动，分配路径上不加锁
+const size_t FUND_CHUNK_SIZE = 1024;
+const size_t MAX_FUND_CHUNKS = 4096;
+std::atomic<FundCounters*> FUND_CHUNKS[MAX_FUND_CHUNKS];
+
+FundCounters* fund_counters(uint32_t fund)
+{
+    FundCounters* chunk = FUND_CHUNKS[fund / FUND_CHUNK_SIZE].load(std::memory_order_acquire);
+    return chunk ? &chunk[fund % FUND_CHUNK_SIZE] : nullptr;
+}
+
+struct FundRegistry
+{
+    std::mutex mutex;
+    std::unordered_map<std::string, uint32_t> slots;
+    std::vector<std::string> names{""};
+};
+
+FundRegistry& fund_registry()
+{
+    static FundRegistry* registry = new FundRegistry();  // 不析构：退出时其他线程可能仍在分配
+    return *registry;
+}
+
+uint32_t fund_slot(const char* fund)
+{
+    FundRegistry& registry = fund_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto found = registry.slots.find(fund);
+    if (found != registry.slots.end()) {
+        return found->second;
+    }
+    uint32_t slot = static_cast<uint32_t>(registry.names.size());
+    if (slot / FUND_CHUNK_SIZE >= MAX_FUND_CHUNKS) {
+        return 0;
+    }
+    if (!FUND_CHUNKS[slot / FUND_CHUNK_SIZE].load(std::memory_order_relaxed)) {
+        FUND_CHUNKS[slot / FUND_CHUNK_SIZE].store(new FundCounters[FUND_CHUNK_SIZE], std::memory_order_release);
+    }
+    registry.names.push_back(fund);
+    registry.slots.emplace(fund, slot);
+    return slot;
+}
+
+ThreadSlot& local_slot()
+{
+    if (!LOCAL_SLOT) {
+        size_t index = NEXT_THREAD_SLOT.fetch_add(1, std::memory_order_relaxed);
+        LOCAL_SLOT = &THREAD_SLOTS[std::min(index, MAX_THREAD_SLOTS - 1)];
+    }
+    return *LOCAL_SLOT;
+}
+
+void count(size_t size, uint8_t stage)
+{
+    ThreadSlot& slot = local_slot();
+    slot.allocations[stage].fetch_add(1, std::memory_order_relaxed);
+    slot.bytes[stage].fetch_add(size, std::memory_order_relaxed);
+}
+
+// 跟踪模式下每块内存前的头；16 字节，保持 malloc 的默认对齐
+struct Header
+{
+    uint64_t size;
+    uint32_t fund;
+    uint8_t stage;
+    uint8_t unused;
+    uint16_t offset;  // 用户指针到 malloc 返回的指针的距离
+};
+static_assert(sizeof(Header) == 16, "Header must keep the default new alignment");
+
+void* allocate(size_t size, size_t alignment)
+{
+    const int current = mode();
+    if (current != TRACK) {
+        if (current == COUNT) {
+            count(size, CURRENT_STAGE);
+        }
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return std::aligned_alloc(alignment, (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment);
+        }
+        return std::malloc(size != 0 ? size : 1);
+    }
+
+    const size_t offset = std::max(alignment, sizeof(Header));
+    void* base = alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__
+        ? std::aligned_alloc(alignment, (offset + size + alignment - 1) / alignment * alignment)
+        : std::malloc(offset + size);
+    if (!base) {
+        return nullptr;
+    }
+    char* pointer = static_cast<char*>(base) + offset;
+    Header* header = reinterpret_cast<Header*>(pointer) - 1;
+    header->size = size;
+    header->fund = CURRENT_FUND;
+    header->stage = CURRENT_STAGE;
+    header->unused = 0;
+    header->offset = static_cast<uint16_t>(offset);
+
+    count(size, header->stage);
+    TOTAL_LIVE.add(static_cast<int64_t>(size));
+    STAGE_LIVE[header->stage].add(static_cast<int64_t>(size));
+    if (FundCounters* fund = header->fund != 0 ? fund_counters(header->fund) : nullptr) {
+        fund->allocations.fetch_add(1, std::memory_order_relaxed);
+        fund->bytes.fetch_add(size, std::memory_order_relaxed);
+        fund->live.add(static_cast<int64_t>(size));
+    }
+    return pointer;
+}
+
+// 定义 FUND_NO_ALLOC_HOOKS 时不替换 operator new，这两个函数没有调用者
+[[maybe_unused]] void deallocate(void* pointer)
+{
+    if (!pointer) {
+        return;
+    }
+    if (mode() != TRACK) {
+        std::free(pointer);
+        return;
+    }
+    const Header* header = static_cast<const Header*>(pointer) - 1;
+    const int64_t size = static_cast<int64_t>(header->size);
+    TOTAL_LIVE.sub(size);
+    STAGE_LIVE[header->stage].sub(size);
+    if (FundCounters* fund = header->fund != 0 ? fund_counters(header->fund) : nullptr) {
+        fund->live.sub(size);
+    }
+    std::free(static_cast<char*>(pointer) - header->offset);
+}
+
+[[maybe_unused]] void* allocate_or_throw(size_t size, size_t alignment)
+{
+    while (true) {
+        if (void* pointer = allocate(size, alignment)) {
+            return pointer;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+struct Row
+{
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    int64_t peak = 0;
+    int64_t live = 0;
+
+    void add(const Row& other)
+    {
+        allocations += other.allocations;
+        bytes += other.bytes;
+        // 各进程的峰值之和，是同时达到峰值时的上界
+        peak += other.peak;
+        live += other.live;
+    }
+};
+
+struct Report
+{
+    Row total;
+    std::array<Row, ALLOC_STAGE_COUNT> stages;
+    std::map<std::string, Row> funds;
+};
+
+bool merge_file(const std::string& path, Report& report)
+{
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        for (std::string field; std::getline(stream, field, '\t');) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 6 || fields[0] == "kind") {
+            continue;
+        }
+        Row row{std::stoull(fields[2]), std::stoull(fields[3]), std::stoll(fields[4]), std::stoll(fields[5])};
+        if (fields[0] == "total") {
+            report.total.add(row);
+        } else if (fields[0] == "fund") {
+            report.funds[fields[1]].add(row);
+        } else if (fields[0] == "stage") {
+            for (size_t stage = 0; stage < ALLOC_STAGE_COUNT; ++stage) {
+                if (fields[1] == STAGE_NAMES[stage]) {
+                    report.stages[stage].add(row);
+                }
+            }
+        }
+    }
+    in.close();
+    std::remove(path.c_str());
+    return true;
+}
+
+double megabytes(double bytes)
+{
+    return bytes / (1024 * 1024);
+}
+
+void print_summary(const Report& report)
+{
+    fprintf(stderr, "Allocations by stage (C++ operator new; peak = most bytes alive at once):\n");
+    fprintf(stderr, "%-10s %14s %12s %14s %14s\n", "stage", "allocations", "MB", "peak live MB", "live at end MB");
+    auto print_row = [](const char* name, const Row& row) {
+        fprintf(stderr, "%-10s %14llu %12.1f %14.1f %14.1f\n", name, static_cast<unsigned long long>(row.allocations),
+            megabytes(static_cast<double>(row.bytes)), megabytes(static_cast<double>(row.peak)),
+            megabytes(static_cast<double>(row.live)));
+    };
+    for (size_t stage = 0; stage < ALLOC_STAGE_COUNT; ++stage) {
+        if (report.stages[stage].allocations > 0) {
+            print_row(STAGE_NAMES[stage], report.stages[stage]);
+        }
+    }
+    print_row("total", report.total);
+
+    std::vector<std::pair<std::string, Row>> funds(report.funds.begin(), report.funds.end());
+    const size_t shown = std::min<size_t>(funds.size(), 10);
+    std::partial_sort(funds.begin(), funds.begin() + shown, funds.end(),
+        [](const auto& a, const auto& b) { return a.second.peak > b.second.peak; });
+    if (shown > 0) {
+        fprintf(stderr, "Funds with the highest peak live bytes:\n");
+        for (size_t i = 0; i < shown; ++i) {
+            print_row(funds[i].first.c_str(), funds[i].second);
+        }
+    }
+}
+
+}  // namespace
+
+#ifndef FUND_NO_ALLOC_HOOKS
+void* operator new(size_t size) { return allocate_or_throw(size, 0); }
+void* operator new[](size_t size) { return allocate_or_throw(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocate_or_throw(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocate_or_throw(size, static_cast<size_t>(alignment)); }
+// 不内联：否则编译器看到 new 表达式的指针交给 free 会误报不匹配
+__attribute__((noinline)) void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+void operator delete(void* p, std::align_val_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { operator delete(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { operator delete(p); }
+#endif
+
+const char* alloc_stage_name(AllocStage stage)
+{
+    return STAGE_NAMES[static_cast<size_t>(stage)];
+}
+
+bool AllocTracker::tracking()
+{
+    return mode() == TRACK;
+}
+
+bool AllocTracker::counting()
+{
+    return mode() != OFF;
+}
+
+void AllocTracker::count_totals()
+{
+#ifndef FUND_NO_ALLOC_HOOKS
+    int expected = mode();
+    if (expected == OFF) {
+        MODE.compare_exchange_strong(expected, COUNT, std::memory_order_relaxed);
+    }
+#endif
+}
+
+bool AllocTracker::restart_with_tracking(char* argv[])
+{
+    if (setenv(ALLOC_TRACK_ENV, "1", 1) != 0) {
+        return false;
+    }
+    execv("/proc/self/exe", argv);
+    return false;
+}
+
+uint64_t AllocTracker::allocations()
+{
+    uint64_t total = 0;
+    for (const ThreadSlot& slot : THREAD_SLOTS) {
+        for (const auto& value : slot.allocations) {
+            total += value.load(std::memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+uint64_t AllocTracker::allocated_bytes()
+{
+    uint64_t total = 0;
+    for (const ThreadSlot& slot : THREAD_SLOTS) {
+        for (const auto& value : slot.bytes) {
+            total += value.load(std::memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+int64_t AllocTracker::live_bytes()
+{
+    return TOTAL_LIVE.live.load(std::memory_order_relaxed);
+}
+
+int64_t AllocTracker::peak_live_bytes()
+{
+    return TOTAL_LIVE.peak.load(std::memory_order_relaxed);
+}
+
+void AllocTracker::reset_peak()
+{
+    TOTAL_LIVE.peak.store(TOTAL_LIVE.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void AllocTracker::set_thread_stage(AllocStage stage)
+{
+    CURRENT_STAGE = static_cast<uint8_t>(stage);
+}
+
+bool AllocTracker::write(const std::string& path, const std::vector<std::string>& merge_files)
+{
+    Report report;
+    bool merged = false;
+    for (const auto& merge_file_path : merge_files) {
+        merged = merge_file(merge_file_path, report) || merged;
+    }
+    if (!tracking() && !merged) {
+        return true;
+    }
+    if (tracking()) {
+        Row total{0, 0, TOTAL_LIVE.peak.load(std::memory_order_relaxed), TOTAL_LIVE.live.load(std::memory_order_relaxed)};
+        for (size_t stage = 0; stage < ALLOC_STAGE_COUNT; ++stage) {
+            Row row{0, 0, STAGE_LIVE[stage].peak.load(std::memory_order_relaxed),
+                STAGE_LIVE[stage].live.load(std::memory_order_relaxed)};
+            for (const ThreadSlot& slot : THREAD_SLOTS) {
+                row.allocations += slot.allocations[stage].load(std::memory_order_relaxed);
+                row.bytes += slot.bytes[stage].load(std::memory_order_relaxed);
+            }
+            total.allocations += row.allocations;
+            total.bytes += row.bytes;
+            report.stages[stage].add(row);
+        }
+        report.total.add(total);
+        FundRegistry& registry = fund_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (uint32_t slot = 1; slot < registry.names.size(); ++slot) {
+            const FundCounters* counters = fund_counters(slot);
+            report.funds[registry.names[slot]].add({counters->allocations.load(std::memory_order_relaxed),
+                counters->bytes.load(std::memory_order_relaxed), counters->live.peak.load(std::memory_order_relaxed),
+                counters->live.live.load(std::memory_order_relaxed)});
+        }
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        LOG_ERROR("无法创建分配统计文件: %s", path.c_str());
+        return false;
+    }
+    std::fprintf(file, "kind\tname\tallocations\tbytes\tpeak_live_bytes\tlive_bytes\n");
+    auto write_row = [file](const char* kind, const std::string& name, const Row& row) {
+        std::fprintf(file, "%s\t%s\t%llu\t%llu\t%lld\t%lld\n", kind, name.c_str(),
+            static_cast<unsigned long long>(row.allocations), static_cast<unsigned long long>(row.bytes),
+            static_cast<long long>(row.peak), static_cast<long long>(row.live));
+    };
+    write_row("total", "*", report.total);
+    for (size_t stage = 0; stage < ALLOC_STAGE_COUNT; ++stage) {
+        write_row("stage", STAGE_NAMES[stage], report.stages[stage]);
+    }
+    for (const auto& [fund, row] : report.funds) {
+        write_row("fund", fund, row);
+    }
+    if (std::fclose(file) != 0) {
+        LOG_ERROR("写入分配统计文件失败: %s", path.c_str());
+        return false;
+    }
+    print_summary(report);
+    LOG_INFO("Wrote allocation statistics of %zu funds to %s", report.funds.size(), path.c_str());
+    return true;
+}
+
+AllocScope::AllocScope(AllocStage stage, const char* fund)
+    : active_(mode() != OFF), previous_stage_(CURRENT_STAGE), previous_fund_(CURRENT_FUND)
+{
+    if (!active_) {
+        return;
+    }
+    CURRENT_STAGE = static_cast<uint8_t>(stage);
+    // 没有给出基金时沿用外层的基金
+    if (fund && mode() == TRACK) {
+        CURRENT_FUND = fund_slot(fund);
+    }
+}
+
+AllocScope::~AllocScope()
+{
+    if (active_) {
+        CURRENT_STAGE = previous_stage_;
+        CURRENT_FUND = previous_fund_;
+    }
+}
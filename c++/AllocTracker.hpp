@@ -0,0 +1,66 @@
+#ifndef FUND_ALLOCTRACKER_HPP_
+#define FUND_ALLOCTRACKER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 分配统计：替换全局 operator new/delete，按线程当前的阶段标记（以及基金）累计分配次数、字节数和存活字节的峰值。
+// 只统计 C++ 的分配，curl、SQLite 等 C 库内部的 malloc 不计入。三种模式：
+//   关闭    默认，new/delete 只比 malloc/free 多一次 relaxed 读
+//   计数    count_totals() 打开，各线程按阶段累计次数和字节数（基准测试使用）
+//   跟踪    进程启动时环境变量 FUND_ALLOC_TRACK=1 打开，每块内存前加 16 字节的头记录大小、阶段和基金，
+//           释放时从分配时的阶段和基金中扣除，因此能得到存活字节和峰值。模式在第一次分配时确定，之后不能再改
+// 阶段标记是线程局部的：AllocScope 在作用域内设置，线程的默认阶段用 set_thread_stage 设置
+// 编译时定义 FUND_NO_ALLOC_HOOKS 则不替换 operator new，始终处于关闭模式（嵌入其他进程的引擎库使用）
+
+enum class AllocStage : uint8_t { OTHER, DOWNLOAD, PARSE, LOAD, GRID, REPORT, RESULTS, STORAGE };
+const size_t ALLOC_STAGE_COUNT = 8;
+const char* alloc_stage_name(AllocStage stage);
+
+// 跟踪模式的环境变量
+extern const char* const ALLOC_TRACK_ENV;
+
+class AllocTracker
+{
+public:
+    static bool tracking();
+    static bool counting();
+    static void count_totals();
+
+    // 跟踪模式必须在第一次分配之前确定：设置环境变量后以相同参数重新执行本程序，成功时不返回
+    static bool restart_with_tracking(char* argv[]);
+
+    // 所有阶段的累计值；没有在计数或跟踪时为 0
+    static uint64_t allocations();
+    static uint64_t allocated_bytes();
+    // 跟踪模式下当前存活的字节数及其峰值；reset_peak 把峰值重置为当前值
+    static int64_t live_bytes();
+    static int64_t peak_live_bytes();
+    static void reset_peak();
+
+    static void set_thread_stage(AllocStage stage);
+
+    // 把各阶段和各基金的统计写成制表符分隔的文件，并把各阶段和存活峰值最高的基金输出到标准错误。
+    // merge_files 是分片工作进程写出的同格式文件，并入后删除
+    static bool write(const std::string& path, const std::vector<std::string>& merge_files = {});
+};
+
+// 作用域内的分配记在 stage（和 fund）上，结束时恢复外层的标记
+class AllocScope
+{
+public:
+    explicit AllocScope(AllocStage stage, const char* fund = nullptr);
+    ~AllocScope();
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+    bool active_;
+    uint8_t previous_stage_;
+    uint32_t previous_fund_;
+};
+
+#endif  // FUND_ALLOCTRACKER_HPP_
@@ -0,0 +1,479 @@
+#include "BacktestService.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <ctime>
+#include <nlohmann/json.hpp>
+
+#include "Downsample.hpp"
+#include "Logger.hpp"
+#include "ReportWriter.hpp"
+#include "ResultCache.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+const size_t MAX_FUND_CODE_LENGTH = 15;
+const size_t MAX_CURVE_WIDTH = 10000;
+const size_t MAX_FAILED_DOWNLOADS = 4096;
+
+HttpReply json_reply(int status, std::string body)
+{
+    HttpReply reply;
+    reply.status = status;
+    reply.body = std::move(body);
+    // 页面与服务不同源，允许跨域读取
+    reply.headers.emplace_back("Access-Control-Allow-Origin", "*");
+    reply.headers.emplace_back("Access-Control-Expose-Headers", "X-Backtest-Cache");
+    return reply;
+}
+
+HttpReply error_reply(int status, const std::string& message)
+{
+    return json_reply(status, json{{"error", message}}.dump());
+}
+
+HttpReply result_reply(const std::string& body, const char* cache)
+{
+    HttpReply reply = json_reply(200, body);
+    reply.headers.emplace_back("X-Backtest-Cache", cache);
+    return reply;
+}
+
+// 参数可以是数字，也可以是数字字符串（查询串中的值都是字符串）；没有给出时保留原值
+bool read_number(const json& input, const char* name, double& value)
+{
+    auto found = input.find(name);
+    if (found == input.end()) {
+        return true;
+    }
+    if (found->is_number()) {
+        value = found->get<double>();
+        return true;
+    }
+    if (!found->is_string()) {
+        return false;
+    }
+    const std::string& text = found->get_ref<const std::string&>();
+    try {
+        size_t used = 0;
+        value = std::stod(text, &used);
+        return used == text.size();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool read_text(const json& input, const char* name, std::string& value)
+{
+    auto found = input.find(name);
+    if (found == input.end()) {
+        return true;
+    }
+    if (found->is_string()) {
+        value = found->get<std::string>();
+    } else if (found->is_number_integer()) {
+        value = std::to_string(found->get<long long>());
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool read_flag(const json& input, const char* name, bool& value)
+{
+    auto found = input.find(name);
+    if (found == input.end()) {
+        return true;
+    }
+    if (found->is_boolean()) {
+        value = found->get<bool>();
+        return true;
+    }
+    double number = 0;
+    std::string text = found->is_string() ? found->get<std::string>() : "";
+    if (text == "true" || text == "false") {
+        value = text == "true";
+        return true;
+    }
+    if (!read_number(input, name, number)) {
+        return false;
+    }
+    value = number != 0;
+    return true;
+}
+
+bool all_digits(const std::string& text)
+{
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c); });
+}
+
+const char* grid_name(int grid_type)
+{
+    return grid_type == OperationRecord::BIG_GRID ? "big" : "small";
+}
+
+const char* status_name(int status)
+{
+    switch (status) {
+        case OperationRecord::SOLD: return "sold";
+        case OperationRecord::NOT_ENOUGH_MONEY: return "not_enough_money";
+        default: return "open";
+    }
+}
+
+}  // namespace
+
+BacktestService::BacktestService(ThreadPool& pool, SeriesLoader loader, Options options)
+    : pool_(pool), loader_(std::move(loader)), options_(std::move(options))
+{
+}
+
+void BacktestService::preload(const std::vector<SnapshotSeries>& series)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& item : series) {
+        Series& resident = series_[item.fund_code];
+        resident.data = item.data;
+        resident.updated_at = item.updated_at;
+    }
+}
+
+void BacktestService::handle(const HttpRequest& request, HttpServer::Responder respond)
+{
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    if (request.method == "OPTIONS") {
+        HttpReply reply = json_reply(204, "");
+        reply.headers.emplace_back("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
+        reply.headers.emplace_back("Access-Control-Allow-Headers", "Content-Type");
+        respond(std::move(reply));
+        return;
+    }
+    if (request.path == "/status") {
+        respond(status());
+        return;
+    }
+    if (request.path != "/backtest") {
+        respond(error_reply(404, "unknown path " + request.path));
+        return;
+    }
+    if (request.method != "GET" && request.method != "POST") {
+        respond(error_reply(405, "use GET or POST"));
+        return;
+    }
+    Query query;
+    std::string error;
+    if (!parse_request(request, query, error)) {
+        respond(error_reply(400, error));
+        return;
+    }
+    LOG_DEBUG("backtest %s period %s", query.fund_code.c_str(), query.period.c_str());
+    with_series(query.fund_code, [this, query, respond](std::shared_ptr<const FundData> fund_data) {
+        if (!fund_data || fund_data->empty()) {
+            respond(error_reply(404, "no price data for fund " + query.fund_code));
+            return;
+        }
+        backtest(query, std::move(fund_data), respond);
+    });
+}
+
+bool BacktestService::parse_request(const HttpRequest& request, Query& query, std::string& error) const
+{
+    json input = json::object();
+    if (request.method == "POST" && !request.body.empty()) {
+        input = json::parse(request.body, nullptr, false);
+        if (input.is_discarded() || !input.is_object()) {
+            error = "request body must be a JSON object";
+            return false;
+        }
+    }
+    // 查询串中的参数与 JSON 中的同名参数等价，JSON 优先
+    for (const auto& [name, value] : ::parse_query(request.query)) {
+        if (!input.contains(name)) {
+            input[name] = value;
+        }
+    }
+
+    query.period = options_.default_period;
+    query.parameters = options_.defaults;
+    ResultParameters& parameters = query.parameters;
+    double factor = parameters.factor;
+    double width = 0;
+    if (!read_text(input, "fund_code", query.fund_code) || !read_text(input, "period", query.period)
+        || !read_number(input, "grid_size", parameters.grid_size)
+        || !read_number(input, "big_grid_size", parameters.big_grid_size)
+        || !read_number(input, "factor", factor)
+        || !read_number(input, "sum", parameters.sum)
+        || !read_number(input, "amount", parameters.amount)
+        || !read_number(input, "threshold_low", parameters.threshold_low)
+        || !read_number(input, "threshold_high", parameters.threshold_high)
+        || !read_flag(input, "trades", query.trades)
+        || !read_number(input, "width", width) || !read_text(input, "curve", query.curve)) {
+        error = "parameters must be numbers";
+        return false;
+    }
+    // 阈值在配置中是 float，取同样的精度，与批量运行的结果和缓存键一致
+    parameters.threshold_low = static_cast<float>(parameters.threshold_low);
+    parameters.threshold_high = static_cast<float>(parameters.threshold_high);
+    parameters.factor = static_cast<int>(factor);
+    query.width = width >= 0 && width <= MAX_CURVE_WIDTH ? static_cast<size_t>(width) : 0;
+
+    if (query.fund_code.size() > MAX_FUND_CODE_LENGTH || !std::all_of(query.fund_code.begin(), query.fund_code.end(),
+            [](unsigned char c) { return std::isalnum(c); }) || query.fund_code.empty()) {
+        error = "fund_code must be 1-15 letters or digits";
+    } else if (!all_digits(query.period) || query.period.size() > 1 || std::stoi(query.period) > CUSTOMIZED_TIME) {
+        error = "period must be 0-6";
+    } else if (!(parameters.grid_size > 0 && parameters.grid_size < 1) || !(parameters.big_grid_size > 0)) {
+        error = "grid_size must be in (0, 1) and big_grid_size positive";
+    } else if (parameters.factor < 1 || factor != parameters.factor) {
+        error = "factor must be a positive integer";
+    } else if (!(parameters.amount > 0) || !(parameters.sum >= 0)) {
+        error = "amount must be positive and sum non-negative";
+    } else if (!(parameters.threshold_low >= 0 && parameters.threshold_low <= parameters.threshold_high
+            && parameters.threshold_high <= 1)) {
+        error = "thresholds must satisfy 0 <= threshold_low <= threshold_high <= 1";
+    } else if (!(width >= 0 && width <= MAX_CURVE_WIDTH) || width != query.width) {
+        error = "width must be an integer pixel count up to " + std::to_string(MAX_CURVE_WIDTH);
+    } else if (query.curve != "m4" && query.curve != "lttb") {
+        error = "curve must be m4 or lttb";
+    }
+    return error.empty();
+}
+
+void BacktestService::with_series(const std::string& fund_code,
+    std::function<void(std::shared_ptr<const FundData>)> continuation)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    // 最近下载失败的代码直接回复没有数据，不为客户端随意给出的代码反复下载
+    auto failed = failed_downloads_.find(fund_code);
+    if (failed != failed_downloads_.end()) {
+        if (std::time(nullptr) - failed->second < options_.refresh_seconds) {
+            lock.unlock();
+            continuation(nullptr);
+            return;
+        }
+        failed_downloads_.erase(failed);
+    }
+    Series& series = series_[fund_code];
+    if (series.data && std::time(nullptr) - series.updated_at < options_.refresh_seconds) {
+        std::shared_ptr<const FundData> data = series.data;
+        lock.unlock();
+        continuation(std::move(data));
+        return;
+    }
+    series.waiters.push_back(std::move(continuation));
+    if (series.loading) {
+        return;
+    }
+    series.loading = true;
+    lock.unlock();
+
+    loader_(fund_code, [this, fund_code](std::shared_ptr<const FundData> data) {
+        std::vector<std::function<void(std::shared_ptr<const FundData>)>> waiters;
+        std::shared_ptr<const FundData> resident;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            auto found = series_.find(fund_code);
+            Series& series = found->second;
+            series.loading = false;
+            if (data && !data->empty()) {
+                series.data = std::move(data);
+            } else if (series.data) {
+                LOG_WARN("%s: download failed, serving the resident series", fund_code.c_str());
+            }
+            // 下载失败时同样记下时间，之后的请求不会每次都重新下载
+            series.updated_at = std::time(nullptr);
+            resident = series.data;
+            waiters.swap(series.waiters);
+            if (!resident) {
+                series_.erase(found);
+                remember_failed_download(fund_code);
+            }
+        }
+        for (auto& waiter : waiters) {
+            waiter(resident);
+        }
+    });
+}
+
+// 失败记录过多时先清掉过期的，仍然过多时全部清掉（最坏只是重新下载一次）
+void BacktestService::remember_failed_download(const std::string& fund_code)
+{
+    const long now = std::time(nullptr);
+    if (failed_downloads_.size() >= MAX_FAILED_DOWNLOADS) {
+        std::erase_if(failed_downloads_, [this, now](const auto& item) {
+            return now - item.second >= options_.refresh_seconds;
+        });
+        if (failed_downloads_.size() >= MAX_FAILED_DOWNLOADS) {
+            failed_downloads_.clear();
+        }
+    }
+    failed_downloads_[fund_code] = now;
+}
+
+void BacktestService::backtest(const Query& query, std::shared_ptr<const FundData> fund_data,
+    HttpServer::Responder respond)
+{
+    size_t start = get_start_date(*fund_data, query.period);
+    size_t end = get_end_date(*fund_data, query.period);
+    if (end <= start) {
+        respond(error_reply(422, "no prices in period " + query.period + " for fund " + query.fund_code));
+        return;
+    }
+    long long key = result_cache_key(query.fund_code, query.period, *fund_data, start, end, query.parameters, query.trades);
+    if (query.width > 0) {
+        key = static_cast<long long>(ContentHasher().add(static_cast<uint64_t>(key))
+            .add(static_cast<uint64_t>(query.width)).add(query.curve).value());
+    }
+    std::shared_ptr<const std::string> cached;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = recent_index_.find(key);
+        if (found != recent_index_.end()) {
+            recent_.splice(recent_.begin(), recent_, found->second);
+            cached = found->second->body;
+        } else {
+            auto& waiting = in_flight_[key];
+            waiting.push_back(std::move(respond));
+            if (waiting.size() > 1) {
+                coalesced_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+    if (cached) {
+        cache_hits_.fetch_add(1, std::memory_order_relaxed);
+        respond(result_reply(*cached, "hit"));
+        return;
+    }
+
+    pool_.post([this, query, fund_data, start, end, key]() {
+        std::shared_ptr<const std::string> body;
+        std::string error;
+        try {
+            std::vector<double> equity;
+            GridOutcome outcome = run_grid(query.fund_code, *fund_data, start, end, query.parameters,
+                query.width > 0 ? &equity : nullptr);
+            body = std::make_shared<const std::string>(render(query, *fund_data, outcome, equity));
+            computed_.fetch_add(1, std::memory_order_relaxed);
+        } catch (const std::exception& e) {
+            LOG_ERROR("backtest %s period %s failed: %s", query.fund_code.c_str(), query.period.c_str(), e.what());
+            error = e.what();
+        }
+        std::vector<HttpServer::Responder> waiting;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            waiting.swap(in_flight_[key]);
+            in_flight_.erase(key);
+            if (body && options_.cache_entries > 0) {
+                recent_.push_front({key, body});
+                recent_index_[key] = recent_.begin();
+                if (recent_.size() > options_.cache_entries) {
+                    recent_index_.erase(recent_.back().key);
+                    recent_.pop_back();
+                }
+            }
+        }
+        for (size_t i = 0; i < waiting.size(); ++i) {
+            waiting[i](body ? result_reply(*body, i == 0 ? "miss" : "coalesced") : error_reply(500, error));
+        }
+    });
+}
+
+std::string BacktestService::render(const Query& query, const FundData& fund_data, const GridOutcome& outcome,
+    const std::vector<double>& equity) const
+{
+    const ResultParameters& parameters = query.parameters;
+    std::vector<OperationRecord> records = operation_records(outcome, parameters);
+    size_t sold = 0, open = 0, not_enough_money = 0;
+    for (const auto& record : records) {
+        sold += record.status == OperationRecord::SOLD;
+        open += record.status == OperationRecord::OPEN;
+        not_enough_money += record.status == OperationRecord::NOT_ENOUGH_MONEY;
+    }
+    RangeStats stats = fund_data.range_stats(outcome.start, outcome.end);
+
+    json body;
+    body["fund_code"] = query.fund_code;
+    body["period"] = query.period;
+    body["start_date"] = format_day(day_index(fund_data.timestamp(outcome.start)));
+    body["end_date"] = format_day(day_index(fund_data.timestamp(outcome.end - 1)));
+    body["engine_version"] = ENGINE_VERSION;
+    body["parameters"] = {
+        {"grid_size", parameters.grid_size}, {"big_grid_size", parameters.big_grid_size},
+        {"factor", parameters.factor}, {"sum", parameters.sum}, {"amount", parameters.amount},
+        {"threshold_low", parameters.threshold_low}, {"threshold_high", parameters.threshold_high},
+    };
+    body["summary"] = {
+        {"total_value", outcome.total_value()}, {"balance", outcome.balance},
+        {"holdings_value", outcome.holdings_value()}, {"holdings", outcome.holdings},
+        {"latest_price", outcome.latest_price}, {"profit", outcome.total_profit},
+        {"touched_lowest_balance", outcome.touched_lowest_balance},
+        {"percentile_high_price", outcome.thresholds.percentile_high},
+        {"percentile_low_price", outcome.thresholds.percentile_low},
+        {"trade_count", records.size()}, {"sold", sold}, {"open", open}, {"not_enough_money", not_enough_money},
+    };
+    body["stats"] = {
+        {"days", stats.days}, {"min_price", stats.min_price}, {"max_price", stats.max_price},
+        {"mean_price", stats.mean_price}, {"stdev_price", stats.stdev_price},
+        {"volatility", stats.volatility}, {"buy_and_hold_return", stats.buy_and_hold_return},
+    };
+    if (query.trades) {
+        json trades = json::array();
+        for (const auto& record : records) {
+            trades.push_back({
+                {"buy_date", format_day(record.buy_day)}, {"buy_price", record.buy_price},
+                {"sell_date", record.status == OperationRecord::SOLD ? json(format_day(record.sell_day)) : json(nullptr)},
+                {"sell_price", record.sell_price}, {"lot_size", record.lot_size},
+                {"grid", grid_name(record.grid_type)}, {"status", status_name(record.status)},
+            });
+        }
+        body["trades"] = std::move(trades);
+    }
+    if (query.width > 0) {
+        // 曲线直接取常驻序列的列，时间用自 1970-01-01 起的天数
+        const size_t count = outcome.end - outcome.start;
+        std::span<const long> timestamps = fund_data.timestamps().subspan(outcome.start, count);
+        std::span<const double> prices = fund_data.prices().subspan(outcome.start, count);
+        std::vector<size_t> markers = trade_points(fund_data, outcome);
+        auto curve = [&](std::span<const double> values, double scale) {
+            std::vector<size_t> points = query.curve == "lttb"
+                ? downsample_lttb(timestamps, values, query.width, markers)
+                : downsample_m4(timestamps, values, query.width, markers);
+            json days = json::array(), selected = json::array();
+            for (size_t i : points) {
+                days.push_back(day_index(timestamps[i]));
+                selected.push_back(std::round(values[i] * scale) / scale);
+            }
+            return json{{"day", std::move(days)}, {"value", std::move(selected)}};
+        };
+        body["curves"] = {
+            {"mode", query.curve}, {"width", query.width}, {"source_points", count},
+            {"price", curve(prices, 1e4)},
+            {"equity", curve(equity, 1e2)},
+        };
+    }
+    return body.dump();
+}
+
+HttpReply BacktestService::status()
+{
+    size_t resident = 0;
+    size_t cached = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [code, series] : series_) {
+            resident += series.data != nullptr;
+        }
+        cached = recent_.size();
+    }
+    json body = {
+        {"resident_series", resident}, {"cached_results", cached},
+        {"requests", requests_.load()}, {"cache_hits", cache_hits_.load()},
+        {"coalesced", coalesced_.load()}, {"computed", computed_.load()},
+        {"engine_version", ENGINE_VERSION},
+    };
+    return json_reply(200, body.dump());
+}
@@ -0,0 +1,106 @@
+#ifndef FUND_BACKTESTSERVICE_HPP_
+#define FUND_BACKTESTSERVICE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FundData.hpp"
+#include "GridEngine.hpp"
+#include "HttpServer.hpp"
+#include "ThreadPool.hpp"
+#include "UniverseSnapshot.hpp"
+
+// 回测服务：净值序列常驻内存，按请求用 run_grid 计算并返回汇总和交易明细。
+//   GET  /backtest?fund_code=512760&period=5&grid_size=0.05...
+//   POST /backtest  {"fund_code": "512760", "period": "5", "grid_size": 0.05, ...}
+//   GET  /status
+// width 大于 0 时同时返回按这个像素宽度降采样的净值曲线和总资产曲线，交易日的点总是保留。
+// 未给出的参数取配置中的值。相同的请求（序列内容、区间和参数都相同）正在计算时合并为一次，
+// 最近的结果按 LRU 缓存；同一基金同时只下载一次
+class BacktestService
+{
+public:
+    // 下载一个基金的序列，完成后在任意线程调用 done，失败时传入空序列
+    using SeriesLoader = std::function<void(const std::string& fund_code,
+        std::function<void(std::shared_ptr<const FundData>)> done)>;
+
+    struct Options
+    {
+        ResultParameters defaults;   // 请求中没有给出的网格参数
+        std::string default_period;
+        size_t cache_entries = 1024; // 缓存的结果个数
+        long refresh_seconds = 3600; // 常驻的序列超过这么久未更新时，下一个请求重新下载
+    };
+
+    BacktestService(ThreadPool& pool, SeriesLoader loader, Options options);
+
+    BacktestService(const BacktestService&) = delete;
+    BacktestService& operator=(const BacktestService&) = delete;
+
+    // 启动时常驻的序列，updated_at 用于判断是否需要重新下载
+    void preload(const std::vector<SnapshotSeries>& series);
+
+    // HttpServer 的处理函数
+    void handle(const HttpRequest& request, HttpServer::Responder respond);
+
+private:
+    struct Query
+    {
+        std::string fund_code;
+        std::string period;
+        ResultParameters parameters;
+        bool trades = true;
+        size_t width = 0;           // 曲线降采样到的像素宽度，0 表示不返回曲线
+        std::string curve = "m4";   // m4 / lttb
+    };
+
+    struct Series
+    {
+        std::shared_ptr<const FundData> data;
+        long updated_at = 0;
+        bool loading = false;
+        std::vector<std::function<void(std::shared_ptr<const FundData>)>> waiters;
+    };
+
+    struct CacheEntry
+    {
+        long long key;
+        std::shared_ptr<const std::string> body;
+    };
+
+    bool parse_request(const HttpRequest& request, Query& query, std::string& error) const;
+    // 取常驻序列，需要时下载；continuation 可能在当前线程或下载完成的线程中调用
+    void with_series(const std::string& fund_code, std::function<void(std::shared_ptr<const FundData>)> continuation);
+    void remember_failed_download(const std::string& fund_code);
+    void backtest(const Query& query, std::shared_ptr<const FundData> fund_data, HttpServer::Responder respond);
+    std::string render(const Query& query, const FundData& fund_data, const GridOutcome& outcome,
+        const std::vector<double>& equity) const;
+    HttpReply status();
+
+    ThreadPool& pool_;
+    SeriesLoader loader_;
+    Options options_;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, Series> series_;
+    // 下载失败且没有常驻序列的基金及失败时间，refresh_seconds 内不再下载
+    std::unordered_map<std::string, long> failed_downloads_;
+    // 最近使用的结果在队首
+    std::list<CacheEntry> recent_;
+    std::unordered_map<long long, std::list<CacheEntry>::iterator> recent_index_;
+    std::unordered_map<long long, std::vector<HttpServer::Responder>> in_flight_;
+
+    std::atomic<size_t> requests_{0};
+    std::atomic<size_t> cache_hits_{0};
+    std::atomic<size_t> coalesced_{0};
+    std::atomic<size_t> computed_{0};
+};
+
+#endif  // FUND_BACKTESTSERVICE_HPP_
@@ -0,0 +1,424 @@
+#include "ColumnStore.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Logger.hpp"
+
+namespace {
+
+const char FILE_MAGIC[8] = {'F', 'U', 'N', 'D', 'C', 'O', 'L', '1'};
+const uint32_t CHUNK_MAGIC = 0x4b4e4843;  // "CHNK"
+
+const ColumnSpec RESULT_COLUMNS[RESULT_COLUMN_COUNT] = {
+    {"run_id", ColumnType::INT32},
+    {"fund_code", ColumnType::INT32},
+    {"period", ColumnType::INT32},
+    {"grid_size", ColumnType::FLOAT64},
+    {"big_grid_size", ColumnType::FLOAT64},
+    {"factor", ColumnType::INT32},
+    {"sum", ColumnType::FLOAT64},
+    {"amount", ColumnType::FLOAT64},
+    {"threshold_low", ColumnType::FLOAT64},
+    {"threshold_high", ColumnType::FLOAT64},
+    {"total_value", ColumnType::FLOAT64},
+    {"balance", ColumnType::FLOAT64},
+    {"holdings_value", ColumnType::FLOAT64},
+    {"profit", ColumnType::FLOAT64},
+    {"loss", ColumnType::FLOAT64},
+    {"percentile_70_price", ColumnType::FLOAT64},
+    {"percentile_30_price", ColumnType::FLOAT64},
+};
+
+size_t padded(size_t bytes)
+{
+    return (bytes + 7) & ~size_t(7);
+}
+
+void encode_delta_varint(const std::vector<int32_t>& values, std::string& out)
+{
+    int64_t previous = 0;
+    for (int32_t value : values) {
+        int64_t delta = value - previous;
+        previous = value;
+        uint64_t zigzag = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+        while (zigzag >= 0x80) {
+            out.push_back(static_cast<char>(zigzag | 0x80));
+            zigzag >>= 7;
+        }
+        out.push_back(static_cast<char>(zigzag));
+    }
+}
+
+bool decode_delta_varint(const uint8_t* data, size_t bytes, size_t rows, std::vector<int32_t>& out)
+{
+    out.resize(rows);
+    const uint8_t* end = data + bytes;
+    int64_t previous = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        uint64_t zigzag = 0;
+        for (int shift = 0;; shift += 7) {
+            if (data == end || shift > 63) {
+                return false;
+            }
+            uint8_t byte = *data++;
+            zigzag |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        previous += static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+        out[i] = static_cast<int32_t>(previous);
+    }
+    return true;
+}
+
+// 相邻结果的数值接近时，异或后高位字节为零，只保存低位的有效字节
+void encode_xor_bytes(const std::vector<double>& values, std::string& out)
+{
+    uint64_t previous = 0;
+    for (double value : values) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint64_t x = bits ^ previous;
+        previous = bits;
+        int significant = x == 0 ? 0 : 8 - __builtin_clzll(x) / 8;
+        out.push_back(static_cast<char>(significant));
+        for (int i = 0; i < significant; ++i) {
+            out.push_back(static_cast<char>(x >> (8 * i)));
+        }
+    }
+}
+
+bool decode_xor_bytes(const uint8_t* data, size_t bytes, size_t rows, std::vector<double>& out)
+{
+    out.resize(rows);
+    const uint8_t* end = data + bytes;
+    uint64_t previous = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        if (data == end || *data > 8 || end - data <= *data) {
+            return false;
+        }
+        int significant = *data++;
+        uint64_t x = 0;
+        for (int b = 0; b < significant; ++b) {
+            x |= static_cast<uint64_t>(*data++) << (8 * b);
+        }
+        previous ^= x;
+        std::memcpy(&out[i], &previous, sizeof(previous));
+    }
+    return true;
+}
+
+// 打开用于追加的文件：新文件先写文件头，已有文件先截掉末尾不完整的块
+std::FILE* open_for_append(const std::string& path)
+{
+    struct stat info;
+    bool exists = ::stat(path.c_str(), &info) == 0 && info.st_size > 0;
+    if (exists) {
+        size_t valid;
+        {
+            ColumnFile existing;
+            if (!existing.open(path)) {
+                return nullptr;
+            }
+            valid = sizeof(FileHeader) + existing.chunk_bytes();
+        }
+        if (valid < static_cast<size_t>(info.st_size)) {
+            LOG_WARN("列式文件 %s 末尾有不完整的块，截断 %zu 字节", path.c_str(),
+                static_cast<size_t>(info.st_size) - valid);
+            if (::truncate(path.c_str(), static_cast<off_t>(valid)) != 0) {
+                LOG_ERROR("无法截断列式文件: %s", path.c_str());
+                return nullptr;
+            }
+        }
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "ab");
+    if (!file) {
+        LOG_ERROR("无法打开列式文件: %s", path.c_str());
+        return nullptr;
+    }
+    if (!exists) {
+        FileHeader header;
+        std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+        header.version = COLUMN_FILE_VERSION;
+        header.column_count = RESULT_COLUMN_COUNT;
+        if (std::fwrite(&header, sizeof(header), 1, file) != 1 || std::fflush(file) != 0) {
+            LOG_ERROR("写入列式文件头失败: %s", path.c_str());
+            std::fclose(file);
+            return nullptr;
+        }
+    }
+    return file;
+}
+
+// 基金代码和周期按整数存储，不是纯数字（或超出 int32）时无法表示，抛出异常由写线程记录后跳过这条结果
+int32_t integer_key(const std::string& text, const char* column)
+{
+    int32_t value = 0;
+    const char* end = text.data() + text.size();
+    auto [ptr, error] = std::from_chars(text.data(), end, value);
+    if (error != std::errc() || ptr != end || text.empty()) {
+        throw std::runtime_error(std::string("列式文件只能存储数字 ") + column + ": " + text);
+    }
+    return value;
+}
+
+}  // namespace
+
+const ColumnSpec& result_column(int column)
+{
+    return RESULT_COLUMNS[column];
+}
+
+int find_result_column(const std::string& name)
+{
+    for (int column = 0; column < RESULT_COLUMN_COUNT; ++column) {
+        if (name == RESULT_COLUMNS[column].name) {
+            return column;
+        }
+    }
+    return -1;
+}
+
+ColumnarSink::ColumnarSink(const std::string& path, size_t chunk_rows, bool compress)
+    : path_(path), chunkRows_(chunk_rows > 0 ? chunk_rows : 1), compress_(compress),
+      ints_(RESULT_COLUMN_COUNT), doubles_(RESULT_COLUMN_COUNT)
+{
+    file_ = open_for_append(path);
+    if (!file_) {
+        throw std::runtime_error("无法打开列式文件: " + path);
+    }
+}
+
+ColumnarSink::~ColumnarSink()
+{
+    try {
+        writeChunk();
+    } catch (const std::exception& e) {
+        LOG_ERROR("%s", e.what());
+    }
+    std::fclose(file_);
+}
+
+void ColumnarSink::insert(const FundResult& result)
+{
+    auto put = [this](int column, double value) {
+        if (RESULT_COLUMNS[column].type == ColumnType::INT32) {
+            ints_[column].push_back(static_cast<int32_t>(value));
+        } else {
+            doubles_[column].push_back(value);
+        }
+    };
+    // 先检查再写入，出错时不留下半行
+    int32_t fund_code = integer_key(result.fund_code, "fund_code");
+    int32_t period = integer_key(result.period, "period");
+    put(COL_RUN_ID, result.operation_id);
+    put(COL_FUND_CODE, fund_code);
+    put(COL_PERIOD, period);
+    put(COL_GRID_SIZE, result.parameters.grid_size);
+    put(COL_BIG_GRID_SIZE, result.parameters.big_grid_size);
+    put(COL_FACTOR, result.parameters.factor);
+    put(COL_SUM, result.parameters.sum);
+    put(COL_AMOUNT, result.parameters.amount);
+    put(COL_THRESHOLD_LOW, result.parameters.threshold_low);
+    put(COL_THRESHOLD_HIGH, result.parameters.threshold_high);
+    put(COL_TOTAL_VALUE, result.total_value);
+    put(COL_BALANCE, result.balance);
+    put(COL_HOLDINGS_VALUE, result.holdings_value);
+    put(COL_PROFIT, result.profit);
+    put(COL_LOSS, result.loss);
+    put(COL_PERCENTILE_70_PRICE, result.percentile_70_price);
+    put(COL_PERCENTILE_30_PRICE, result.percentile_30_price);
+
+    if (++rows_ >= chunkRows_) {
+        writeChunk();
+    }
+}
+
+void ColumnarSink::writeChunk()
+{
+    if (rows_ == 0) {
+        return;
+    }
+    std::string out;
+    ChunkHeader chunk = {CHUNK_MAGIC, static_cast<uint32_t>(rows_), RESULT_COLUMN_COUNT, 0};
+    out.append(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+
+    std::string payload;
+    for (int column = 0; column < RESULT_COLUMN_COUNT; ++column) {
+        ColumnHeader header = {};
+        header.type = RESULT_COLUMNS[column].type;
+        payload.clear();
+        if (header.type == ColumnType::INT32) {
+            auto& values = ints_[column];
+            auto [low, high] = std::minmax_element(values.begin(), values.end());
+            header.min = *low;
+            header.max = *high;
+            header.encoding = compress_ ? ColumnEncoding::DELTA_VARINT : ColumnEncoding::PLAIN;
+            if (compress_) {
+                encode_delta_varint(values, payload);
+            } else {
+                payload.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(int32_t));
+            }
+            values.clear();
+        } else {
+            auto& values = doubles_[column];
+            auto [low, high] = std::minmax_element(values.begin(), values.end());
+            header.min = *low;
+            header.max = *high;
+            header.encoding = compress_ ? ColumnEncoding::XOR_BYTES : ColumnEncoding::PLAIN;
+            if (compress_) {
+                encode_xor_bytes(values, payload);
+            } else {
+                payload.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+            }
+            values.clear();
+        }
+        header.bytes = payload.size();
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.append(payload);
+        out.append(padded(payload.size()) - payload.size(), '\0');
+    }
+    rows_ = 0;
+
+    if (std::fwrite(out.data(), 1, out.size(), file_) != out.size() || std::fflush(file_) != 0) {
+        throw std::runtime_error("写入列式文件失败: " + path_);
+    }
+}
+
+ColumnFile::~ColumnFile()
+{
+    if (data_) {
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+bool ColumnFile::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("无法打开列式文件: %s", path.c_str());
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+        LOG_ERROR("列式文件为空或无法读取: %s", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        LOG_ERROR("无法映射列式文件: %s", path.c_str());
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(mapped);
+
+    const auto* header = reinterpret_cast<const FileHeader*>(data_);
+    if (std::memcmp(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0
+        || header->version != COLUMN_FILE_VERSION || header->column_count != RESULT_COLUMN_COUNT) {
+        LOG_ERROR("不是当前版本的列式结果文件: %s", path.c_str());
+        return false;
+    }
+
+    size_t offset = sizeof(FileHeader);
+    end_ = offset;
+    while (offset + sizeof(ChunkHeader) <= size_) {
+        const auto* chunk_header = reinterpret_cast<const ChunkHeader*>(data_ + offset);
+        if (chunk_header->magic != CHUNK_MAGIC || chunk_header->column_count != RESULT_COLUMN_COUNT) {
+            break;
+        }
+        Chunk chunk;
+        chunk.rows = chunk_header->rows;
+        size_t position = offset + sizeof(ChunkHeader);
+        bool complete = true;
+        for (int column = 0; column < RESULT_COLUMN_COUNT; ++column) {
+            const auto* column_header = reinterpret_cast<const ColumnHeader*>(data_ + position);
+            if (position + sizeof(ColumnHeader) > size_ || column_header->type != RESULT_COLUMNS[column].type
+                || column_header->bytes > size_ - position - sizeof(ColumnHeader)) {
+                complete = false;
+                break;
+            }
+            chunk.columns.push_back(column_header);
+            position += sizeof(ColumnHeader) + padded(column_header->bytes);
+        }
+        if (!complete || position > size_) {
+            break;
+        }
+        rows_ += chunk.rows;
+        chunks_.push_back(std::move(chunk));
+        offset = end_ = position;
+    }
+    if (end_ != size_) {
+        LOG_WARN("列式文件 %s 末尾有 %zu 字节无法解析，已忽略", path.c_str(), size_ - end_);
+    }
+    return true;
+}
+
+const int32_t* ColumnFile::ints(size_t chunk, int column, std::vector<int32_t>& scratch) const
+{
+    const ColumnHeader* header = chunks_[chunk].columns[column];
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(header + 1);
+    if (header->encoding == ColumnEncoding::PLAIN) {
+        return reinterpret_cast<const int32_t*>(data);
+    }
+    if (!decode_delta_varint(data, header->bytes, chunks_[chunk].rows, scratch)) {
+        throw std::runtime_error(std::string("列数据损坏: ") + RESULT_COLUMNS[column].name);
+    }
+    return scratch.data();
+}
+
+const double* ColumnFile::doubles(size_t chunk, int column, std::vector<double>& scratch) const
+{
+    const ColumnHeader* header = chunks_[chunk].columns[column];
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(header + 1);
+    if (header->encoding == ColumnEncoding::PLAIN) {
+        return reinterpret_cast<const double*>(data);
+    }
+    if (!decode_xor_bytes(data, header->bytes, chunks_[chunk].rows, scratch)) {
+        throw std::runtime_error(std::string("列数据损坏: ") + RESULT_COLUMNS[column].name);
+    }
+    return scratch.data();
+}
+
+void ColumnFile::values(size_t chunk, int column, std::vector<double>& out) const
+{
+    size_t rows = chunks_[chunk].rows;
+    if (RESULT_COLUMNS[column].type == ColumnType::FLOAT64) {
+        const double* data = doubles(chunk, column, out);
+        if (data != out.data()) {
+            out.assign(data, data + rows);
+        }
+        return;
+    }
+    std::vector<int32_t> scratch;
+    const int32_t* data = ints(chunk, column, scratch);
+    out.assign(data, data + rows);
+}
+
+bool append_column_file(const std::string& target, const std::string& source)
+{
+    ColumnFile input;
+    if (!input.open(source)) {
+        return false;
+    }
+    std::FILE* file = open_for_append(target);
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fwrite(input.chunk_data(), 1, input.chunk_bytes(), file) == input.chunk_bytes();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        LOG_ERROR("合并列式文件 %s 到 %s 失败", source.c_str(), target.c_str());
+    }
+    return ok;
+}
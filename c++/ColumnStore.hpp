@@ -0,0 +1,160 @@
+#ifndef FUND_COLUMNSTORE_HPP_
+#define FUND_COLUMNSTORE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "CppSQLite/ResultSink.hpp"
+
+// 列式结果文件，用于参数扫描产生的大量结果行。
+// 文件头为 FileHeader，之后是若干个块，每块是 ChunkHeader 加上每列一个 ColumnHeader 和数据；
+// 所有结构和数据都按 8 字节对齐，未压缩的列可以直接在映射的内存上读取。
+// 块只追加不修改，多个文件去掉文件头拼接起来仍是合法的文件。
+
+enum class ColumnType : uint8_t { INT32 = 0, FLOAT64 = 1 };
+
+enum class ColumnEncoding : uint8_t {
+    PLAIN = 0,
+    DELTA_VARINT = 1,  // INT32：与前一个值的差做 zigzag 后按 LEB128 变长编码
+    XOR_BYTES = 2,     // FLOAT64：与前一个值按位异或，记录有效字节数和低位有效字节
+};
+
+// 结果文件中的列，顺序即文件中的列顺序；增删列时要提高 COLUMN_FILE_VERSION
+enum ResultColumn {
+    COL_RUN_ID,
+    COL_FUND_CODE,
+    COL_PERIOD,
+    COL_GRID_SIZE,
+    COL_BIG_GRID_SIZE,
+    COL_FACTOR,
+    COL_SUM,
+    COL_AMOUNT,
+    COL_THRESHOLD_LOW,
+    COL_THRESHOLD_HIGH,
+    COL_TOTAL_VALUE,
+    COL_BALANCE,
+    COL_HOLDINGS_VALUE,
+    COL_PROFIT,
+    COL_LOSS,
+    COL_PERCENTILE_70_PRICE,
+    COL_PERCENTILE_30_PRICE,
+    RESULT_COLUMN_COUNT
+};
+
+struct ColumnSpec
+{
+    const char* name;
+    ColumnType type;
+};
+
+const ColumnSpec& result_column(int column);
+// 按列名查找，找不到时返回 -1
+int find_result_column(const std::string& name);
+
+const uint32_t COLUMN_FILE_VERSION = 1;
+
+struct FileHeader
+{
+    char magic[8];        // "FUNDCOL1"
+    uint32_t version;
+    uint32_t column_count;
+};
+
+struct ChunkHeader
+{
+    uint32_t magic;       // "CHNK"
+    uint32_t rows;
+    uint32_t column_count;
+    uint32_t reserved;
+};
+
+struct ColumnHeader
+{
+    ColumnType type;
+    ColumnEncoding encoding;
+    uint16_t reserved;
+    uint32_t reserved2;
+    uint64_t bytes;       // 数据长度，不含对齐填充
+    double min;           // 块内统计，查询时用来跳过整块
+    double max;
+};
+
+// 把结果按列缓存，攒满 chunk_rows 行写出一个块，不足一块的行在析构时写出。
+// 打开已有文件时在末尾追加，崩溃留下的不完整块会先被截掉
+class ColumnarSink : public ResultSink
+{
+public:
+    ColumnarSink(const std::string& path, size_t chunk_rows = 65536, bool compress = true);
+    ~ColumnarSink() override;
+
+    ColumnarSink(const ColumnarSink&) = delete;
+    ColumnarSink& operator=(const ColumnarSink&) = delete;
+
+    void insert(const FundResult& result) override;
+
+    // 块是写出的最小单位，不在事务边界落盘
+    void beginTransaction() override {}
+    void commitTransaction() override {}
+    void rollbackTransaction() override {}
+
+private:
+    void writeChunk();
+
+    std::FILE* file_ = nullptr;
+    std::string path_;
+    size_t chunkRows_;
+    bool compress_;
+    size_t rows_ = 0;
+    std::vector<std::vector<int32_t>> ints_;
+    std::vector<std::vector<double>> doubles_;
+};
+
+// 只读打开列式文件（mmap），按块访问各列
+class ColumnFile
+{
+public:
+    ColumnFile() = default;
+    ~ColumnFile();
+
+    ColumnFile(const ColumnFile&) = delete;
+    ColumnFile& operator=(const ColumnFile&) = delete;
+
+    bool open(const std::string& path);
+
+    size_t chunk_count() const { return chunks_.size(); }
+    size_t rows() const { return rows_; }
+    size_t chunk_rows(size_t chunk) const { return chunks_[chunk].rows; }
+    double chunk_min(size_t chunk, int column) const { return chunks_[chunk].columns[column]->min; }
+    double chunk_max(size_t chunk, int column) const { return chunks_[chunk].columns[column]->max; }
+
+    // 块中一列的值：未压缩时直接指向映射的内存，否则解码到 scratch
+    const int32_t* ints(size_t chunk, int column, std::vector<int32_t>& scratch) const;
+    const double* doubles(size_t chunk, int column, std::vector<double>& scratch) const;
+    // 任意类型的列统一读成 double
+    void values(size_t chunk, int column, std::vector<double>& out) const;
+
+    // 文件头之后所有块的原始字节，用于合并
+    const uint8_t* chunk_data() const { return data_ + sizeof(FileHeader); }
+    size_t chunk_bytes() const { return end_ - sizeof(FileHeader); }
+
+private:
+    struct Chunk
+    {
+        size_t rows;
+        std::vector<const ColumnHeader*> columns;
+    };
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t end_ = 0;  // 最后一个完整块的结尾
+    size_t rows_ = 0;
+    std::vector<Chunk> chunks_;
+};
+
+// 把 source 中的块追加到 target（不存在时创建）
+bool append_column_file(const std::string& target, const std::string& source);
+
+#endif  // FUND_COLUMNSTORE_HPP_
@@ -289,6 +289,7 @@ void CppSQLite3Binary::clear()
 
 CppSQLite3Query::CppSQLite3Query()
 {
+	mpDB = 0;
 	mpVM = 0;
 	mbEof = true;
 	mnCols = 0;
@@ -296,11 +297,12 @@ CppSQLite3Query::CppSQLite3Query()
 }
 
 
-CppSQLite3Query::CppSQLite3Query(const CppSQLite3Query& rQuery)
+CppSQLite3Query::CppSQLite3Query(CppSQLite3Query&& rQuery) noexcept
 {
+	mpDB = rQuery.mpDB;
 	mpVM = rQuery.mpVM;
 	// Only one object can own the VM
-	const_cast<CppSQLite3Query&>(rQuery).mpVM = 0;
+	rQuery.mpVM = 0;
 	mbEof = rQuery.mbEof;
 	mnCols = rQuery.mnCols;
 	mbOwnVM = rQuery.mbOwnVM;
@@ -332,8 +334,12 @@ CppSQLite3Query::~CppSQLite3Query()
 }
 
 
-CppSQLite3Query& CppSQLite3Query::operator=(const CppSQLite3Query& rQuery)
+CppSQLite3Query& CppSQLite3Query::operator=(CppSQLite3Query&& rQuery) noexcept
 {
+	if (this == &rQuery)
+	{
+		return *this;
+	}
 	try
 	{
 		finalize();
@@ -341,9 +347,10 @@ CppSQLite3Query& CppSQLite3Query::operator=(const CppSQLite3Query& rQuery)
 	catch (...)
 	{
 	}
+	mpDB = rQuery.mpDB;
 	mpVM = rQuery.mpVM;
 	// Only one object can own the VM
-	const_cast<CppSQLite3Query&>(rQuery).mpVM = 0;
+	rQuery.mpVM = 0;
 	mbEof = rQuery.mbEof;
 	mnCols = rQuery.mnCols;
 	mbOwnVM = rQuery.mbOwnVM;
@@ -624,6 +631,118 @@ void CppSQLite3Query::checkVM()
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+
+CppSQLite3ColumnReader::CppSQLite3ColumnReader(CppSQLite3Query& rQuery) :
+	mQuery(rQuery)
+{
+}
+
+
+void CppSQLite3ColumnReader::add(const char* szField, Target eTarget, void* pTarget, int nCapacity)
+{
+	Binding binding;
+	binding.nCol = mQuery.fieldIndex(szField);
+	binding.eTarget = eTarget;
+	binding.pTarget = pTarget;
+	binding.nCapacity = nCapacity;
+	mBindings.push_back(binding);
+}
+
+
+void CppSQLite3ColumnReader::bind(const char* szField, std::vector<int>& column)
+{
+	add(szField, INT_VECTOR, &column, 0);
+}
+
+
+void CppSQLite3ColumnReader::bind(const char* szField, std::vector<sqlite_int64>& column)
+{
+	add(szField, INT64_VECTOR, &column, 0);
+}
+
+
+void CppSQLite3ColumnReader::bind(const char* szField, std::vector<double>& column)
+{
+	add(szField, DOUBLE_VECTOR, &column, 0);
+}
+
+
+void CppSQLite3ColumnReader::bind(const char* szField, std::vector<std::string>& column)
+{
+	add(szField, STRING_VECTOR, &column, 0);
+}
+
+
+void CppSQLite3ColumnReader::bind(const char* szField, int* pBuffer, int nCapacity)
+{
+	add(szField, INT_BUFFER, pBuffer, nCapacity);
+}
+
+
+void CppSQLite3ColumnReader::bind(const char* szField, sqlite_int64* pBuffer, int nCapacity)
+{
+	add(szField, INT64_BUFFER, pBuffer, nCapacity);
+}
+
+
+void CppSQLite3ColumnReader::bind(const char* szField, double* pBuffer, int nCapacity)
+{
+	add(szField, DOUBLE_BUFFER, pBuffer, nCapacity);
+}
+
+
+int CppSQLite3ColumnReader::read(int nRows/*=-1*/)
+{
+	for (const Binding& binding : mBindings)
+	{
+		if (binding.nCapacity > 0 && (nRows < 0 || nRows > binding.nCapacity))
+		{
+			nRows = binding.nCapacity;
+		}
+	}
+
+	int nRead = 0;
+	while ((nRows < 0 || nRead < nRows) && !mQuery.eof())
+	{
+		sqlite3_stmt* pVM = mQuery.mpVM;
+		for (const Binding& binding : mBindings)
+		{
+			switch (binding.eTarget)
+			{
+			case INT_VECTOR:
+				static_cast<std::vector<int>*>(binding.pTarget)->push_back(sqlite3_column_int(pVM, binding.nCol));
+				break;
+			case INT64_VECTOR:
+				static_cast<std::vector<sqlite_int64>*>(binding.pTarget)->push_back(sqlite3_column_int64(pVM, binding.nCol));
+				break;
+			case DOUBLE_VECTOR:
+				static_cast<std::vector<double>*>(binding.pTarget)->push_back(sqlite3_column_double(pVM, binding.nCol));
+				break;
+			case STRING_VECTOR:
+			{
+				const char* szValue = (const char*)sqlite3_column_text(pVM, binding.nCol);
+				static_cast<std::vector<std::string>*>(binding.pTarget)->emplace_back(szValue ? szValue : "");
+				break;
+			}
+			case INT_BUFFER:
+				static_cast<int*>(binding.pTarget)[nRead] = sqlite3_column_int(pVM, binding.nCol);
+				break;
+			case INT64_BUFFER:
+				static_cast<sqlite_int64*>(binding.pTarget)[nRead] = sqlite3_column_int64(pVM, binding.nCol);
+				break;
+			case DOUBLE_BUFFER:
+				static_cast<double*>(binding.pTarget)[nRead] = sqlite3_column_double(pVM, binding.nCol);
+				break;
+			}
+		}
+		mQuery.nextRow();
+		nRead++;
+	}
+	return nRead;
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 
 CppSQLite3Table::CppSQLite3Table()
@@ -881,6 +1000,112 @@ void CppSQLite3Table::checkResults()
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+
+CppSQLite3StatementCache::CppSQLite3StatementCache(sqlite3* pDB, size_t nCapacity)
+{
+	mpDB = pDB;
+	mnCapacity = nCapacity;
+	mnHits = 0;
+	mnMisses = 0;
+}
+
+
+CppSQLite3StatementCache::~CppSQLite3StatementCache()
+{
+	close();
+}
+
+
+sqlite3_stmt* CppSQLite3StatementCache::checkout(const char* szSQL)
+{
+	if (!mpDB)
+	{
+		return 0;
+	}
+
+	auto it = mIndex.find(std::string_view(szSQL));
+	if (it == mIndex.end())
+	{
+		// Remember the SQL so the VM compiled for this miss has a slot to return to
+		mEntries.push_front(Entry{szSQL, 0});
+		mIndex.emplace(std::string_view(mEntries.front().sql), mEntries.begin());
+		evict();
+		mnMisses++;
+		return 0;
+	}
+
+	mEntries.splice(mEntries.begin(), mEntries, it->second);
+	sqlite3_stmt* pVM = it->second->pVM;
+	it->second->pVM = 0;
+	if (!pVM)
+	{
+		// Already checked out
+		mnMisses++;
+		return 0;
+	}
+	sqlite3_reset(pVM);
+	sqlite3_clear_bindings(pVM);
+	mnHits++;
+	return pVM;
+}
+
+
+void CppSQLite3StatementCache::checkin(sqlite3_stmt* pVM)
+{
+	// Reset straight away so a half-read query does not hold its read transaction
+	sqlite3_reset(pVM);
+
+	if (mpDB)
+	{
+		auto it = mIndex.find(std::string_view(sqlite3_sql(pVM)));
+		if (it != mIndex.end() && !it->second->pVM)
+		{
+			it->second->pVM = pVM;
+			return;
+		}
+	}
+	sqlite3_finalize(pVM);
+}
+
+
+void CppSQLite3StatementCache::setCapacity(size_t nCapacity)
+{
+	mnCapacity = nCapacity;
+	evict();
+}
+
+
+void CppSQLite3StatementCache::close()
+{
+	for (Entry& entry : mEntries)
+	{
+		if (entry.pVM)
+		{
+			sqlite3_finalize(entry.pVM);
+		}
+	}
+	mIndex.clear();
+	mEntries.clear();
+	mpDB = 0;
+}
+
+
+void CppSQLite3StatementCache::evict()
+{
+	while (mEntries.size() > mnCapacity)
+	{
+		Entry& entry = mEntries.back();
+		if (entry.pVM)
+		{
+			sqlite3_finalize(entry.pVM);
+		}
+		mIndex.erase(std::string_view(entry.sql));
+		mEntries.pop_back();
+	}
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 
 CppSQLite3Statement::CppSQLite3Statement()
@@ -890,44 +1115,65 @@ CppSQLite3Statement::CppSQLite3Statement()
 }
 
 
-CppSQLite3Statement::CppSQLite3Statement(const CppSQLite3Statement& rStatement)
+CppSQLite3Statement::CppSQLite3Statement(CppSQLite3Statement&& rStatement) noexcept
 {
 	mpDB = rStatement.mpDB;
 	mpVM = rStatement.mpVM;
+	mpCache = std::move(rStatement.mpCache);
 	// Only one object can own VM
-	const_cast<CppSQLite3Statement&>(rStatement).mpVM = 0;
+	rStatement.mpVM = 0;
 }
 
 
-CppSQLite3Statement::CppSQLite3Statement(sqlite3* pDB, sqlite3_stmt* pVM)
+CppSQLite3Statement::CppSQLite3Statement(sqlite3* pDB, sqlite3_stmt* pVM,
+										 std::shared_ptr<CppSQLite3StatementCache> pCache/*=nullptr*/)
 {
 	mpDB = pDB;
 	mpVM = pVM;
+	mpCache = std::move(pCache);
 }
 
 
 CppSQLite3Statement::~CppSQLite3Statement()
 {
-	try
-	{
-		finalize();
-	}
-	catch (...)
-	{
-	}
+	release();
 }
 
 
-CppSQLite3Statement& CppSQLite3Statement::operator=(const CppSQLite3Statement& rStatement)
+CppSQLite3Statement& CppSQLite3Statement::operator=(CppSQLite3Statement&& rStatement) noexcept
 {
+	if (this == &rStatement)
+	{
+		return *this;
+	}
+	release();
 	mpDB = rStatement.mpDB;
 	mpVM = rStatement.mpVM;
+	mpCache = std::move(rStatement.mpCache);
 	// Only one object can own VM
-	const_cast<CppSQLite3Statement&>(rStatement).mpVM = 0;
+	rStatement.mpVM = 0;
 	return *this;
 }
 
 
+void CppSQLite3Statement::release() noexcept
+{
+	if (mpVM && mpCache)
+	{
+		mpCache->checkin(mpVM);
+		mpVM = 0;
+	}
+	mpCache.reset();
+	try
+	{
+		finalize();
+	}
+	catch (...)
+	{
+	}
+}
+
+
 int CppSQLite3Statement::execDML()
 {
 	checkDB();
@@ -1139,6 +1385,7 @@ void CppSQLite3Statement::reset()
 
 void CppSQLite3Statement::finalize()
 {
+	mpCache.reset();
 	if (mpVM)
 	{
 		int nRet = sqlite3_finalize(mpVM);
@@ -1181,6 +1428,7 @@ CppSQLite3DB::CppSQLite3DB()
 {
 	mpDB = 0;
 	mnBusyTimeoutMs = 60000; // 60 seconds
+	mnStatementCacheSize = 32;
 }
 
 
@@ -1188,6 +1436,7 @@ CppSQLite3DB::CppSQLite3DB(const CppSQLite3DB& db)
 {
 	mpDB = db.mpDB;
 	mnBusyTimeoutMs = 60000; // 60 seconds
+	mnStatementCacheSize = 32;
 }
 
 
@@ -1222,11 +1471,17 @@ void CppSQLite3DB::open(const char* szFile)
 	}
 
 	setBusyTimeout(mnBusyTimeoutMs);
+	mpStatementCache = std::make_shared<CppSQLite3StatementCache>(mpDB, mnStatementCacheSize);
 }
 
 
 void CppSQLite3DB::close()
 {
+	if (mpStatementCache)
+	{
+		mpStatementCache->close();
+		mpStatementCache.reset();
+	}
 	if (mpDB)
 	{
 		if (sqlite3_close(mpDB) == SQLITE_OK)
@@ -1252,6 +1507,29 @@ CppSQLite3Statement CppSQLite3DB::compileStatement(const char* szSQL)
 }
 
 
+CppSQLite3Statement CppSQLite3DB::cachedStatement(const char* szSQL)
+{
+	checkDB();
+
+	sqlite3_stmt* pVM = mpStatementCache->checkout(szSQL);
+	if (!pVM)
+	{
+		pVM = compile(szSQL);
+	}
+	return CppSQLite3Statement(mpDB, pVM, mpStatementCache);
+}
+
+
+void CppSQLite3DB::setStatementCacheSize(int nStatements)
+{
+	mnStatementCacheSize = nStatements > 0 ? nStatements : 0;
+	if (mpStatementCache)
+	{
+		mpStatementCache->setCapacity(mnStatementCacheSize);
+	}
+}
+
+
 bool CppSQLite3DB::tableExists(const char* szTable)
 {
 	char szSQL[256];
@@ -29,6 +29,11 @@
 //			12/07/2007	-Added CppSQLiteDB::IsAutoCommitOn()
 //						-Added int64 functions to CppSQLite3Query
 //						-Added Name based parameter binding to CppSQLite3Statement.
+//
+// V3.3					-Added CppSQLite3ColumnReader and CppSQLite3RowMapper for
+//						 bulk reads into typed columns and structs
+//						-CppSQLite3Query and CppSQLite3Statement are move-only
+//						-Added an LRU prepared statement cache to CppSQLite3DB
 ////////////////////////////////////////////////////////////////////////////////
 #ifndef _CppSQLite3_H_
 #define _CppSQLite3_H_
@@ -36,6 +41,14 @@
 #include "sqlite3.h"
 #include <cstdio>
 #include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #define CPPSQLITE_ERROR 1000
 
@@ -120,14 +133,17 @@ public:
 
     CppSQLite3Query();
 
-    CppSQLite3Query(const CppSQLite3Query& rQuery);
+    CppSQLite3Query(CppSQLite3Query&& rQuery) noexcept;
 
     CppSQLite3Query(sqlite3* pDB,
 				sqlite3_stmt* pVM,
                 bool bEof,
                 bool bOwnVM=true);
 
-    CppSQLite3Query& operator=(const CppSQLite3Query& rQuery);
+    CppSQLite3Query& operator=(CppSQLite3Query&& rQuery) noexcept;
+
+    CppSQLite3Query(const CppSQLite3Query&) = delete;
+    CppSQLite3Query& operator=(const CppSQLite3Query&) = delete;
 
     virtual ~CppSQLite3Query();
 
@@ -168,6 +184,9 @@ public:
 
 private:
 
+    friend class CppSQLite3ColumnReader;
+    template <typename T> friend class CppSQLite3RowMapper;
+
     void checkVM();
 
 	sqlite3* mpDB;
@@ -178,6 +197,112 @@ private:
 };
 
 
+// Reads a query into typed columns. Column names are resolved to indices
+// once in bind(); read() then steps the statement and copies each bound
+// column straight from sqlite3_column_*, with no per-field name lookup.
+// Bound vectors are appended to; bound buffers are filled from their start
+// on every read(), so nRows must not exceed their capacity.
+// NULL reads as 0 or an empty string.
+class CppSQLite3ColumnReader
+{
+public:
+
+    explicit CppSQLite3ColumnReader(CppSQLite3Query& rQuery);
+
+    void bind(const char* szField, std::vector<int>& column);
+    void bind(const char* szField, std::vector<sqlite_int64>& column);
+    void bind(const char* szField, std::vector<double>& column);
+    void bind(const char* szField, std::vector<std::string>& column);
+
+    void bind(const char* szField, int* pBuffer, int nCapacity);
+    void bind(const char* szField, sqlite_int64* pBuffer, int nCapacity);
+    void bind(const char* szField, double* pBuffer, int nCapacity);
+
+    // Reads up to nRows rows (all remaining rows if nRows < 0) and returns
+    // the number read; 0 means the query is exhausted.
+    int read(int nRows=-1);
+
+private:
+
+    enum Target { INT_VECTOR, INT64_VECTOR, DOUBLE_VECTOR, STRING_VECTOR,
+                  INT_BUFFER, INT64_BUFFER, DOUBLE_BUFFER };
+
+    struct Binding
+    {
+        int nCol;
+        Target eTarget;
+        void* pTarget;
+        int nCapacity;
+    };
+
+    void add(const char* szField, Target eTarget, void* pTarget, int nCapacity);
+
+    CppSQLite3Query& mQuery;
+    std::vector<Binding> mBindings;
+};
+
+
+// Maps each row of a query onto a struct through member pointers, e.g.
+//     CppSQLite3RowMapper<Row> mapper(q);
+//     mapper.field("fund_code", &Row::code).field("days", &Row::days);
+//     mapper.read(rows);
+// Supported member types are int, long, long long, double and std::string.
+template <typename T>
+class CppSQLite3RowMapper
+{
+public:
+
+    explicit CppSQLite3RowMapper(CppSQLite3Query& rQuery) : mQuery(rQuery) {}
+
+    template <typename M>
+    CppSQLite3RowMapper& field(const char* szField, M T::*pMember)
+    {
+        int nCol = mQuery.fieldIndex(szField);
+        mFields.push_back([nCol, pMember](sqlite3_stmt* pVM, T& row)
+        {
+            if constexpr (std::is_same_v<M, std::string>)
+            {
+                const char* szValue = (const char*)sqlite3_column_text(pVM, nCol);
+                row.*pMember = szValue ? szValue : "";
+            }
+            else if constexpr (std::is_floating_point_v<M>)
+            {
+                row.*pMember = static_cast<M>(sqlite3_column_double(pVM, nCol));
+            }
+            else
+            {
+                static_assert(std::is_integral_v<M>, "unsupported member type");
+                row.*pMember = static_cast<M>(sqlite3_column_int64(pVM, nCol));
+            }
+        });
+        return *this;
+    }
+
+    // Appends up to nRows rows (all remaining rows if nRows < 0) to rows and
+    // returns the number read.
+    int read(std::vector<T>& rows, int nRows=-1)
+    {
+        int nRead = 0;
+        while ((nRows < 0 || nRead < nRows) && !mQuery.eof())
+        {
+            T& row = rows.emplace_back();
+            for (auto& setField : mFields)
+            {
+                setField(mQuery.mpVM, row);
+            }
+            mQuery.nextRow();
+            nRead++;
+        }
+        return nRead;
+    }
+
+private:
+
+    CppSQLite3Query& mQuery;
+    std::vector<std::function<void(sqlite3_stmt*, T&)>> mFields;
+};
+
+
 class CppSQLite3Table
 {
 public:
@@ -228,19 +353,72 @@ private:
 };
 
 
+// Idle prepared statements of one connection, keyed by SQL text and evicted
+// least recently used first. A statement is checked out exclusively: asking
+// for SQL that is already in use compiles a second VM, and whichever comes
+// back while the slot is taken is finalized. Shared with the statements it
+// hands out, so a statement outliving close() is simply finalized.
+class CppSQLite3StatementCache
+{
+public:
+
+    CppSQLite3StatementCache(sqlite3* pDB, size_t nCapacity);
+    ~CppSQLite3StatementCache();
+
+    CppSQLite3StatementCache(const CppSQLite3StatementCache&) = delete;
+    CppSQLite3StatementCache& operator=(const CppSQLite3StatementCache&) = delete;
+
+    // Returns an idle VM for szSQL (reset, bindings cleared), or 0 on a miss.
+    sqlite3_stmt* checkout(const char* szSQL);
+    // Takes back a VM handed out by checkout() or compiled after a miss.
+    void checkin(sqlite3_stmt* pVM);
+
+    void setCapacity(size_t nCapacity);
+    // Finalizes every idle VM; later check-ins are finalized too.
+    void close();
+
+    size_t hits() const { return mnHits; }
+    size_t misses() const { return mnMisses; }
+
+private:
+
+    struct Entry
+    {
+        std::string sql;
+        sqlite3_stmt* pVM;
+    };
+
+    void evict();
+
+    sqlite3* mpDB;
+    size_t mnCapacity;
+    size_t mnHits;
+    size_t mnMisses;
+    // Most recently used first; mIndex keys point into the entries' sql.
+    std::list<Entry> mEntries;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> mIndex;
+};
+
+
 class CppSQLite3Statement
 {
 public:
 
     CppSQLite3Statement();
 
-    CppSQLite3Statement(const CppSQLite3Statement& rStatement);
+    CppSQLite3Statement(CppSQLite3Statement&& rStatement) noexcept;
 
-    CppSQLite3Statement(sqlite3* pDB, sqlite3_stmt* pVM);
+    CppSQLite3Statement(sqlite3* pDB, sqlite3_stmt* pVM,
+                        std::shared_ptr<CppSQLite3StatementCache> pCache=nullptr);
 
+    // Returns the VM to the statement cache it came from, if any,
+    // otherwise finalizes it.
     virtual ~CppSQLite3Statement();
 
-    CppSQLite3Statement& operator=(const CppSQLite3Statement& rStatement);
+    CppSQLite3Statement& operator=(CppSQLite3Statement&& rStatement) noexcept;
+
+    CppSQLite3Statement(const CppSQLite3Statement&) = delete;
+    CppSQLite3Statement& operator=(const CppSQLite3Statement&) = delete;
 
     int execDML();
 
@@ -262,15 +440,19 @@ public:
 
 	void reset();
 
+    // Finalizes the VM, bypassing the statement cache.
     void finalize();
 
 private:
 
+    void release() noexcept;
+
     void checkDB();
     void checkVM();
 
     sqlite3* mpDB;
     sqlite3_stmt* mpVM;
+    std::shared_ptr<CppSQLite3StatementCache> mpCache;
 };
 
 
@@ -298,6 +480,18 @@ public:
 
     CppSQLite3Statement compileStatement(const char* szSQL);
 
+    // Like compileStatement(), but reuses an idle VM prepared earlier for the
+    // same SQL text. The VM goes back to the cache when the statement is
+    // destroyed, so repeated statements skip the SQL compiler. szSQL must be
+    // a single statement.
+    CppSQLite3Statement cachedStatement(const char* szSQL);
+    CppSQLite3Statement cachedStatement(const std::string& sSQL) { return cachedStatement(sSQL.c_str()); }
+
+    // Number of idle statements kept per connection (default 32).
+    void setStatementCacheSize(int nStatements);
+    size_t statementCacheHits() const { return mpStatementCache ? mpStatementCache->hits() : 0; }
+    size_t statementCacheMisses() const { return mpStatementCache ? mpStatementCache->misses() : 0; }
+
     sqlite_int64 lastRowId();
 
     void interrupt() { sqlite3_interrupt(mpDB); }
@@ -322,6 +516,8 @@ private:
 
     sqlite3* mpDB;
     int mnBusyTimeoutMs;
+    int mnStatementCacheSize;
+    std::shared_ptr<CppSQLite3StatementCache> mpStatementCache;
 };
 
 #endif
@@ -13,15 +13,90 @@ const std::string CREATE_TABLE = std::string("create table [TB_FUND](id INTEGER
 
 const std::string INSERT_SQL = std::string("insert into [TB_FUND] values (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);");
 
-DatabaseStorage::DatabaseStorage()
+const std::string CREATE_SERIES_TABLE = "create table [TB_SERIES](fund_code TEXT PRIMARY KEY, days INTEGER);";
+
+const std::string CREATE_RUN_TABLE = "create table [TB_RUN](run_id INTEGER PRIMARY KEY AUTOINCREMENT, "
+    "started_at INTEGER, parameters TEXT);";
+
+const std::string CREATE_OPERATION_TABLE = std::string("create table [TB_OPERATION](id INTEGER PRIMARY KEY AUTOINCREMENT,")
+    + " run_id INTEGER, fund_code TEXT, period TEXT, buy_day INTEGER, buy_price REAL, sell_day INTEGER, sell_price REAL,"
+    + " lot_size REAL, grid_type INTEGER, status INTEGER);"
+    + " create index [IDX_OPERATION_FUND] on [TB_OPERATION](fund_code, period);"
+    + " create index [IDX_OPERATION_RUN] on [TB_OPERATION](run_id, fund_code, period);";
+
+const std::string CREATE_PRICE_TABLE = "create table [TB_PRICE](fund_code TEXT, series TEXT, updated_at INTEGER,"
+    " days INTEGER, last_day INTEGER, data BLOB, PRIMARY KEY (fund_code, series));";
+
+// 结果缓存：键是输入内容的哈希，对应的结果行在 TB_FUND 中
+const std::string CREATE_RESULT_CACHE_TABLE = "create table [TB_RESULT_CACHE](cache_key INTEGER PRIMARY KEY,"
+    " fund_code TEXT, period TEXT, run_id INTEGER, created_at INTEGER);";
+
+const std::string OPERATION_COLUMNS = "run_id, fund_code, period, buy_day, buy_price, sell_day, sell_price, "
+    "lot_size, grid_type, status";
+const int OPERATION_FIELDS = 10;
+
+// 多行 insert 每条语句的行数，参数总数需小于 SQLITE_MAX_VARIABLE_NUMBER 的旧默认值 999
+const size_t OPERATION_BATCH_ROWS = 64;
+
+static std::string operationInsertSql(size_t rows)
+{
+    std::string sql = "insert into [TB_OPERATION] (" + OPERATION_COLUMNS + ") values ";
+    for (size_t i = 0; i < rows; ++i)
+    {
+        sql += i == 0 ? "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?)" : ", (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    }
+    return sql + ";";
+}
+
+const std::string FUND_COLUMNS = "fund_code, period, total_value, balance, holdings_value, profit, loss, "
+    "percentile_70_price, percentile_30_price, operation_id";
+
+// 事务控制语句也走语句缓存，每批结果提交时不再编译
+const char* const BEGIN_SQL = "begin transaction;";
+const char* const COMMIT_SQL = "commit transaction;";
+const char* const ROLLBACK_SQL = "rollback transaction;";
+// 一条结果由多条语句写入，用保存点保证在批量事务中整体写入或整体撤销
+const char* const SAVEPOINT_SQL = "savepoint result;";
+const char* const RELEASE_SQL = "release result;";
+const char* const ROLLBACK_TO_SQL = "rollback to result;";
+
+const char* const SERIES_SQL = "insert or replace into [TB_SERIES] values (?, ?);";
+const char* const PRICE_SQL = "insert or replace into [TB_PRICE] values (?, ?, strftime('%s', 'now'), ?, ?, ?);";
+const char* const RESULT_CACHE_SQL =
+    "insert or replace into [TB_RESULT_CACHE] values (?, ?, ?, ?, strftime('%s', 'now'));";
+
+DatabaseStorage::DatabaseStorage(const std::string& databasePath)
+    : operationSql_(operationInsertSql(1)), operationBatchSql_(operationInsertSql(OPERATION_BATCH_ROWS))
 {
-    std::string databasePath = "/home/zhahu/FUND/c++/fund.db";
     db_.open(databasePath.c_str());
+    // WAL 模式下读写互不阻塞，synchronous=NORMAL 时只在检查点 fsync
+    db_.execDML("pragma journal_mode=WAL;");
+    db_.execDML("pragma synchronous=NORMAL;");
 
     if (!db_.tableExists("TB_FUND"))
     {
         db_.execDML(CREATE_TABLE.c_str());
     }
+    if (!db_.tableExists("TB_SERIES"))
+    {
+        db_.execDML(CREATE_SERIES_TABLE.c_str());
+    }
+    if (!db_.tableExists("TB_RUN"))
+    {
+        db_.execDML(CREATE_RUN_TABLE.c_str());
+    }
+    if (!db_.tableExists("TB_OPERATION"))
+    {
+        db_.execDML(CREATE_OPERATION_TABLE.c_str());
+    }
+    if (!db_.tableExists("TB_PRICE"))
+    {
+        db_.execDML(CREATE_PRICE_TABLE.c_str());
+    }
+    if (!db_.tableExists("TB_RESULT_CACHE"))
+    {
+        db_.execDML(CREATE_RESULT_CACHE_TABLE.c_str());
+    }
 }
 
 DatabaseStorage::~DatabaseStorage()
@@ -39,43 +114,314 @@ DatabaseStorage::~DatabaseStorage()
 bool DatabaseStorage::add(const std::string& fund_code, const std::string& period, double total_value,
     double balance, double holdings_value, double profit, double loss,
     double percentile_70_price, double percentile_30_price, int operation_id)
+{
+    FundResult result;
+    result.fund_code = fund_code;
+    result.period = period;
+    result.total_value = total_value;
+    result.balance = balance;
+    result.holdings_value = holdings_value;
+    result.profit = profit;
+    result.loss = loss;
+    result.percentile_70_price = percentile_70_price;
+    result.percentile_30_price = percentile_30_price;
+    result.operation_id = operation_id;
+
+    beginTransaction();
+    try
+    {
+        insert(result);
+    }
+    catch (CppSQLite3Exception& e)
+    {
+        std::cerr << "Error inserting data: " << e.errorMessage() << std::endl;
+        rollbackTransaction();
+        return false;
+    }
+    commitTransaction();
+    return true;
+}
+
+void DatabaseStorage::insert(const FundResult& result)
+{
+    db_.cachedStatement(SAVEPOINT_SQL).execDML();
+    try
+    {
+        insertRows(result);
+    }
+    catch (...)
+    {
+        // 撤销本条结果已写入的行，事务中之前的结果保留；撤销失败（例如整个事务已被 SQLite 回滚）时抛出原来的错误
+        try
+        {
+            db_.cachedStatement(ROLLBACK_TO_SQL).execDML();
+            db_.cachedStatement(RELEASE_SQL).execDML();
+        }
+        catch (CppSQLite3Exception&)
+        {
+        }
+        throw;
+    }
+    db_.cachedStatement(RELEASE_SQL).execDML();
+}
+
+void DatabaseStorage::insertRows(const FundResult& result)
 {
     auto round_to_two = [](double value) {
         return std::round(value * 100.0) / 100.0;
     };
 
-    total_value = round_to_two(total_value);
-    balance = round_to_two(balance);
-    holdings_value = round_to_two(holdings_value);
-    profit = round_to_two(profit);
-    loss = round_to_two(loss);
-    percentile_70_price = round_to_two(percentile_70_price);
-    percentile_30_price = round_to_two(percentile_30_price);
+    CppSQLite3Statement smt = db_.cachedStatement(INSERT_SQL);
+    smt.bindNull(1); // id will be auto-incremented
+    smt.bind(2, result.fund_code.c_str());
+    smt.bind(3, result.period.c_str());
+    smt.bind(4, round_to_two(result.total_value));
+    smt.bind(5, round_to_two(result.balance));
+    smt.bind(6, round_to_two(result.holdings_value));
+    smt.bind(7, round_to_two(result.profit));
+    smt.bind(8, round_to_two(result.loss));
+    smt.bind(9, round_to_two(result.percentile_70_price));
+    smt.bind(10, round_to_two(result.percentile_30_price));
+    smt.bind(11, result.operation_id);
+    smt.execDML();
+
+    insertOperations(result);
+
+    // 与结果行在同一个事务中提交，缓存中的键总有对应的结果
+    if (result.cache_key != 0)
+    {
+        CppSQLite3Statement cacheSmt = db_.cachedStatement(RESULT_CACHE_SQL);
+        cacheSmt.bind(1, static_cast<sqlite_int64>(result.cache_key));
+        cacheSmt.bind(2, result.fund_code.c_str());
+        cacheSmt.bind(3, result.period.c_str());
+        cacheSmt.bind(4, result.operation_id);
+        cacheSmt.execDML();
+    }
+}
+
+void DatabaseStorage::insertOperations(const FundResult& result)
+{
+    auto bindOperation = [&](CppSQLite3Statement& smt, int base, const OperationRecord& operation) {
+        smt.bind(base + 1, result.operation_id);
+        smt.bind(base + 2, result.fund_code.c_str());
+        smt.bind(base + 3, result.period.c_str());
+        smt.bind(base + 4, operation.buy_day);
+        smt.bind(base + 5, operation.buy_price);
+        smt.bind(base + 6, operation.sell_day);
+        smt.bind(base + 7, operation.sell_price);
+        smt.bind(base + 8, operation.lot_size);
+        smt.bind(base + 9, operation.grid_type);
+        smt.bind(base + 10, operation.status);
+    };
+
+    const auto& operations = result.operations;
+    size_t i = 0;
+    if (operations.size() >= OPERATION_BATCH_ROWS)
+    {
+        CppSQLite3Statement batchSmt = db_.cachedStatement(operationBatchSql_);
+        for (; i + OPERATION_BATCH_ROWS <= operations.size(); i += OPERATION_BATCH_ROWS)
+        {
+            for (size_t row = 0; row < OPERATION_BATCH_ROWS; ++row)
+            {
+                bindOperation(batchSmt, static_cast<int>(row) * OPERATION_FIELDS, operations[i + row]);
+            }
+            batchSmt.execDML();
+        }
+    }
+    if (i < operations.size())
+    {
+        CppSQLite3Statement smt = db_.cachedStatement(operationSql_);
+        for (; i < operations.size(); ++i)
+        {
+            bindOperation(smt, 0, operations[i]);
+            smt.execDML();
+        }
+    }
+}
+
+int DatabaseStorage::beginRun(const std::string& parameters, int run_id)
+{
+    CppSQLite3Statement smt = db_.cachedStatement("insert or ignore into [TB_RUN] values (?, strftime('%s', 'now'), ?);");
+    if (run_id > 0)
+    {
+        smt.bind(1, run_id);
+    }
+    else
+    {
+        smt.bindNull(1);
+    }
+    smt.bind(2, parameters.c_str());
+    smt.execDML();
+    return run_id > 0 ? run_id : static_cast<int>(db_.lastRowId());
+}
+
+void DatabaseStorage::beginTransaction()
+{
+    db_.cachedStatement(BEGIN_SQL).execDML();
+}
+
+void DatabaseStorage::commitTransaction()
+{
+    db_.cachedStatement(COMMIT_SQL).execDML();
+}
 
-    db_.execDML("begin transaction;");
+void DatabaseStorage::rollbackTransaction()
+{
+    db_.cachedStatement(ROLLBACK_SQL).execDML();
+}
+
+bool DatabaseStorage::setSeriesLength(const std::string& fund_code, int days)
+{
     try
     {
-        CppSQLite3Statement smt = db_.compileStatement(INSERT_SQL.c_str());
-        smt.bindNull(1); // id will be auto-incremented
-        smt.bind(2, fund_code.c_str());
-        smt.bind(3, period.c_str());
-        smt.bind(4, total_value);
-        smt.bind(5, balance);
-        smt.bind(6, holdings_value);
-        smt.bind(7, profit);
-        smt.bind(8, loss);
-        smt.bind(9, percentile_70_price);
-        smt.bind(10, percentile_30_price);
-        smt.bind(11, operation_id);
+        CppSQLite3Statement smt = db_.cachedStatement(SERIES_SQL);
+        smt.bind(1, fund_code.c_str());
+        smt.bind(2, days);
         smt.execDML();
-        smt.reset();
     }
     catch (CppSQLite3Exception& e)
     {
-        std::cerr << "Error inserting data: " << e.errorMessage() << std::endl;
-        db_.execDML("rollback transaction;");
+        std::cerr << "Error recording series length: " << e.errorMessage() << std::endl;
         return false;
     }
-    db_.execDML("commit transaction;");
     return true;
 }
+
+std::map<std::string, int> DatabaseStorage::seriesLengths()
+{
+    std::vector<std::string> codes;
+    std::vector<int> days;
+    CppSQLite3Query query = db_.execQuery("select fund_code, days from [TB_SERIES];");
+    CppSQLite3ColumnReader reader(query);
+    reader.bind("fund_code", codes);
+    reader.bind("days", days);
+    reader.read();
+
+    std::map<std::string, int> lengths;
+    for (size_t i = 0; i < codes.size(); ++i)
+    {
+        lengths[codes[i]] = days[i];
+    }
+    return lengths;
+}
+
+void DatabaseStorage::savePriceSeries(const std::string& fund_code, const std::string& series, const std::string& blob,
+    int days, int lastDay)
+{
+    CppSQLite3Statement smt = db_.cachedStatement(PRICE_SQL);
+    smt.bind(1, fund_code.c_str());
+    smt.bind(2, series.c_str());
+    smt.bind(3, days);
+    smt.bind(4, lastDay);
+    smt.bind(5, reinterpret_cast<const unsigned char*>(blob.data()), static_cast<int>(blob.size()));
+    smt.execDML();
+}
+
+bool DatabaseStorage::loadPriceSeries(const std::string& fund_code, const std::string& series, std::string& blob)
+{
+    CppSQLite3Statement smt = db_.cachedStatement("select data from [TB_PRICE] where fund_code = ? and series = ?;");
+    smt.bind(1, fund_code.c_str());
+    smt.bind(2, series.c_str());
+    CppSQLite3Query query = smt.execQuery();
+    if (query.eof())
+    {
+        return false;
+    }
+    int size = 0;
+    const unsigned char* data = query.getBlobField(0, size);
+    blob.assign(reinterpret_cast<const char*>(data), size);
+    return true;
+}
+
+void DatabaseStorage::forEachPriceSeries(const std::string& series, long updatedSince, const PriceSeriesCallback& onSeries)
+{
+    CppSQLite3Statement smt = db_.cachedStatement(
+        "select fund_code, updated_at, data from [TB_PRICE] where series = ? and updated_at >= ?;");
+    smt.bind(1, series.c_str());
+    smt.bind(2, static_cast<sqlite_int64>(updatedSince));
+    CppSQLite3Query query = smt.execQuery();
+    while (!query.eof())
+    {
+        int size = 0;
+        const unsigned char* data = query.getBlobField(2, size);
+        onSeries(query.getStringField(0), static_cast<long>(query.getInt64Field(1)), data, size);
+        query.nextRow();
+    }
+}
+
+long DatabaseStorage::lastPriceUpdate(const std::string& series)
+{
+    CppSQLite3Statement smt = db_.cachedStatement("select max(updated_at) from [TB_PRICE] where series = ?;");
+    smt.bind(1, series.c_str());
+    CppSQLite3Query query = smt.execQuery();
+    return static_cast<long>(query.getInt64Field(0));
+}
+
+std::vector<sqlite_int64> DatabaseStorage::resultCacheKeys()
+{
+    std::vector<sqlite_int64> keys;
+    CppSQLite3Query query = db_.execQuery("select cache_key from [TB_RESULT_CACHE] order by cache_key;");
+    CppSQLite3ColumnReader reader(query);
+    reader.bind("cache_key", keys);
+    reader.read();
+    return keys;
+}
+
+bool DatabaseStorage::shardHasTable(const char* table)
+{
+    CppSQLite3Statement smt = db_.cachedStatement(
+        "select count(*) from shard.sqlite_master where type = 'table' and name = ?;");
+    smt.bind(1, table);
+    CppSQLite3Query query = smt.execQuery();
+    return query.getIntField(0) > 0;
+}
+
+bool DatabaseStorage::merge(const std::string& shardPath)
+{
+    std::string quoted;
+    for (char c : shardPath)
+    {
+        quoted += c;
+        if (c == '\'')
+        {
+            quoted += c;
+        }
+    }
+
+    db_.execDML(("attach database '" + quoted + "' as shard;").c_str());
+    bool ok = true;
+    try
+    {
+        db_.execDML("begin transaction;");
+        if (shardHasTable("TB_FUND"))
+        {
+            db_.execDML(("insert into [TB_FUND] (" + FUND_COLUMNS + ") select " + FUND_COLUMNS + " from shard.[TB_FUND];").c_str());
+        }
+        if (shardHasTable("TB_SERIES"))
+        {
+            db_.execDML("insert or replace into [TB_SERIES] select fund_code, days from shard.[TB_SERIES];");
+        }
+        if (shardHasTable("TB_RUN"))
+        {
+            db_.execDML("insert or ignore into [TB_RUN] select run_id, started_at, parameters from shard.[TB_RUN];");
+        }
+        if (shardHasTable("TB_OPERATION"))
+        {
+            db_.execDML(("insert into [TB_OPERATION] (" + OPERATION_COLUMNS + ") select " + OPERATION_COLUMNS
+                + " from shard.[TB_OPERATION];").c_str());
+        }
+        if (shardHasTable("TB_RESULT_CACHE"))
+        {
+            db_.execDML("insert or replace into [TB_RESULT_CACHE] select * from shard.[TB_RESULT_CACHE];");
+        }
+        db_.execDML("commit transaction;");
+    }
+    catch (CppSQLite3Exception& e)
+    {
+        std::cerr << "Error merging " << shardPath << ": " << e.errorMessage() << std::endl;
+        db_.execDML("rollback transaction;");
+        ok = false;
+    }
+    db_.execDML("detach database shard;");
+    return ok;
+}
@@ -5,21 +5,65 @@
 #ifndef ATL_MOCK_DATABASESTORAGE_HPP_
 #define ATL_MOCK_DATABASESTORAGE_HPP_
 
+#include <functional>
+#include <map>
 #include <string>
+#include <vector>
 #include "CppSQLite3.h"
+#include "ResultSink.hpp"
 
-class DatabaseStorage
+class DatabaseStorage : public ResultSink
 {
 public:
-    explicit DatabaseStorage();
+    explicit DatabaseStorage(const std::string& databasePath);
     ~DatabaseStorage();
 
+    // 单条写入，自带事务
     bool add(const std::string& fund_code, const std::string& period, double total_value,
        double balance, double holdings_value, double profit, double loss,
        double percentile_70_price, double percentile_30_price, int operation_id);
 
+    // 使用预编译语句写入结果、交易记录和缓存键，不开启事务，由调用者批量提交；
+    // 在保存点中执行，失败时本条结果的行全部撤销后抛出异常
+    void insert(const FundResult& result) override;
+
+    // 登记一次运行并返回 run_id；run_id 非 0 时使用指定值（分片工作进程沿用协调者的 run_id）
+    int beginRun(const std::string& parameters, int run_id = 0);
+
+    void beginTransaction() override;
+    void commitTransaction() override;
+    void rollbackTransaction() override;
+
+    // 记录每个基金的序列长度，供分片时按工作量加权
+    bool setSeriesLength(const std::string& fund_code, int days);
+    std::map<std::string, int> seriesLengths();
+
+    // TB_PRICE：每个 (基金, 序列类型) 一个压缩后的净值序列 BLOB
+    void savePriceSeries(const std::string& fund_code, const std::string& series, const std::string& blob,
+        int days, int lastDay);
+    bool loadPriceSeries(const std::string& fund_code, const std::string& series, std::string& blob);
+    // 遍历 updated_at >= updatedSince 的序列，data 直接指向 SQLite 的结果行，只在回调期间有效
+    using PriceSeriesCallback = std::function<void(const char* fund_code, long updatedAt,
+        const unsigned char* data, int size)>;
+    void forEachPriceSeries(const std::string& series, long updatedSince, const PriceSeriesCallback& onSeries);
+    // 该类型序列最近一次更新的时间，没有序列时为 0
+    long lastPriceUpdate(const std::string& series);
+
+    // TB_RESULT_CACHE 中所有结果的键，按升序排列
+    std::vector<sqlite_int64> resultCacheKeys();
+
+    // 把分片工作进程写出的结果库合并进当前库
+    bool merge(const std::string& shardPath);
+
 private:
+    void insertRows(const FundResult& result);
+    void insertOperations(const FundResult& result);
+    bool shardHasTable(const char* table);
+
+    // 所有语句都从连接的预编译语句缓存中取，重复执行时不再编译 SQL
     CppSQLite3DB db_;
+    const std::string operationSql_;
+    const std::string operationBatchSql_;
 };
 
 #endif  // ASM_DATABASESTORAGE_HPP_
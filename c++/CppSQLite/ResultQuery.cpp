@@ -0,0 +1,143 @@
+#include "ResultQuery.hpp"
+#include "ResultSink.hpp"
+
+// 索引包含查询输出的全部列，排名和按基金聚合都只读索引、不回表。
+// 排名索引以排序列开头，按周期等条件过滤时沿索引扫描到够 limit 行即停止
+const char* const CREATE_QUERY_INDEXES =
+    "create index if not exists [IDX_FUND_CODE_PERIOD] on [TB_FUND]"
+    "(fund_code, period, operation_id, profit, total_value, balance, holdings_value);"
+    " create index if not exists [IDX_FUND_PROFIT] on [TB_FUND]"
+    "(profit, fund_code, period, operation_id, total_value, balance, holdings_value);"
+    " create index if not exists [IDX_FUND_TOTAL_VALUE] on [TB_FUND]"
+    "(total_value, fund_code, period, operation_id, profit, balance, holdings_value);"
+    " create index if not exists [IDX_OPERATION_STATUS] on [TB_OPERATION](status, run_id, fund_code, period);";
+
+const char* const RESULT_COLUMNS = "fund_code, period, operation_id as run_id, total_value, balance, holdings_value, profit";
+
+template <typename T>
+static std::function<void(CppSQLite3Statement&, int)> bindValue(T value)
+{
+    return [value](CppSQLite3Statement& smt, int index) { smt.bind(index, value); };
+}
+
+ResultQuery::ResultQuery(const std::string& databasePath)
+{
+    db_.open(databasePath.c_str());
+}
+
+ResultQuery::~ResultQuery()
+{
+    db_.close();
+}
+
+void ResultQuery::ensureIndexes()
+{
+    if (indexed_)
+    {
+        return;
+    }
+    db_.execDML("begin transaction;");
+    try
+    {
+        db_.execDML(CREATE_QUERY_INDEXES);
+        db_.execDML("commit transaction;");
+    }
+    catch (CppSQLite3Exception&)
+    {
+        db_.execDML("rollback transaction;");
+        throw;
+    }
+    // 新建索引后收集统计信息，让查询规划器在多个索引之间正确选择
+    db_.execDML("pragma optimize;");
+    indexed_ = true;
+}
+
+std::string ResultQuery::where(const ResultFilter& filter, const char* runColumn, bool hasProfit,
+    std::vector<Parameter>& parameters, const std::string& condition)
+{
+    std::string sql = condition.empty() ? std::string() : " where " + condition;
+    auto add = [&](const std::string& condition, Parameter bind) {
+        sql += sql.empty() ? " where " : " and ";
+        sql += condition;
+        parameters.push_back(std::move(bind));
+    };
+    if (!filter.fund_code.empty())
+    {
+        add("fund_code = ?", [code = filter.fund_code](CppSQLite3Statement& smt, int i) { smt.bind(i, code.c_str()); });
+    }
+    if (!filter.period.empty())
+    {
+        add("period = ?", [period = filter.period](CppSQLite3Statement& smt, int i) { smt.bind(i, period.c_str()); });
+    }
+    if (filter.run_id > 0)
+    {
+        add(std::string(runColumn) + " = ?", bindValue(filter.run_id));
+    }
+    if (hasProfit && filter.hasMinProfit)
+    {
+        add("profit >= ?", bindValue(filter.minProfit));
+    }
+    if (hasProfit && filter.hasMaxProfit)
+    {
+        add("profit <= ?", bindValue(filter.maxProfit));
+    }
+    return sql;
+}
+
+void ResultQuery::run(const std::string& sql, const std::vector<Parameter>& parameters, const RowCallback& onRow)
+{
+    ensureIndexes();
+    CppSQLite3Statement smt = db_.cachedStatement(sql);
+    for (size_t i = 0; i < parameters.size(); ++i)
+    {
+        parameters[i](smt, static_cast<int>(i) + 1);
+    }
+    // 语句持有结果集的 VM，必须在遍历完之前保持有效
+    CppSQLite3Query query = smt.execQuery();
+    while (!query.eof())
+    {
+        onRow(query);
+        query.nextRow();
+    }
+}
+
+void ResultQuery::top(const ResultFilter& filter, const std::string& orderColumn, bool ascending, int limit,
+    const RowCallback& onRow)
+{
+    std::string column = orderColumn == "total_value" ? "total_value" : "profit";
+    std::vector<Parameter> parameters;
+    std::string sql = std::string("select ") + RESULT_COLUMNS + " from [TB_FUND]"
+        + where(filter, "operation_id", true, parameters)
+        + " order by " + column + (ascending ? " asc" : " desc") + " limit ?;";
+    parameters.push_back(bindValue(limit));
+    run(sql, parameters, onRow);
+}
+
+void ResultQuery::list(const ResultFilter& filter, int limit, const RowCallback& onRow)
+{
+    std::vector<Parameter> parameters;
+    std::string sql = std::string("select ") + RESULT_COLUMNS + " from [TB_FUND]"
+        + where(filter, "operation_id", true, parameters)
+        + " order by fund_code, period, operation_id limit ?;";
+    parameters.push_back(bindValue(limit > 0 ? limit : -1));
+    run(sql, parameters, onRow);
+}
+
+void ResultQuery::perFund(const ResultFilter& filter, const RowCallback& onRow)
+{
+    std::vector<Parameter> parameters;
+    std::string sql = "select fund_code, count(*) as results, avg(profit) as avg_profit, min(profit) as min_profit,"
+        " max(profit) as max_profit, avg(total_value) as avg_total_value from [TB_FUND]"
+        + where(filter, "operation_id", true, parameters)
+        + " group by fund_code order by fund_code;";
+    run(sql, parameters, onRow);
+}
+
+void ResultQuery::outOfMoney(const ResultFilter& filter, const RowCallback& onRow)
+{
+    std::vector<Parameter> parameters{bindValue(static_cast<int>(OperationRecord::NOT_ENOUGH_MONEY))};
+    std::string sql = "select fund_code, period, run_id, count(*) as times from [TB_OPERATION]"
+        + where(filter, "run_id", false, parameters, "status = ?")
+        + " group by run_id, fund_code, period order by fund_code, period, run_id;";
+    run(sql, parameters, onRow);
+}
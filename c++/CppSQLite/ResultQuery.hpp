@@ -0,0 +1,55 @@
+#ifndef FUND_RESULTQUERY_HPP_
+#define FUND_RESULTQUERY_HPP_
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "CppSQLite3.h"
+
+// 查询条件，未设置的条件不参与过滤
+struct ResultFilter
+{
+    std::string fund_code;
+    std::string period;
+    int run_id = 0;
+    bool hasMinProfit = false;
+    double minProfit = 0;
+    bool hasMaxProfit = false;
+    double maxProfit = 0;
+};
+
+// 结果库的只读查询。结果集逐行交给回调，不在内存中缓存，
+// 所需的覆盖索引在第一次查询时创建
+class ResultQuery
+{
+public:
+    using RowCallback = std::function<void(CppSQLite3Query& row)>;
+
+    explicit ResultQuery(const std::string& databasePath);
+    ~ResultQuery();
+
+    // 按 profit 或 total_value 排名取前 limit 行
+    void top(const ResultFilter& filter, const std::string& orderColumn, bool ascending, int limit,
+        const RowCallback& onRow);
+    // 满足条件的结果行，按基金代码和周期排序
+    void list(const ResultFilter& filter, int limit, const RowCallback& onRow);
+    // 每个基金的结果数、收益的平均/最小/最大值和平均总资产
+    void perFund(const ResultFilter& filter, const RowCallback& onRow);
+    // 出现过资金不足而无法买入的基金、周期和次数（需要 TB_OPERATION）
+    void outOfMoney(const ResultFilter& filter, const RowCallback& onRow);
+
+private:
+    // 把一个参数绑定到语句的指定位置
+    using Parameter = std::function<void(CppSQLite3Statement& smt, int index)>;
+
+    void ensureIndexes();
+    // 生成 where 子句，参数按出现顺序追加到 parameters；condition 非空时作为第一个条件
+    static std::string where(const ResultFilter& filter, const char* runColumn, bool hasProfit,
+        std::vector<Parameter>& parameters, const std::string& condition = std::string());
+    void run(const std::string& sql, const std::vector<Parameter>& parameters, const RowCallback& onRow);
+
+    CppSQLite3DB db_;
+    bool indexed_ = false;
+};
+
+#endif  // FUND_RESULTQUERY_HPP_
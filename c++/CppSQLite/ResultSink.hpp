@@ -0,0 +1,69 @@
+#ifndef FUND_RESULTSINK_HPP_
+#define FUND_RESULTSINK_HPP_
+
+#include <string>
+#include <vector>
+
+// TB_OPERATION 中的一笔交易
+struct OperationRecord
+{
+    enum GridType { SMALL_GRID = 0, BIG_GRID = 1 };
+    enum Status { OPEN = 0, SOLD = 1, NOT_ENOUGH_MONEY = 2 };
+
+    int buy_day = 0;      // 自 1970-01-01 起的天数
+    double buy_price = 0;
+    int sell_day = 0;     // 未卖出时为 0
+    double sell_price = 0;
+    double lot_size = 0;  // 这一格投入的金额
+    int grid_type = SMALL_GRID;
+    int status = OPEN;
+};
+
+// 产生这条结果的网格参数
+struct ResultParameters
+{
+    double grid_size = 0;
+    double big_grid_size = 0;
+    int factor = 0;
+    double sum = 0;
+    double amount = 0;
+    double threshold_low = 0;
+    double threshold_high = 0;
+};
+
+// TB_FUND 中的一行结果，operation_id 是所属运行的 run_id，
+// 通过 (run_id, fund_code, period) 关联到 TB_OPERATION；
+// cache_key 非 0 时结果库同时在 TB_RESULT_CACHE 中登记，之后相同输入的计算会被跳过
+struct FundResult
+{
+    std::string fund_code;
+    std::string period;
+    double total_value = 0;
+    double balance = 0;
+    double holdings_value = 0;
+    double profit = 0;
+    double loss = 0;
+    double percentile_70_price = 0;
+    double percentile_30_price = 0;
+    int operation_id = 0;
+    long long cache_key = 0;
+    ResultParameters parameters;
+    std::vector<OperationRecord> operations;
+};
+
+// 结果的落地方式：SQLite 结果库或列式文件。只由 ResultWriter 的写线程调用，
+// 写入在 begin/commitTransaction 之间成批进行
+class ResultSink
+{
+public:
+    virtual ~ResultSink() = default;
+
+    // 抛出异常时不能留下这条结果的部分数据，写线程记录错误后继续写同一批的其余结果
+    virtual void insert(const FundResult& result) = 0;
+
+    virtual void beginTransaction() = 0;
+    virtual void commitTransaction() = 0;
+    virtual void rollbackTransaction() = 0;
+};
+
+#endif  // FUND_RESULTSINK_HPP_
@@ -0,0 +1,176 @@
+#include "ResultWriter.hpp"
+#include "../Logger.hpp"
+
+ResultWriter::ResultWriter(std::unique_ptr<ResultSink> sink, size_t batchRows, std::chrono::milliseconds flushInterval)
+    : sink_(std::move(sink)), batchRows_(batchRows > 0 ? batchRows : 1), flushInterval_(flushInterval)
+{
+    thread_ = std::thread(&ResultWriter::run, this);
+}
+
+ResultWriter::~ResultWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void ResultWriter::add(FundResult result)
+{
+    push(new Node{std::move(result)});
+}
+
+void ResultWriter::push(Node* node)
+{
+    node->next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    // 攒满一批时提前唤醒写线程；漏掉的唤醒最多延迟 flushInterval_
+    if (queued_.fetch_add(1, std::memory_order_relaxed) + 1 == batchRows_)
+    {
+        wake_.notify_one();
+    }
+}
+
+void ResultWriter::flush()
+{
+    size_t target = submitted_.load(std::memory_order_relaxed);
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushRequested_ = true;
+    wake_.notify_one();
+    written_cv_.wait(lock, [&]() { return written_ >= target; });
+}
+
+void ResultWriter::run()
+{
+    while (true)
+    {
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait_for(lock, flushInterval_, [this]() {
+                return stop_ || flushRequested_ || queued_.load(std::memory_order_relaxed) >= batchRows_;
+            });
+            flushRequested_ = false;
+            stop = stop_;
+        }
+
+        Node* list = head_.exchange(nullptr, std::memory_order_acquire);
+        if (list)
+        {
+            write(list);
+        }
+        if (stop && head_.load(std::memory_order_acquire) == nullptr)
+        {
+            break;
+        }
+    }
+}
+
+void ResultWriter::write(Node* list)
+{
+    // 链表是后进先出，先反转成提交顺序
+    Node* ordered = nullptr;
+    while (list)
+    {
+        Node* next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+    }
+
+    size_t count = 0;
+    size_t inTransaction = 0;
+    bool open = beginTransaction();
+    while (ordered)
+    {
+        Node* node = ordered;
+        ordered = node->next;
+        try
+        {
+            sink_->insert(node->result);
+        }
+        catch (CppSQLite3Exception& e)
+        {
+            LOG_ERROR("Error inserting data: %s", e.errorMessage());
+        }
+        catch (std::exception& e)
+        {
+            LOG_ERROR("Error inserting data: %s", e.what());
+        }
+        delete node;
+        ++count;
+        if (++inTransaction >= batchRows_ && ordered)
+        {
+            if (open)
+            {
+                commitTransaction();
+            }
+            open = beginTransaction();
+            inTransaction = 0;
+        }
+    }
+    if (open)
+    {
+        commitTransaction();
+    }
+
+    queued_.fetch_sub(count, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        written_ += count;
+    }
+    written_cv_.notify_all();
+}
+
+// 事务开始或提交失败（SQLITE_BUSY、磁盘满等）时记录错误并回滚，写线程继续处理后面的记录
+bool ResultWriter::beginTransaction()
+{
+    try
+    {
+        sink_->beginTransaction();
+        return true;
+    }
+    catch (CppSQLite3Exception& e)
+    {
+        LOG_ERROR("Error beginning transaction: %s", e.errorMessage());
+    }
+    catch (std::exception& e)
+    {
+        LOG_ERROR("Error beginning transaction: %s", e.what());
+    }
+    return false;
+}
+
+void ResultWriter::commitTransaction()
+{
+    try
+    {
+        sink_->commitTransaction();
+        return;
+    }
+    catch (CppSQLite3Exception& e)
+    {
+        LOG_ERROR("Error committing results: %s", e.errorMessage());
+    }
+    catch (std::exception& e)
+    {
+        LOG_ERROR("Error committing results: %s", e.what());
+    }
+    try
+    {
+        sink_->rollbackTransaction();
+    }
+    catch (CppSQLite3Exception& e)
+    {
+        LOG_ERROR("Error rolling back results: %s", e.errorMessage());
+    }
+    catch (std::exception& e)
+    {
+        LOG_ERROR("Error rolling back results: %s", e.what());
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef FUND_RESULTWRITER_HPP_
+#define FUND_RESULTWRITER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "CppSQLite3.h"
+#include "ResultSink.hpp"
+
+// 结果写入线程：计算线程通过无锁链表提交结果，单个写线程独占 sink（连接和预编译语句或列式文件），
+// 攒够 batchRows 行或每隔 flushInterval 提交一次事务
+class ResultWriter
+{
+public:
+    explicit ResultWriter(std::unique_ptr<ResultSink> sink, size_t batchRows = 1000,
+        std::chrono::milliseconds flushInterval = std::chrono::milliseconds(50));
+    ~ResultWriter();
+
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+
+    void add(FundResult result);
+
+    // 阻塞直到此前提交的记录全部写入并提交
+    void flush();
+
+private:
+    struct Node
+    {
+        FundResult result;
+        Node* next = nullptr;
+    };
+
+    void push(Node* node);
+    void run();
+    void write(Node* list);
+    bool beginTransaction();
+    void commitTransaction();
+
+    std::unique_ptr<ResultSink> sink_;
+    const size_t batchRows_;
+    const std::chrono::milliseconds flushInterval_;
+
+    std::atomic<Node*> head_{nullptr};
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> submitted_{0};
+    size_t written_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable written_cv_;
+    bool flushRequested_ = false;
+    bool stop_ = false;
+
+    std::thread thread_;
+};
+
+#endif  // FUND_RESULTWRITER_HPP_
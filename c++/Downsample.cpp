@@ -0,0 +1,118 @@
+#include "Downsample.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+std::vector<size_t> all_points(size_t n)
+{
+    std::vector<size_t> indices(n);
+    std::iota(indices.begin(), indices.end(), 0);
+    return indices;
+}
+
+// 合并必须保留的点，排序去重
+std::vector<size_t> merge_kept(std::vector<size_t> selected, const std::vector<size_t>& keep, size_t n)
+{
+    for (size_t index : keep) {
+        if (index < n) {
+            selected.push_back(index);
+        }
+    }
+    std::sort(selected.begin(), selected.end());
+    selected.erase(std::unique(selected.begin(), selected.end()), selected.end());
+    return selected;
+}
+
+}  // namespace
+
+std::vector<size_t> downsample_m4(std::span<const long> timestamps, std::span<const double> values,
+    size_t width, const std::vector<size_t>& keep)
+{
+    const size_t n = values.size();
+    if (width == 0 || n <= 4 * width) {
+        return all_points(n);
+    }
+    const long first_timestamp = timestamps[0];
+    const long range = timestamps[n - 1] - first_timestamp + 1;
+    std::vector<size_t> selected;
+    selected.reserve(4 * width + keep.size());
+
+    size_t column_first = 0, column_min = 0, column_max = 0;
+    long column = 0;
+    auto flush = [&](size_t column_last) {
+        selected.push_back(column_first);
+        selected.push_back(column_min);
+        selected.push_back(column_max);
+        selected.push_back(column_last);
+    };
+    for (size_t i = 0; i < n; ++i) {
+        long current = (timestamps[i] - first_timestamp) * static_cast<long>(width) / range;
+        if (i == 0 || current != column) {
+            if (i > 0) {
+                flush(i - 1);
+            }
+            column = current;
+            column_first = column_min = column_max = i;
+            continue;
+        }
+        if (values[i] < values[column_min]) {
+            column_min = i;
+        }
+        if (values[i] > values[column_max]) {
+            column_max = i;
+        }
+    }
+    flush(n - 1);
+    return merge_kept(std::move(selected), keep, n);
+}
+
+std::vector<size_t> downsample_lttb(std::span<const long> timestamps, std::span<const double> values,
+    size_t width, const std::vector<size_t>& keep)
+{
+    const size_t n = values.size();
+    if (width < 3 || n <= width) {
+        return all_points(n);
+    }
+    std::vector<size_t> selected;
+    selected.reserve(width + keep.size());
+    selected.push_back(0);
+
+    // 首尾两点之外的点平均分成 width - 2 个桶，每个桶选出与上一个选中点、下一个桶平均点所成三角形面积最大的点
+    const double bucket_size = static_cast<double>(n - 2) / static_cast<double>(width - 2);
+    size_t previous = 0;
+    for (size_t bucket = 0; bucket < width - 2; ++bucket) {
+        size_t begin = static_cast<size_t>(std::floor(bucket * bucket_size)) + 1;
+        size_t end = static_cast<size_t>(std::floor((bucket + 1) * bucket_size)) + 1;
+        size_t next_begin = end;
+        size_t next_end = std::min(static_cast<size_t>(std::floor((bucket + 2) * bucket_size)) + 1, n);
+
+        double average_x = 0, average_y = 0;
+        for (size_t i = next_begin; i < next_end; ++i) {
+            average_x += static_cast<double>(timestamps[i]);
+            average_y += values[i];
+        }
+        double count = static_cast<double>(next_end - next_begin);
+        average_x /= count;
+        average_y /= count;
+
+        const double previous_x = static_cast<double>(timestamps[previous]);
+        const double previous_y = values[previous];
+        double largest_area = -1;
+        size_t chosen = begin;
+        for (size_t i = begin; i < end; ++i) {
+            double area = std::abs((previous_x - average_x) * (values[i] - previous_y)
+                - (previous_x - static_cast<double>(timestamps[i])) * (average_y - previous_y));
+            if (area > largest_area) {
+                largest_area = area;
+                chosen = i;
+            }
+        }
+        selected.push_back(chosen);
+        previous = chosen;
+    }
+    selected.push_back(n - 1);
+    return merge_kept(std::move(selected), keep, n);
+}
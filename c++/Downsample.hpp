@@ -0,0 +1,21 @@
+#ifndef FUND_DOWNSAMPLE_HPP_
+#define FUND_DOWNSAMPLE_HPP_
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// 图表用的曲线降采样。结果是要保留的点的下标，按升序排列，调用者据此取出时间戳和值；
+// keep 中的下标（交易日）总是保留，交易标记正好落在曲线的点上
+
+// M4：按像素列把时间轴分成 width 段，每段保留第一个、最后一个、最小和最大的点，
+// 按 width 像素画成折线时与原序列逐像素相同。最多 4 * width + keep.size() 个点
+std::vector<size_t> downsample_m4(std::span<const long> timestamps, std::span<const double> values,
+    size_t width, const std::vector<size_t>& keep);
+
+// LTTB（Largest-Triangle-Three-Buckets）：保留 width 个形状上最重要的点，点数比 M4 少，
+// 但不保证每段的极值都被保留
+std::vector<size_t> downsample_lttb(std::span<const long> timestamps, std::span<const double> values,
+    size_t width, const std::vector<size_t>& keep);
+
+#endif  // FUND_DOWNSAMPLE_HPP_
@@ -0,0 +1,225 @@
+#include "FundData.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+// 自己计算时各数组的存储
+struct FundData::Storage
+{
+    std::vector<long> timestamps;
+    std::vector<double> prices;
+    std::vector<double> price_sum;
+    std::vector<double> price_square_sum;
+    std::vector<double> log_return_square_sum;
+    std::vector<double> block_min;
+    std::vector<double> block_max;
+};
+
+FundData::FundData(const std::map<long, double>& net_worth_data)
+{
+    std::vector<long> timestamps;
+    std::vector<double> prices;
+    timestamps.reserve(net_worth_data.size());
+    prices.reserve(net_worth_data.size());
+    for (const auto& item : net_worth_data) {
+        timestamps.push_back(item.first);
+        prices.push_back(item.second);
+    }
+    *this = FundData(std::move(timestamps), std::move(prices));
+}
+
+FundData::FundData(std::vector<long> timestamps, std::vector<double> prices)
+{
+    auto storage = std::make_shared<Storage>();
+    storage->timestamps = std::move(timestamps);
+    storage->prices = std::move(prices);
+
+    size_t n = storage->prices.size();
+    storage->price_sum.resize(n + 1);
+    storage->price_square_sum.resize(n + 1);
+    storage->log_return_square_sum.resize(n);
+    storage->block_min.resize(block_table_size(n));
+    storage->block_max.resize(block_table_size(n));
+    build_index(n, storage->prices.data(), storage->price_sum.data(), storage->price_square_sum.data(),
+        storage->log_return_square_sum.data(), storage->block_min.data(), storage->block_max.data());
+
+    Arrays arrays;
+    arrays.timestamps = storage->timestamps.data();
+    arrays.prices = storage->prices.data();
+    arrays.price_sum = storage->price_sum.data();
+    arrays.price_square_sum = storage->price_square_sum.data();
+    arrays.log_return_square_sum = storage->log_return_square_sum.data();
+    arrays.block_min = storage->block_min.data();
+    arrays.block_max = storage->block_max.data();
+    bind(n, arrays);
+    owner_ = std::move(storage);
+}
+
+void FundData::build_index(size_t n, const double* p, double* price_sum, double* price_square_sum,
+    double* log_return_square_sum, double* block_min, double* block_max)
+{
+    price_sum[0] = 0;
+    price_square_sum[0] = 0;
+    for (size_t i = 0; i < n; ++i) {
+        price_sum[i + 1] = price_sum[i] + p[i];
+        price_square_sum[i + 1] = price_square_sum[i] + p[i] * p[i];
+        if (i > 0) {
+            double r = (p[i - 1] > 0 && p[i] > 0) ? std::log(p[i] / p[i - 1]) : 0;
+            log_return_square_sum[i] = log_return_square_sum[i - 1] + r * r;
+        } else {
+            log_return_square_sum[i] = 0;
+        }
+    }
+
+    // 第 0 层是每块的最值，第 k 层由第 k - 1 层相隔 2^(k-1) 的两项合并
+    size_t blocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    std::vector<size_t> offsets = level_offsets(blocks);
+    for (size_t b = 0; b < blocks; ++b) {
+        const double* first = p + b * BLOCK_SIZE;
+        const double* last = p + std::min(n, (b + 1) * BLOCK_SIZE);
+        block_min[b] = *std::min_element(first, last);
+        block_max[b] = *std::max_element(first, last);
+    }
+    for (size_t k = 1; k + 1 < offsets.size(); ++k) {
+        size_t half = size_t(1) << (k - 1);
+        size_t count = blocks - (size_t(1) << k) + 1;
+        for (size_t i = 0; i < count; ++i) {
+            size_t a = offsets[k - 1] + i;
+            block_min[offsets[k] + i] = std::min(block_min[a], block_min[a + half]);
+            block_max[offsets[k] + i] = std::max(block_max[a], block_max[a + half]);
+        }
+    }
+}
+
+FundData FundData::view(size_t size, const Arrays& arrays, std::shared_ptr<const void> owner)
+{
+    FundData fund_data;
+    fund_data.bind(size, arrays);
+    fund_data.owner_ = std::move(owner);
+    return fund_data;
+}
+
+FundData FundData::borrow(size_t size, const long* timestamps, const double* prices)
+{
+    FundData fund_data;
+    fund_data.timestamps_ = std::span<const long>(timestamps, size);
+    fund_data.prices_ = std::span<const double>(prices, size);
+    return fund_data;
+}
+
+void FundData::bind(size_t size, const Arrays& arrays)
+{
+    size_t table = block_table_size(size);
+    timestamps_ = std::span<const long>(arrays.timestamps, size);
+    prices_ = std::span<const double>(arrays.prices, size);
+    price_sum_ = std::span<const double>(arrays.price_sum, size + 1);
+    price_square_sum_ = std::span<const double>(arrays.price_square_sum, size + 1);
+    log_return_square_sum_ = std::span<const double>(arrays.log_return_square_sum, size);
+    block_min_ = std::span<const double>(arrays.block_min, table);
+    block_max_ = std::span<const double>(arrays.block_max, table);
+    level_offsets_ = level_offsets((size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+}
+
+FundData::Arrays FundData::arrays() const
+{
+    Arrays arrays;
+    arrays.timestamps = timestamps_.data();
+    arrays.prices = prices_.data();
+    arrays.price_sum = price_sum_.data();
+    arrays.price_square_sum = price_square_sum_.data();
+    arrays.log_return_square_sum = log_return_square_sum_.data();
+    arrays.block_min = block_min_.data();
+    arrays.block_max = block_max_.data();
+    return arrays;
+}
+
+// 第 k 层在稀疏表中的起始位置，最后一项是总长度
+std::vector<size_t> FundData::level_offsets(size_t blocks)
+{
+    std::vector<size_t> offsets;
+    size_t offset = 0;
+    for (size_t k = 0; (size_t(1) << k) <= blocks; ++k) {
+        offsets.push_back(offset);
+        offset += blocks - (size_t(1) << k) + 1;
+    }
+    offsets.push_back(offset);
+    return offsets;
+}
+
+size_t FundData::block_table_size(size_t size)
+{
+    return level_offsets((size + BLOCK_SIZE - 1) / BLOCK_SIZE).back();
+}
+
+size_t FundData::lower_bound(long timestamp) const
+{
+    return std::lower_bound(timestamps_.begin(), timestamps_.end(), timestamp) - timestamps_.begin();
+}
+
+template <typename Better>
+double FundData::range_extreme(size_t begin, size_t end, const double* table, Better better) const
+{
+    size_t first_block = (begin + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    size_t last_block = end / BLOCK_SIZE;
+    double result = prices_[begin];
+    auto scan = [&](size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i) {
+            if (better(prices_[i], result)) {
+                result = prices_[i];
+            }
+        }
+    };
+    if (first_block >= last_block) {
+        scan(begin, end);
+        return result;
+    }
+    // 完整的块 [first_block, last_block) 查稀疏表，两端的零头直接扫描
+    size_t k = 63 - __builtin_clzll(static_cast<unsigned long long>(last_block - first_block));
+    double a = table[level_offsets_[k] + first_block];
+    double b = table[level_offsets_[k] + last_block - (size_t(1) << k)];
+    result = better(a, b) ? a : b;
+    scan(begin, first_block * BLOCK_SIZE);
+    scan(last_block * BLOCK_SIZE, end);
+    return result;
+}
+
+double FundData::range_min(size_t begin, size_t end) const
+{
+    return range_extreme(begin, end, block_min_.data(), std::less<double>());
+}
+
+double FundData::range_max(size_t begin, size_t end) const
+{
+    return range_extreme(begin, end, block_max_.data(), std::greater<double>());
+}
+
+RangeStats FundData::range_stats(size_t begin, size_t end) const
+{
+    RangeStats stats;
+    end = std::min(end, size());
+    if (begin >= end) {
+        return stats;
+    }
+
+    double n = static_cast<double>(end - begin);
+    stats.days = end - begin;
+    stats.min_price = range_min(begin, end);
+    stats.max_price = range_max(begin, end);
+    stats.mean_price = (price_sum_[end] - price_sum_[begin]) / n;
+    double variance = (price_square_sum_[end] - price_square_sum_[begin]) / n - stats.mean_price * stats.mean_price;
+    stats.stdev_price = std::sqrt(std::max(variance, 0.0));
+
+    // 对数收益率之和可直接由首尾价格得到，只需平方和的前缀
+    size_t returns = end - begin - 1;
+    if (returns > 0 && prices_[begin] > 0 && prices_[end - 1] > 0) {
+        double mean_return = std::log(prices_[end - 1] / prices_[begin]) / returns;
+        double square_sum = log_return_square_sum_[end - 1] - log_return_square_sum_[begin];
+        double return_variance = square_sum / returns - mean_return * mean_return;
+        stats.volatility = std::sqrt(std::max(return_variance, 0.0));
+    }
+    if (prices_[begin] > 0) {
+        stats.buy_and_hold_return = prices_[end - 1] / prices_[begin] - 1;
+    }
+    return stats;
+}
@@ -0,0 +1,107 @@
+#ifndef FUND_FUNDDATA_HPP_
+#define FUND_FUNDDATA_HPP_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <span>
+#include <vector>
+
+// 区间 [begin, end) 的统计结果
+struct RangeStats
+{
+    size_t days = 0;
+    double min_price = 0;
+    double max_price = 0;
+    double mean_price = 0;
+    double stdev_price = 0;
+    double volatility = 0;          // 日对数收益率的标准差
+    double buy_and_hold_return = 0; // 区间首日买入持有到末日的收益率
+};
+
+// 净值时间戳为北京时间零点，换算成自 1970-01-01 起的天数
+inline int day_index(long timestamp)
+{
+    return static_cast<int>((timestamp + 8 * 3600) / 86400);
+}
+
+// 列式存储的净值序列，加载时预计算前缀和与分块稀疏表，任意区间统计 O(1)。
+// 各数组可以由自己计算持有，也可以直接指向外部内存（映射的快照文件），复制时共享同一份数组
+class FundData
+{
+public:
+    // 稀疏表按块建立，区间两端不足一块的部分直接扫描
+    static const size_t BLOCK_SIZE = 32;
+
+    // 全部数组，长度都由 size 决定：timestamps/prices/log_return_square_sum 为 size，
+    // price_sum/price_square_sum 为 size + 1，block_min/block_max 为 block_table_size(size)
+    struct Arrays
+    {
+        const long* timestamps = nullptr;
+        const double* prices = nullptr;
+        const double* price_sum = nullptr;
+        const double* price_square_sum = nullptr;
+        const double* log_return_square_sum = nullptr;
+        const double* block_min = nullptr;
+        const double* block_max = nullptr;
+    };
+
+    FundData() = default;
+    explicit FundData(const std::map<long, double>& net_worth_data);
+    FundData(std::vector<long> timestamps, std::vector<double> prices);
+
+    // 使用 owner 持有的内存中已计算好的数组，不复制也不重新计算
+    static FundData view(size_t size, const Arrays& arrays, std::shared_ptr<const void> owner);
+    // 直接引用调用者的时间戳和净值，不复制也不建立索引，调用者保证内存在使用期间有效。
+    // 只能用于回测（run_grid、get_start_date 等），不能做区间统计
+    static FundData borrow(size_t size, const long* timestamps, const double* prices);
+    static size_t block_table_size(size_t size);
+    // 由 prices 计算其余各数组，写入调用者提供的内存（长度见 Arrays）。
+    // 构造函数和直接生成到快照文件中的序列使用同一份计算，结果逐位相同
+    static void build_index(size_t size, const double* prices, double* price_sum, double* price_square_sum,
+        double* log_return_square_sum, double* block_min, double* block_max);
+
+    size_t size() const { return prices_.size(); }
+    bool empty() const { return prices_.empty(); }
+
+    long timestamp(size_t i) const { return timestamps_[i]; }
+    double price(size_t i) const { return prices_[i]; }
+    std::span<const long> timestamps() const { return timestamps_; }
+    std::span<const double> prices() const { return prices_; }
+    Arrays arrays() const;
+
+    // 第一个时间戳 >= timestamp 的下标，不存在时返回 size()
+    size_t lower_bound(long timestamp) const;
+
+    double range_min(size_t begin, size_t end) const;
+    double range_max(size_t begin, size_t end) const;
+    RangeStats range_stats(size_t begin, size_t end) const;
+
+private:
+    struct Storage;
+
+    void bind(size_t size, const Arrays& arrays);
+    static std::vector<size_t> level_offsets(size_t blocks);
+
+    template <typename Better>
+    double range_extreme(size_t begin, size_t end, const double* table, Better better) const;
+
+    // 数组所在内存的持有者：Storage 或映射的快照文件
+    std::shared_ptr<const void> owner_;
+
+    std::span<const long> timestamps_;
+    std::span<const double> prices_;
+
+    // 前缀和，长度 n + 1
+    std::span<const double> price_sum_;
+    std::span<const double> price_square_sum_;
+    // 第 i 项为 ln(p[i] / p[i-1]) 平方的前缀和，长度 n
+    std::span<const double> log_return_square_sum_;
+
+    // 分块稀疏表：第 k 层第 i 项为第 [i, i + 2^k) 块的最小/最大值，各层依次存放
+    std::span<const double> block_min_;
+    std::span<const double> block_max_;
+    std::vector<size_t> level_offsets_;
+};
+
+#endif  // FUND_FUNDDATA_HPP_
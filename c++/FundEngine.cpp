@@ -0,0 +1,215 @@
+#include "FundEngine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FundData.hpp"
+#include "GridEngine.hpp"
+#include "Logger.hpp"
+#include "ThreadPool.hpp"
+
+static_assert(sizeof(long) == sizeof(int64_t), "timestamps are passed through as long");
+static_assert(sizeof(FundEngineTrade) == 40 && sizeof(FundEngineResult) == 80, "FundEngine ABI layout changed");
+
+namespace {
+
+const std::string FUND_CODE = "engine";
+const FundEngineParameters DEFAULT_PARAMETERS = {0.05, 0.3, 3, 40500, 2000, 0.1, 0.5};
+// 参数组数少于此值时不值得分给线程池
+const size_t SWEEP_BATCH = 16;
+
+// 嵌入时不输出逐笔的资金不足等 INFO 日志
+void init_once()
+{
+    static std::once_flag once;
+    std::call_once(once, []() { Logger::instance().set_level(LogLevel::WARN); });
+}
+
+// 调用者的序列直接作为 FundData 使用；没有时间戳时用交易日的位置代替（只有这种情况需要分配）
+struct BorrowedSeries
+{
+    std::vector<long> positions;
+    FundData data;
+
+    explicit BorrowedSeries(const FundEngineSeries& series)
+    {
+        const long* timestamps = reinterpret_cast<const long*>(series.timestamps);
+        if (!timestamps) {
+            positions.resize(series.size);
+            std::iota(positions.begin(), positions.end(), 0L);
+            timestamps = positions.data();
+        }
+        data = FundData::borrow(series.size, timestamps, series.prices);
+    }
+};
+
+bool valid_series(const FundEngineSeries* series)
+{
+    return series && series->prices && series->size > 0;
+}
+
+bool valid_range(const FundEngineSeries* series, size_t start, size_t end)
+{
+    return valid_series(series) && start < end && end <= series->size;
+}
+
+ResultParameters to_parameters(const FundEngineParameters& p)
+{
+    return ResultParameters{p.grid_size, p.big_grid_size, p.factor, p.sum, p.amount, p.threshold_low, p.threshold_high};
+}
+
+void to_result(const GridOutcome& outcome, FundEngineResult& result)
+{
+    result.percentile_high = outcome.thresholds.percentile_high;
+    result.percentile_low = outcome.thresholds.percentile_low;
+    result.balance = outcome.balance;
+    result.holdings = outcome.holdings;
+    result.latest_price = outcome.latest_price;
+    result.holdings_value = outcome.holdings_value();
+    result.total_value = outcome.total_value();
+    result.total_profit = outcome.total_profit;
+    result.touched_lowest_balance = outcome.touched_lowest_balance;
+    result.trade_count = outcome.operations.size();
+}
+
+void to_trade(const TradeOperation& operation, FundEngineTrade& trade)
+{
+    trade = FundEngineTrade{};
+    trade.buy_timestamp = operation.buy_timestamp;
+    trade.buy_price = operation.buy_price;
+    trade.sell_timestamp = operation.sell_timestamp;
+    trade.sell_price = operation.sell_price;
+    trade.money_not_enough = operation.money_not_enough;
+    trade.big_grid_size = operation.big_grid_size;
+    trade.dealed = operation.dealed;
+}
+
+}  // namespace
+
+int fund_engine_abi_version(void)
+{
+    return FUND_ENGINE_ABI_VERSION;
+}
+
+uint64_t fund_engine_version(void)
+{
+    return ENGINE_VERSION;
+}
+
+const char* fund_engine_status_message(int status)
+{
+    switch (status) {
+        case FUND_ENGINE_OK: return "ok";
+        case FUND_ENGINE_INVALID_ARGUMENT: return "invalid argument";
+        case FUND_ENGINE_OUT_OF_MEMORY: return "out of memory";
+        case FUND_ENGINE_INTERNAL_ERROR: return "internal error";
+        default: return "unknown status";
+    }
+}
+
+void fund_engine_default_parameters(FundEngineParameters* parameters)
+{
+    if (parameters) {
+        *parameters = DEFAULT_PARAMETERS;
+    }
+}
+
+int fund_engine_period_range(const FundEngineSeries* series, int period, size_t* start, size_t* end)
+{
+    // 周期按时间戳截取，用交易日位置代替时间戳时没有意义
+    if (!valid_series(series) || !series->timestamps || !start || !end
+        || period < LAST_3_MONTHS || period > CUSTOMIZED_TIME) {
+        return FUND_ENGINE_INVALID_ARGUMENT;
+    }
+    try {
+        BorrowedSeries borrowed(*series);
+        *start = get_start_date(borrowed.data, std::to_string(period));
+        *end = get_end_date(borrowed.data, std::to_string(period));
+    } catch (const std::bad_alloc&) {
+        return FUND_ENGINE_OUT_OF_MEMORY;
+    } catch (...) {
+        return FUND_ENGINE_INTERNAL_ERROR;
+    }
+    return FUND_ENGINE_OK;
+}
+
+int fund_engine_run(const FundEngineSeries* series, size_t start, size_t end,
+    const FundEngineParameters* parameters, FundEngineResult* result,
+    FundEngineTrade* trades, size_t trade_capacity, double* equity)
+{
+    if (!valid_range(series, start, end) || !parameters || !result || (!trades && trade_capacity > 0)) {
+        return FUND_ENGINE_INVALID_ARGUMENT;
+    }
+    try {
+        init_once();
+        BorrowedSeries borrowed(*series);
+        std::vector<double> equity_curve;
+        GridOutcome outcome = run_grid(FUND_CODE, borrowed.data, start, end, to_parameters(*parameters),
+            equity ? &equity_curve : nullptr);
+        to_result(outcome, *result);
+        size_t shown = std::min(trade_capacity, outcome.operations.size());
+        for (size_t i = 0; i < shown; ++i) {
+            to_trade(outcome.operations[i], trades[i]);
+        }
+        if (equity) {
+            std::copy(equity_curve.begin(), equity_curve.end(), equity);
+        }
+    } catch (const std::bad_alloc&) {
+        return FUND_ENGINE_OUT_OF_MEMORY;
+    } catch (...) {
+        return FUND_ENGINE_INTERNAL_ERROR;
+    }
+    return FUND_ENGINE_OK;
+}
+
+int fund_engine_sweep(const FundEngineSeries* series, size_t start, size_t end,
+    const FundEngineParameters* parameters, size_t count, FundEngineResult* results, unsigned threads)
+{
+    if (!valid_range(series, start, end) || (count > 0 && (!parameters || !results))) {
+        return FUND_ENGINE_INVALID_ARGUMENT;
+    }
+    std::atomic<bool> out_of_memory{false};
+    std::atomic<bool> failed{false};
+    try {
+        init_once();
+        BorrowedSeries borrowed(*series);
+        auto run_batch = [&](size_t first, size_t last) {
+            try {
+                for (size_t i = first; i < last; ++i) {
+                    to_result(run_grid(FUND_CODE, borrowed.data, start, end, to_parameters(parameters[i])), results[i]);
+                }
+            } catch (const std::bad_alloc&) {
+                out_of_memory.store(true, std::memory_order_relaxed);
+            } catch (...) {
+                failed.store(true, std::memory_order_relaxed);
+            }
+        };
+        size_t workers = threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+        workers = std::min(workers, (count + SWEEP_BATCH - 1) / SWEEP_BATCH);
+        if (workers <= 1) {
+            run_batch(0, count);
+        } else {
+            ThreadPool pool(workers);
+            for (size_t first = 0; first < count; first += SWEEP_BATCH) {
+                pool.post([&run_batch, first, count]() { run_batch(first, std::min(first + SWEEP_BATCH, count)); });
+            }
+            pool.wait_idle();
+        }
+    } catch (const std::bad_alloc&) {
+        return FUND_ENGINE_OUT_OF_MEMORY;
+    } catch (...) {
+        return FUND_ENGINE_INTERNAL_ERROR;
+    }
+    if (out_of_memory.load()) {
+        return FUND_ENGINE_OUT_OF_MEMORY;
+    }
+    return failed.load() ? FUND_ENGINE_INTERNAL_ERROR : FUND_ENGINE_OK;
+}
+
+// 编译命令（共享库）：g++ -O2 -shared -fPIC -fvisibility=hidden -DFUND_NO_TRACE -DFUND_NO_ALLOC_HOOKS -o libfundengine.so FundEngine.cpp FundData.cpp GridEngine.cpp ThreadPool.cpp Logger.cpp ReportWriter.cpp ResultCache.cpp Trace.cpp PerfCounters.cpp AllocTracker.cpp -lpthread -std=c++20
@@ -0,0 +1,108 @@
+#ifndef FUND_FUNDENGINE_H_
+#define FUND_FUNDENGINE_H_
+
+/*
+ * 网格回测引擎的 C 接口，供 Python 等其他语言嵌入。净值由调用者的内存直接传入，不复制；
+ * 参数和结果都是定长结构体，结果写入调用者提供的缓冲区，引擎内部不保留任何状态，可以多线程同时调用。
+ * 计算与批量运行的 run_grid 完全相同（同一份代码）。
+ *
+ * 兼容约定：FUND_ENGINE_ABI_VERSION 不变时，已有函数的签名和结构体布局不变，只会在末尾增加函数；
+ * 结构体需要扩展时增加 ABI 版本。调用者可以用 fund_engine_abi_version() 检查加载的库
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define FUND_ENGINE_API __attribute__((visibility("default")))
+#else
+#define FUND_ENGINE_API
+#endif
+
+#define FUND_ENGINE_ABI_VERSION 1
+
+/* 返回值 */
+#define FUND_ENGINE_OK 0
+#define FUND_ENGINE_INVALID_ARGUMENT -1 /* 空指针、空序列或区间不满足 start < end <= size */
+#define FUND_ENGINE_OUT_OF_MEMORY -2
+#define FUND_ENGINE_INTERNAL_ERROR -3   /* 其他内部错误，例如无法创建线程 */
+
+/* 净值序列：prices 为 size 个净值；timestamps 为对应的秒级时间戳（北京时间零点），
+ * 可以为 NULL，此时交易记录中的时间为交易日在序列中的位置（fund_engine_period_range 必须有时间戳） */
+typedef struct FundEngineSeries
+{
+    const int64_t* timestamps;
+    const double* prices;
+    size_t size;
+} FundEngineSeries;
+
+/* 网格参数，含义同 config.txt 的同名配置 */
+typedef struct FundEngineParameters
+{
+    double grid_size;
+    double big_grid_size;
+    int32_t factor;
+    double sum;
+    double amount;
+    double threshold_low;
+    double threshold_high;
+} FundEngineParameters;
+
+/* 区间 [start, end) 的回测结果 */
+typedef struct FundEngineResult
+{
+    double percentile_high;
+    double percentile_low;
+    double balance;
+    double holdings;
+    double latest_price;  /* 估值用的净值：区间后的第一个净值，区间截止于序列末尾时取最后一个 */
+    double holdings_value;
+    double total_value;
+    double total_profit;
+    double touched_lowest_balance;
+    uint64_t trade_count; /* 全部交易的笔数，可能多于 trades 缓冲区能容纳的 */
+} FundEngineResult;
+
+typedef struct FundEngineTrade
+{
+    int64_t buy_timestamp;
+    double buy_price;
+    int64_t sell_timestamp; /* 未卖出时为 0 */
+    double sell_price;
+    uint8_t money_not_enough;
+    uint8_t big_grid_size;
+    uint8_t dealed;
+    uint8_t reserved[5];
+} FundEngineTrade;
+
+FUND_ENGINE_API int fund_engine_abi_version(void);
+/* 计算逻辑版本，即结果缓存使用的 ENGINE_VERSION */
+FUND_ENGINE_API uint64_t fund_engine_version(void);
+FUND_ENGINE_API const char* fund_engine_status_message(int status);
+
+/* config.txt 中的默认参数 */
+FUND_ENGINE_API void fund_engine_default_parameters(FundEngineParameters* parameters);
+
+/* 周期（0 近三月 … 5 成立以来，6 自定义）对应的区间，与批量运行的 period 配置相同。
+ * 周期按时间戳截取，series->timestamps 为 NULL 时返回 FUND_ENGINE_INVALID_ARGUMENT */
+FUND_ENGINE_API int fund_engine_period_range(const FundEngineSeries* series, int period, size_t* start, size_t* end);
+
+/* 回测一次。trades 可以为 NULL，最多写入 trade_capacity 笔；
+ * equity 非 NULL 时写入每个交易日收盘后的总资产，长度为 end - start */
+FUND_ENGINE_API int fund_engine_run(const FundEngineSeries* series, size_t start, size_t end,
+    const FundEngineParameters* parameters, FundEngineResult* result,
+    FundEngineTrade* trades, size_t trade_capacity, double* equity);
+
+/* 同一区间上的 count 组参数，结果依次写入 results。threads 为 0 时使用全部核心，为 1 时在调用线程中计算 */
+FUND_ENGINE_API int fund_engine_sweep(const FundEngineSeries* series, size_t start, size_t end,
+    const FundEngineParameters* parameters, size_t count, FundEngineResult* results, unsigned threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FUND_FUNDENGINE_H_ */
@@ -0,0 +1,402 @@
+// Python 扩展 fundengine：FundEngine.h 的薄封装。净值、时间戳和输出数组通过缓冲区协议直接使用
+// （numpy 数组、array.array、memoryview 均可），不复制；计算期间释放 GIL，多个 Python 线程可以同时回测。
+//
+//   import numpy as np, fundengine
+//   prices = np.ascontiguousarray(df["net_value"], dtype=np.float64)
+//   timestamps = (df["date"].values.astype("datetime64[s]").astype(np.int64) - 8 * 3600)  # 北京时间零点的秒数
+//   r = fundengine.run(prices, timestamps, grid_size=0.04, trades=True)
+//   grid = np.array([[g, 0.3, 3, 40500, 2000, 0.1, 0.5] for g in np.arange(0.01, 0.1, 0.001)])
+//   out = np.asarray(fundengine.sweep(prices, grid, timestamps))   # 每行对应 RESULT_FIELDS
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "FundEngine.h"
+
+namespace {
+
+const char* const PARAMETER_FIELDS[] = {
+    "grid_size", "big_grid_size", "factor", "sum", "amount", "threshold_low", "threshold_high"};
+const size_t PARAMETER_COUNT = 7;
+const char* const RESULT_FIELDS[] = {
+    "percentile_high", "percentile_low", "balance", "holdings", "latest_price", "holdings_value",
+    "total_value", "total_profit", "touched_lowest_balance", "trade_count"};
+const size_t RESULT_COUNT = 10;
+const char* const TRADE_FIELDS[] = {
+    "buy_timestamp", "buy_price", "sell_timestamp", "sell_price", "money_not_enough", "big_grid_size", "dealed"};
+const size_t TRADE_COUNT = 7;
+
+// 持有一个导出的缓冲区，析构时释放
+class Buffer
+{
+public:
+    Buffer() { std::memset(&view_, 0, sizeof(view_)); }
+    ~Buffer()
+    {
+        if (held_) {
+            PyBuffer_Release(&view_);
+        }
+    }
+
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+
+    // 要求 C 连续、元素为 8 字节的 kind（'d' 浮点或 'q' 整数）；失败时设置 Python 异常
+    bool acquire(PyObject* object, char kind, bool writable, const char* name)
+    {
+        int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+        if (PyObject_GetBuffer(object, &view_, flags) != 0) {
+            return false;
+        }
+        held_ = true;
+        const char* format = view_.format ? view_.format : "B";
+        if (*format == '@' || *format == '=' || *format == '<') {
+            ++format;
+        }
+        bool matches = view_.itemsize == 8 && format[1] == '\0'
+            && (kind == 'd' ? format[0] == 'd' : (format[0] == 'q' || format[0] == 'l'));
+        if (!matches) {
+            PyErr_Format(PyExc_TypeError, "%s must be a contiguous %s array", name, kind == 'd' ? "float64" : "int64");
+            return false;
+        }
+        return true;
+    }
+
+    size_t size() const { return static_cast<size_t>(view_.len / 8); }
+    template <typename T>
+    T* data() const { return static_cast<T*>(view_.buf); }
+
+private:
+    Py_buffer view_;
+    bool held_ = false;
+};
+
+bool check_status(int status)
+{
+    if (status == FUND_ENGINE_OUT_OF_MEMORY) {
+        PyErr_NoMemory();
+        return false;
+    }
+    if (status != FUND_ENGINE_OK) {
+        PyErr_SetString(status == FUND_ENGINE_INVALID_ARGUMENT ? PyExc_ValueError : PyExc_RuntimeError,
+            fund_engine_status_message(status));
+        return false;
+    }
+    return true;
+}
+
+// 净值、可选的时间戳和区间；end 为 -1 时到序列末尾
+bool make_series(PyObject* prices_object, PyObject* timestamps_object, Py_ssize_t start, Py_ssize_t end,
+    Buffer& prices, Buffer& timestamps, FundEngineSeries& series, size_t& range_start, size_t& range_end)
+{
+    if (!prices.acquire(prices_object, 'd', false, "prices")) {
+        return false;
+    }
+    series.prices = prices.data<const double>();
+    series.size = prices.size();
+    series.timestamps = nullptr;
+    if (timestamps_object && timestamps_object != Py_None) {
+        if (!timestamps.acquire(timestamps_object, 'q', false, "timestamps")) {
+            return false;
+        }
+        if (timestamps.size() != series.size) {
+            PyErr_SetString(PyExc_ValueError, "timestamps and prices must have the same length");
+            return false;
+        }
+        series.timestamps = timestamps.data<const int64_t>();
+    }
+    if (end < 0) {
+        end = static_cast<Py_ssize_t>(series.size);
+    }
+    if (start < 0 || start >= end || static_cast<size_t>(end) > series.size) {
+        PyErr_Format(PyExc_ValueError, "range [%zd, %zd) is not within the %zu prices", start, end, series.size);
+        return false;
+    }
+    range_start = static_cast<size_t>(start);
+    range_end = static_cast<size_t>(end);
+    return true;
+}
+
+PyObject* result_dict(const FundEngineResult& result)
+{
+    const double values[] = {result.percentile_high, result.percentile_low, result.balance, result.holdings,
+        result.latest_price, result.holdings_value, result.total_value, result.total_profit,
+        result.touched_lowest_balance};
+    PyObject* dict = PyDict_New();
+    if (!dict) {
+        return nullptr;
+    }
+    for (size_t i = 0; i + 1 < RESULT_COUNT; ++i) {
+        PyObject* value = PyFloat_FromDouble(values[i]);
+        if (!value || PyDict_SetItemString(dict, RESULT_FIELDS[i], value) != 0) {
+            Py_XDECREF(value);
+            Py_DECREF(dict);
+            return nullptr;
+        }
+        Py_DECREF(value);
+    }
+    PyObject* count = PyLong_FromUnsignedLongLong(result.trade_count);
+    if (!count || PyDict_SetItemString(dict, "trade_count", count) != 0) {
+        Py_XDECREF(count);
+        Py_DECREF(dict);
+        return nullptr;
+    }
+    Py_DECREF(count);
+    return dict;
+}
+
+PyObject* trade_list(const std::vector<FundEngineTrade>& trades, size_t count)
+{
+    PyObject* list = PyList_New(static_cast<Py_ssize_t>(count));
+    if (!list) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const FundEngineTrade& trade = trades[i];
+        PyObject* item = Py_BuildValue("(LdLdOOO)", static_cast<long long>(trade.buy_timestamp), trade.buy_price,
+            static_cast<long long>(trade.sell_timestamp), trade.sell_price, trade.money_not_enough ? Py_True : Py_False,
+            trade.big_grid_size ? Py_True : Py_False, trade.dealed ? Py_True : Py_False);
+        if (!item) {
+            Py_DECREF(list);
+            return nullptr;
+        }
+        PyList_SET_ITEM(list, static_cast<Py_ssize_t>(i), item);
+    }
+    return list;
+}
+
+PyObject* engine_run(PyObject*, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {"prices", "timestamps", "start", "end", "grid_size", "big_grid_size", "factor",
+        "sum", "amount", "threshold_low", "threshold_high", "trades", "equity", nullptr};
+    PyObject* prices_object = nullptr;
+    PyObject* timestamps_object = nullptr;
+    Py_ssize_t start = 0;
+    Py_ssize_t end = -1;
+    FundEngineParameters parameters;
+    fund_engine_default_parameters(&parameters);
+    int want_trades = 0;
+    PyObject* equity_object = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|Onn$ddiddddpO", const_cast<char**>(keywords),
+            &prices_object, &timestamps_object, &start, &end, &parameters.grid_size, &parameters.big_grid_size,
+            &parameters.factor, &parameters.sum, &parameters.amount, &parameters.threshold_low,
+            &parameters.threshold_high, &want_trades, &equity_object)) {
+        return nullptr;
+    }
+    Buffer prices, timestamps, equity;
+    FundEngineSeries series;
+    size_t range_start = 0, range_end = 0;
+    if (!make_series(prices_object, timestamps_object, start, end, prices, timestamps, series, range_start, range_end)) {
+        return nullptr;
+    }
+    double* equity_data = nullptr;
+    if (equity_object && equity_object != Py_None) {
+        if (!equity.acquire(equity_object, 'd', true, "equity")) {
+            return nullptr;
+        }
+        if (equity.size() != range_end - range_start) {
+            PyErr_SetString(PyExc_ValueError, "equity must have one element per trading day in the range");
+            return nullptr;
+        }
+        equity_data = equity.data<double>();
+    }
+    // 每个交易日最多产生一笔交易
+    std::vector<FundEngineTrade> trades(want_trades ? range_end - range_start : 0);
+
+    FundEngineResult result;
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = fund_engine_run(&series, range_start, range_end, &parameters, &result,
+        trades.empty() ? nullptr : trades.data(), trades.size(), equity_data);
+    Py_END_ALLOW_THREADS
+    if (!check_status(status)) {
+        return nullptr;
+    }
+    PyObject* dict = result_dict(result);
+    if (dict && want_trades) {
+        PyObject* list = trade_list(trades, std::min<size_t>(result.trade_count, trades.size()));
+        if (!list || PyDict_SetItemString(dict, "trades", list) != 0) {
+            Py_XDECREF(list);
+            Py_DECREF(dict);
+            return nullptr;
+        }
+        Py_DECREF(list);
+    }
+    return dict;
+}
+
+PyObject* engine_sweep(PyObject*, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {"prices", "parameters", "timestamps", "start", "end", "out", "threads", nullptr};
+    PyObject* prices_object = nullptr;
+    PyObject* parameters_object = nullptr;
+    PyObject* timestamps_object = nullptr;
+    Py_ssize_t start = 0;
+    Py_ssize_t end = -1;
+    PyObject* out_object = nullptr;
+    unsigned int threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|OnnOI", const_cast<char**>(keywords), &prices_object,
+            &parameters_object, &timestamps_object, &start, &end, &out_object, &threads)) {
+        return nullptr;
+    }
+    Buffer prices, timestamps, grid, out;
+    FundEngineSeries series;
+    size_t range_start = 0, range_end = 0;
+    if (!make_series(prices_object, timestamps_object, start, end, prices, timestamps, series, range_start, range_end)) {
+        return nullptr;
+    }
+    if (!grid.acquire(parameters_object, 'd', false, "parameters")) {
+        return nullptr;
+    }
+    if (grid.size() % PARAMETER_COUNT != 0) {
+        PyErr_SetString(PyExc_ValueError, "parameters must have 7 columns (see PARAMETER_FIELDS)");
+        return nullptr;
+    }
+    const size_t count = grid.size() / PARAMETER_COUNT;
+
+    // 没有给出 out 时结果放在新的 bytearray 中，返回形状为 (count, 10) 的 memoryview，np.asarray 可直接使用
+    PyObject* result = nullptr;
+    if (out_object && out_object != Py_None) {
+        Py_INCREF(out_object);
+        result = out_object;
+    } else {
+        PyObject* bytes = PyByteArray_FromStringAndSize(nullptr, static_cast<Py_ssize_t>(count * RESULT_COUNT * 8));
+        PyObject* view = bytes ? PyMemoryView_FromObject(bytes) : nullptr;
+        Py_XDECREF(bytes);
+        if (view) {
+            result = PyObject_CallMethod(view, "cast", "s(nn)", "d", static_cast<Py_ssize_t>(count),
+                static_cast<Py_ssize_t>(RESULT_COUNT));
+            Py_DECREF(view);
+        }
+        if (!result) {
+            return nullptr;
+        }
+    }
+    if (!out.acquire(result, 'd', true, "out")) {
+        Py_DECREF(result);
+        return nullptr;
+    }
+    if (out.size() != count * RESULT_COUNT) {
+        PyErr_SetString(PyExc_ValueError, "out must have 10 columns (see RESULT_FIELDS) per parameter row");
+        Py_DECREF(result);
+        return nullptr;
+    }
+
+    std::vector<FundEngineParameters> parameters(count);
+    std::vector<FundEngineResult> results(count);
+    const double* rows = grid.data<const double>();
+    double* values = out.data<double>();
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i = 0; i < count; ++i) {
+        const double* row = rows + i * PARAMETER_COUNT;
+        parameters[i] = FundEngineParameters{row[0], row[1], static_cast<int32_t>(row[2]), row[3], row[4], row[5], row[6]};
+    }
+    status = fund_engine_sweep(&series, range_start, range_end, parameters.data(), count, results.data(), threads);
+    for (size_t i = 0; status == FUND_ENGINE_OK && i < count; ++i) {
+        const FundEngineResult& r = results[i];
+        double* row = values + i * RESULT_COUNT;
+        const double fields[RESULT_COUNT] = {r.percentile_high, r.percentile_low, r.balance, r.holdings, r.latest_price,
+            r.holdings_value, r.total_value, r.total_profit, r.touched_lowest_balance, static_cast<double>(r.trade_count)};
+        std::memcpy(row, fields, sizeof(fields));
+    }
+    Py_END_ALLOW_THREADS
+    if (!check_status(status)) {
+        Py_DECREF(result);
+        return nullptr;
+    }
+    return result;
+}
+
+PyObject* engine_period_range(PyObject*, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {"prices", "timestamps", "period", nullptr};
+    PyObject* prices_object = nullptr;
+    PyObject* timestamps_object = nullptr;
+    int period = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOi", const_cast<char**>(keywords),
+            &prices_object, &timestamps_object, &period)) {
+        return nullptr;
+    }
+    if (timestamps_object == Py_None) {
+        PyErr_SetString(PyExc_ValueError, "period ranges need timestamps");
+        return nullptr;
+    }
+    Buffer prices, timestamps;
+    FundEngineSeries series;
+    size_t range_start = 0, range_end = 0;
+    if (!make_series(prices_object, timestamps_object, 0, -1, prices, timestamps, series, range_start, range_end)) {
+        return nullptr;
+    }
+    size_t start = 0, end = 0;
+    if (!check_status(fund_engine_period_range(&series, period, &start, &end))) {
+        return nullptr;
+    }
+    return Py_BuildValue("(nn)", static_cast<Py_ssize_t>(start), static_cast<Py_ssize_t>(end));
+}
+
+PyObject* string_tuple(const char* const* names, size_t count)
+{
+    PyObject* tuple = PyTuple_New(static_cast<Py_ssize_t>(count));
+    for (size_t i = 0; tuple && i < count; ++i) {
+        PyObject* name = PyUnicode_FromString(names[i]);
+        if (!name) {
+            Py_DECREF(tuple);
+            return nullptr;
+        }
+        PyTuple_SET_ITEM(tuple, static_cast<Py_ssize_t>(i), name);
+    }
+    return tuple;
+}
+
+PyMethodDef METHODS[] = {
+    {"run", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(engine_run)), METH_VARARGS | METH_KEYWORDS,
+        "run(prices, timestamps=None, start=0, end=-1, *, grid_size, big_grid_size, factor, sum, amount, "
+        "threshold_low, threshold_high, trades=False, equity=None) -> dict\n\n"
+        "Backtest [start, end) once. Parameters default to config.txt's. trades=True adds a list of tuples "
+        "(TRADE_FIELDS); equity is a writable float64 array of end - start elements filled in place."},
+    {"sweep", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(engine_sweep)), METH_VARARGS | METH_KEYWORDS,
+        "sweep(prices, parameters, timestamps=None, start=0, end=-1, out=None, threads=0) -> out\n\n"
+        "Backtest [start, end) once per row of the float64 parameters array (PARAMETER_FIELDS columns) "
+        "on native threads (0 = all cores). Rows of RESULT_FIELDS are written to out, a writable float64 array, "
+        "or to a new (n, 10) memoryview."},
+    {"period_range", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(engine_period_range)),
+        METH_VARARGS | METH_KEYWORDS,
+        "period_range(prices, timestamps, period) -> (start, end)\n\n"
+        "The range of a period code (0 = last 3 months ... 5 = since established, 6 = customized) as in config.txt."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyModuleDef MODULE = {
+    PyModuleDef_HEAD_INIT, "fundengine",
+    "Grid strategy backtests on numpy arrays without copying; the GIL is released while simulating.",
+    -1, METHODS, nullptr, nullptr, nullptr, nullptr,
+};
+
+}  // namespace
+
+PyMODINIT_FUNC PyInit_fundengine(void)
+{
+    if (fund_engine_abi_version() != FUND_ENGINE_ABI_VERSION) {
+        PyErr_SetString(PyExc_ImportError, "libfundengine ABI version mismatch");
+        return nullptr;
+    }
+    PyObject* module = PyModule_Create(&MODULE);
+    if (!module) {
+        return nullptr;
+    }
+    if (PyModule_AddIntConstant(module, "ABI_VERSION", FUND_ENGINE_ABI_VERSION) != 0
+        || PyModule_AddObject(module, "ENGINE_VERSION", PyLong_FromUnsignedLongLong(fund_engine_version())) != 0
+        || PyModule_AddObject(module, "PARAMETER_FIELDS", string_tuple(PARAMETER_FIELDS, PARAMETER_COUNT)) != 0
+        || PyModule_AddObject(module, "RESULT_FIELDS", string_tuple(RESULT_FIELDS, RESULT_COUNT)) != 0
+        || PyModule_AddObject(module, "TRADE_FIELDS", string_tuple(TRADE_FIELDS, TRADE_COUNT)) != 0) {
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
+
+// 编译命令（先按 FundEngine.cpp 末尾的命令编译 libfundengine.so）：g++ -O2 -shared -fPIC -fvisibility=hidden $(python3-config --includes) -o fundengine$(python3-config --extension-suffix) FundEnginePython.cpp -L. -lfundengine -Wl,-rpath,'$ORIGIN' -std=c++20
@@ -40,6 +40,72 @@ GetConfig::GetConfig(const std::string& filename) : config_()
         config_.periods = parse_array(config_map["period"]);
         config_.threshold_low = std::stof(config_map["threshold_low"]);
         config_.threshold_high = std::stof(config_map["threshold_high"]);
+        if (config_map.count("log_level")) {
+            config_.log_level = config_map["log_level"];
+        }
+        if (config_map.count("db_path")) {
+            config_.db_path = config_map["db_path"];
+        }
+        if (config_map.count("db_batch_rows")) {
+            config_.db_batch_rows = std::stoi(config_map["db_batch_rows"]);
+        }
+        if (config_map.count("db_flush_ms")) {
+            config_.db_flush_ms = std::stoi(config_map["db_flush_ms"]);
+        }
+        if (config_map.count("save_operations")) {
+            config_.save_operations = std::stoi(config_map["save_operations"]) != 0;
+        }
+        if (config_map.count("async_reports")) {
+            config_.async_reports = std::stoi(config_map["async_reports"]) != 0;
+        }
+        if (config_map.count("result_sink")) {
+            config_.result_sink = config_map["result_sink"];
+        }
+        if (config_map.count("columnar_path")) {
+            config_.columnar_path = config_map["columnar_path"];
+        }
+        if (config_map.count("columnar_chunk_rows")) {
+            config_.columnar_chunk_rows = std::stoi(config_map["columnar_chunk_rows"]);
+        }
+        if (config_map.count("columnar_compress")) {
+            config_.columnar_compress = std::stoi(config_map["columnar_compress"]) != 0;
+        }
+        if (config_map.count("price_db_path")) {
+            config_.price_db_path = config_map["price_db_path"];
+        }
+        if (config_map.count("price_cache_hours")) {
+            config_.price_cache_hours = std::stoi(config_map["price_cache_hours"]);
+        }
+        if (config_map.count("snapshot_path")) {
+            config_.snapshot_path = config_map["snapshot_path"];
+        }
+        if (config_map.count("result_cache")) {
+            config_.result_cache = std::stoi(config_map["result_cache"]) != 0;
+        }
+        if (config_map.count("server_address")) {
+            config_.server_address = config_map["server_address"];
+        }
+        if (config_map.count("server_port")) {
+            config_.server_port = std::stoi(config_map["server_port"]);
+        }
+        if (config_map.count("server_cache_entries")) {
+            config_.server_cache_entries = std::stoi(config_map["server_cache_entries"]);
+        }
+        if (config_map.count("server_refresh_minutes")) {
+            config_.server_refresh_minutes = std::stoi(config_map["server_refresh_minutes"]);
+        }
+        if (config_map.count("progress_socket")) {
+            config_.progress_socket = config_map["progress_socket"];
+        }
+        if (config_map.count("progress_port")) {
+            config_.progress_port = std::stoi(config_map["progress_port"]);
+        }
+        if (config_map.count("progress_interval_ms")) {
+            config_.progress_interval_ms = std::stoi(config_map["progress_interval_ms"]);
+        }
+        if (config_map.count("progress_top")) {
+            config_.progress_top = std::stoi(config_map["progress_top"]);
+        }
     }
 }
 
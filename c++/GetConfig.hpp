@@ -13,6 +13,28 @@ struct Config
     std::vector<std::string> periods; // 0: LAST_3_MONTHS, 1: LAST_6_MONTHS, etc.
     float threshold_low;
     float threshold_high;
+    std::string log_level = "info"; // debug / info / warn / error / off
+    std::string db_path = "/home/zhahu/FUND/c++/fund.db";
+    int db_batch_rows = 1000; // 每个事务最多写入的行数
+    int db_flush_ms = 50;     // 不足一批时最长等待多久提交
+    bool save_operations = true; // 是否把每笔交易写入 TB_OPERATION
+    bool async_reports = false;  // 是否由单独的线程写报告文件
+    std::string result_sink = "sqlite"; // sqlite / columnar
+    std::string columnar_path = "/home/zhahu/FUND/c++/fund.col";
+    int columnar_chunk_rows = 65536; // 列式文件每块的行数
+    bool columnar_compress = true;
+    std::string price_db_path;  // 净值序列缓存所在的库，为空时与 db_path 相同
+    int price_cache_hours = 0;  // 缓存的净值序列在多少小时内直接使用而不下载，0 表示总是下载
+    std::string snapshot_path;  // 净值序列的内存映射快照，为空时不使用
+    bool result_cache = true;   // 输入与参数都没变的 (基金, 周期) 跳过计算，沿用结果库中已有的结果
+    std::string server_address = "127.0.0.1"; // fund serve 监听的地址
+    int server_port = 8080;
+    int server_cache_entries = 1024;  // 回测服务缓存最近多少个结果
+    int server_refresh_minutes = 60;  // 常驻的序列超过多少分钟未更新时重新下载
+    std::string progress_socket;  // 批量运行的进度以 NDJSON 发布到这个 Unix 套接字，为空时不发布
+    int progress_port = 0;        // 进度以 Server-Sent Events 发布到 127.0.0.1 的这个端口，0 表示不发布
+    int progress_interval_ms = 500;
+    int progress_top = 10;        // 进度中附带当前收益最高的多少条结果
 };
 
 class GetConfig 
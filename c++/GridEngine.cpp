@@ -0,0 +1,288 @@
+#include "GridEngine.hpp"
+
+#include <algorithm>
+
+#include "AllocTracker.hpp"
+#include "Logger.hpp"
+#include "PerfCounters.hpp"
+#include "ReportWriter.hpp"
+#include "ResultCache.hpp"
+#include "Trace.hpp"
+
+static const double BASE = 1;
+
+size_t get_start_date(const FundData& fund_data, const std::string& period) {
+    long latest_timestamp = fund_data.timestamp(fund_data.size() - 1);
+    long last_timestamp = 0;
+
+    switch (static_cast<Period>(std::stoi(period))) {
+        case LAST_3_MONTHS:
+            last_timestamp = latest_timestamp - 90 * 24 * 3600;
+            break;
+        case LAST_6_MONTHS:
+            last_timestamp = latest_timestamp - 180 * 24 * 3600;
+            break;
+        case LAST_1_YEAR:
+            last_timestamp = latest_timestamp - 365 * 24 * 3600;
+            break;
+        case LAST_3_YEARS:
+            last_timestamp = latest_timestamp - 3 * 365 * 24 * 3600;
+            break;
+        case LAST_5_YEARS:
+            last_timestamp = latest_timestamp - 5 * 365 * 24 * 3600;
+            break;
+        case SINCE_ESTABLISHED:
+            return 0;
+        case CUSTOMIZED_TIME:
+            last_timestamp = latest_timestamp - 5 * 365 * 24 * 3600;
+            break;
+        default:
+            return 0;
+    }
+    return fund_data.lower_bound(last_timestamp);
+}
+
+size_t get_end_date(const FundData& fund_data, const std::string& period) {
+    long last_timestamp = fund_data.timestamp(fund_data.size() - 1);
+
+    switch (static_cast<Period>(std::stoi(period))) {
+        case LAST_3_MONTHS:
+        case LAST_6_MONTHS:
+        case LAST_1_YEAR:
+        case LAST_3_YEARS:
+        case LAST_5_YEARS:
+        case SINCE_ESTABLISHED:
+            return fund_data.size();
+        case CUSTOMIZED_TIME:
+            last_timestamp = 1726761600; // 2024-09-20 00:00:00 黎明前
+            break;
+        default:
+            return fund_data.size();
+    }
+    return fund_data.lower_bound(last_timestamp);
+}
+
+Thredhold calculate_thresholds(const FundData& fund_data, size_t start, size_t end, const ResultParameters& parameters)
+{
+    std::vector<double> values(fund_data.prices().begin() + start, fund_data.prices().begin() + end);
+    std::sort(values.begin(), values.end());
+
+    size_t n = values.size();
+    Thredhold thresholds;
+    if (n > 0) {
+        // 分位阈值在配置中是 float，按 float 相乘取下标，与一直以来的结果保持一致
+        size_t high_index = std::min(static_cast<size_t>(n * static_cast<float>(parameters.threshold_high)), n - 1);
+        size_t low_index = std::min(static_cast<size_t>(n * static_cast<float>(parameters.threshold_low)), n - 1);
+
+        thresholds.percentile_high = values[high_index];
+        thresholds.percentile_low = values[low_index];
+    }
+    return thresholds;
+}
+
+long long result_cache_key(const std::string& fund_code, const std::string& period, const FundData& fund_data,
+    size_t start, size_t end, const ResultParameters& parameters, bool save_operations)
+{
+    ContentHasher hasher;
+    hasher.add(ENGINE_VERSION).add(fund_code).add(period)
+        .add(fund_data, start, std::min(end + 1, fund_data.size()))
+        .add(parameters.grid_size).add(parameters.big_grid_size).add(static_cast<uint64_t>(parameters.factor))
+        .add(parameters.sum).add(parameters.amount)
+        .add(parameters.threshold_low).add(parameters.threshold_high)
+        .add(static_cast<uint64_t>(save_operations));
+    // 0 表示不缓存
+    long long key = static_cast<long long>(hasher.value());
+    return key != 0 ? key : 1;
+}
+
+GridOutcome run_grid(const std::string& fund_code, const FundData& fund_data, size_t start, size_t end,
+    const ResultParameters& parameters, std::vector<double>* equity)
+{
+    const double grid_size = parameters.grid_size;
+    const double big_grid_size = parameters.big_grid_size;
+    const double amount = parameters.amount;
+    const double big_amount = parameters.amount * parameters.factor;
+
+    AllocScope alloc_scope(AllocStage::GRID, fund_code.c_str());
+    GridOutcome outcome;
+    outcome.start = start;
+    outcome.end = end;
+    {
+        TRACE_SCOPE("thresholds", "engine", fund_code.c_str());
+        PerfScope perf(PerfStage::THRESHOLDS, fund_code.c_str(), end - start);
+        outcome.thresholds = calculate_thresholds(fund_data, start, end, parameters);
+    }
+    TRACE_SCOPE("trade loop", "engine", fund_code.c_str());
+    PerfScope perf(PerfStage::TRADE_LOOP, fund_code.c_str(), end - start);
+    const Thredhold& thresholds = outcome.thresholds;
+    double current_balance = parameters.sum;
+    double touched_lowest_balance = current_balance;
+    double current_holdings = 0;
+    double total_profit = 0;
+    double current_base_price = fund_data.price(start);
+    double current_big_base_price = fund_data.price(start);
+    std::vector<TradeOperation>& operations = outcome.operations;
+    if (equity) {
+        equity->clear();
+        equity->reserve(end - start);
+    }
+    for (size_t i = start; i < end; ++i) {
+        long timestamp = fund_data.timestamp(i);
+        double price = fund_data.price(i);
+        if (current_base_price * (BASE - grid_size) >= price and price < thresholds.percentile_high and price >= thresholds.percentile_low) {
+            TradeOperation operation;
+            if (current_balance < amount) {
+                operation.money_not_enough = true;
+                operation.buy_timestamp = timestamp;
+                operation.buy_price = price;
+                operations.push_back(operation);
+                LOG_INFO("%s: Not enough money for this operation.", fund_code.c_str());
+            }
+            else {
+                current_balance -= amount;
+                touched_lowest_balance = std::min(touched_lowest_balance, current_balance);
+                current_holdings += amount / price;
+                current_base_price = price;
+                operation.buy_timestamp = timestamp;
+                operation.buy_price = price;
+                operations.push_back(operation);
+            }
+        }
+        else if (current_big_base_price * (BASE - grid_size) >= price and price < thresholds.percentile_low) {
+            TradeOperation operation;
+            if (current_balance < big_amount) {
+                operation.money_not_enough = true;
+                operation.buy_timestamp = timestamp;
+                operation.buy_price = price;
+                operation.big_grid_size = true;
+                operations.push_back(operation);
+                LOG_INFO("%s: Not enough money for this operation.", fund_code.c_str());
+            }
+            else {
+                current_balance -= big_amount;
+                touched_lowest_balance = std::min(touched_lowest_balance, current_balance);
+                current_holdings += big_amount / price;
+                current_big_base_price = price;
+                operation.buy_timestamp = timestamp;
+                operation.buy_price = price;
+                operation.big_grid_size = true;
+                operations.push_back(operation);
+            }
+        }
+        else if (current_base_price * (BASE + grid_size) <= price) {
+            current_base_price = price; // 更新基准价格
+            for (auto& operation : operations) {
+                if (operation.money_not_enough || operation.dealed || operation.big_grid_size || operation.buy_price * (BASE + grid_size) > price) {
+                    continue;
+                }
+                operation.sell_timestamp = timestamp;
+                operation.sell_price = price;
+                double profit = (amount / operation.buy_price) * operation.sell_price - amount;
+                total_profit += profit;
+                current_balance += (amount / operation.buy_price) * operation.sell_price;
+                current_holdings -= amount / operation.buy_price;
+                operation.dealed = true;
+            }
+        }
+        else if (current_big_base_price * (BASE + big_grid_size) <= price) {
+            current_big_base_price = price; // 更新基准价格
+            for (auto& operation : operations) {
+                if (operation.money_not_enough || operation.dealed || !operation.big_grid_size || operation.buy_price * (BASE + big_grid_size) > price) {
+                    continue;
+                }
+                operation.sell_timestamp = timestamp;
+                operation.sell_price = price;
+                double profit = (big_amount / operation.buy_price) * operation.sell_price - big_amount;
+                total_profit += profit;
+                current_balance += (big_amount / operation.buy_price) * operation.sell_price;
+                current_holdings -= big_amount / operation.buy_price;
+                operation.dealed = true;
+            }
+        }
+        if (equity) {
+            equity->push_back(current_balance + current_holdings * price);
+        }
+    }
+    // 区间截止于序列末尾时取最后一个净值
+    outcome.latest_price = fund_data.price(std::min(end, fund_data.size() - 1));
+    outcome.balance = current_balance;
+    outcome.holdings = current_holdings;
+    outcome.total_profit = total_profit;
+    outcome.touched_lowest_balance = touched_lowest_balance;
+    return outcome;
+}
+
+std::vector<size_t> trade_points(const FundData& fund_data, const GridOutcome& outcome)
+{
+    std::vector<size_t> points;
+    points.reserve(outcome.operations.size() * 2);
+    for (const auto& operation : outcome.operations) {
+        points.push_back(fund_data.lower_bound(operation.buy_timestamp) - outcome.start);
+        if (operation.dealed) {
+            points.push_back(fund_data.lower_bound(operation.sell_timestamp) - outcome.start);
+        }
+    }
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+    return points;
+}
+
+void format_report(ReportBuffer& report, const GridOutcome& outcome, const ResultParameters& parameters, const RangeStats& stats)
+{
+    AllocScope alloc_scope(AllocStage::REPORT);
+    report << "SUM: " << parameters.sum << "  Amount: " << parameters.amount << "  Grid Size: " << parameters.grid_size << '\n';
+    report << "Holdings Value: " << outcome.holdings_value() << "(holds " << outcome.holdings << " at price " << outcome.latest_price << ")"
+        << "  Balance: " << outcome.balance << " Total Value: " << outcome.total_value() << '\n';
+    report << "PS: If Total Value (Holdings Value + Balance) < SUM, that shows you lost money at this moment!!!" << '\n';
+    report << "Profit: " << outcome.total_profit << "  Loss" << '\n';
+    report << "Touched Lowest Balance: " << outcome.touched_lowest_balance << '\n';
+    report << "Price Min: " << stats.min_price << "  Max: " << stats.max_price << "  Mean: " << stats.mean_price
+        << "  Stdev: " << stats.stdev_price << "  Buy&Hold Return: " << stats.buy_and_hold_return * 100 << "%" << '\n';
+
+    int dealed_count = 0, not_dealed_count = 0;
+    std::for_each(outcome.operations.begin(), outcome.operations.end(), [&](const TradeOperation& operation) {
+        if (operation.dealed) { dealed_count++; }
+        else if (!operation.money_not_enough) { not_dealed_count++; }
+    });
+    report << '\n' << "dealed trade: " << dealed_count << "  not dealed trade: " << not_dealed_count << '\n';
+    report << "================================== trade operations ==================================" << '\n';
+
+    for (const auto& operation : outcome.operations) {
+        if (operation.money_not_enough) {
+            report << "Not enough money to buy" << '\n';
+        }
+        report << "Buy Time: ";
+        report.date(operation.buy_timestamp) << ",    Price: " << operation.buy_price << '\n';
+
+        if (operation.dealed) {
+            report << "Sell Time: ";
+            report.date(operation.sell_timestamp) << ",    Price: " << operation.sell_price << '\n';
+        }
+        else {
+            report << "Sell Time: " << operation.sell_timestamp << ",    Price: " << operation.sell_price << '\n';
+        }
+        if (operation.big_grid_size) {
+            report << "Big Grid Size Operation" << '\n';
+        }
+        report << "----------------------------------------------------------" << '\n';
+    }
+}
+
+std::vector<OperationRecord> operation_records(const GridOutcome& outcome, const ResultParameters& parameters)
+{
+    std::vector<OperationRecord> records;
+    records.reserve(outcome.operations.size());
+    for (const auto& operation : outcome.operations) {
+        OperationRecord record;
+        record.buy_day = day_index(operation.buy_timestamp);
+        record.buy_price = operation.buy_price;
+        record.sell_day = operation.dealed ? day_index(operation.sell_timestamp) : 0;
+        record.sell_price = operation.sell_price;
+        record.lot_size = operation.big_grid_size ? parameters.amount * parameters.factor : parameters.amount;
+        record.grid_type = operation.big_grid_size ? OperationRecord::BIG_GRID : OperationRecord::SMALL_GRID;
+        record.status = operation.money_not_enough ? OperationRecord::NOT_ENOUGH_MONEY
+            : (operation.dealed ? OperationRecord::SOLD : OperationRecord::OPEN);
+        records.push_back(record);
+    }
+    return records;
+}
@@ -0,0 +1,88 @@
+#ifndef FUND_GRIDENGINE_HPP_
+#define FUND_GRIDENGINE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FundData.hpp"
+#include "CppSQLite/ResultSink.hpp"
+
+class ReportBuffer;
+
+// 网格策略的回测计算。参数全部由调用者传入，不读取全局配置，
+// 批量运行和回测服务使用同一份逻辑，结果完全一致
+
+// 计算逻辑版本，参与结果缓存键；修改会改变结果的逻辑时加一，使缓存的结果失效
+const uint64_t ENGINE_VERSION = 1;
+
+enum Period {
+    LAST_3_MONTHS = 0,
+    LAST_6_MONTHS,
+    LAST_1_YEAR,
+    LAST_3_YEARS,
+    LAST_5_YEARS,
+    SINCE_ESTABLISHED,
+    CUSTOMIZED_TIME
+};
+
+struct Thredhold {
+    double percentile_high = 0;
+    double percentile_low = 0;
+};
+
+struct TradeOperation {
+    long buy_timestamp = 0;
+    double buy_price = 0;
+
+    long sell_timestamp = 0;
+    double sell_price = 0;
+
+    bool money_not_enough = false; // 剩的钱是否够这次买入
+    bool big_grid_size = false; // 是否是大格子策略
+    bool dealed = false;
+};
+
+// 区间 [start, end) 的回测结果
+struct GridOutcome {
+    size_t start = 0;
+    size_t end = 0;
+    Thredhold thresholds;
+    double balance = 0;
+    double holdings = 0;
+    double latest_price = 0;  // 估值用的净值：区间后的第一个净值，区间截止于序列末尾时取最后一个
+    double total_profit = 0;
+    double touched_lowest_balance = 0;
+    std::vector<TradeOperation> operations;
+
+    double holdings_value() const { return holdings * latest_price; }
+    double total_value() const { return holdings_value() + balance; }
+};
+
+// period 为 Period 的数字，fund_data 不能为空
+size_t get_start_date(const FundData& fund_data, const std::string& period);
+size_t get_end_date(const FundData& fund_data, const std::string& period);
+
+Thredhold calculate_thresholds(const FundData& fund_data, size_t start, size_t end, const ResultParameters& parameters);
+
+// 结果缓存键：决定结果的全部输入，即区间内的净值（含区间后用于估值的一个点）、网格参数和计算逻辑版本。不会返回 0
+long long result_cache_key(const std::string& fund_code, const std::string& period, const FundData& fund_data,
+    size_t start, size_t end, const ResultParameters& parameters, bool save_operations);
+
+// 在 [start, end) 上模拟网格交易，要求 start < end <= fund_data.size()；fund_code 只用于日志。
+// 结果必须与 ReferenceEngine 中冻结的参考实现一致，修改后用 funddiff 对比。
+// equity 非空时记录每个交易日收盘后按当日净值计算的总资产，长度为 end - start
+GridOutcome run_grid(const std::string& fund_code, const FundData& fund_data, size_t start, size_t end,
+    const ResultParameters& parameters, std::vector<double>* equity = nullptr);
+
+// 交易的买入和卖出日在区间 [outcome.start, outcome.end) 中的位置（相对 start），升序去重，用作曲线上的交易标记
+std::vector<size_t> trade_points(const FundData& fund_data, const GridOutcome& outcome);
+
+// 文本报告：参数、资产、区间统计和逐笔交易，追加到 report
+void format_report(ReportBuffer& report, const GridOutcome& outcome, const ResultParameters& parameters, const RangeStats& stats);
+
+// 交易转换为 TB_OPERATION 的记录
+std::vector<OperationRecord> operation_records(const GridOutcome& outcome, const ResultParameters& parameters);
+
+#endif  // FUND_GRIDENGINE_HPP_
@@ -0,0 +1,214 @@
+#include "HttpReactor.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "AllocTracker.hpp"
+#include "Trace.hpp"
+
+HttpReactor::HttpReactor(ThreadPool& resume_pool, long max_connections) : resume_pool_(resume_pool)
+{
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        throw std::runtime_error("HttpReactor: failed to create epoll/eventfd");
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+
+    multi_ = curl_multi_init();
+    curl_multi_setopt(multi_, CURLMOPT_SOCKETFUNCTION, &HttpReactor::socket_callback);
+    curl_multi_setopt(multi_, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi_, CURLMOPT_TIMERFUNCTION, &HttpReactor::timer_callback);
+    curl_multi_setopt(multi_, CURLMOPT_TIMERDATA, this);
+    // 超出连接数上限的请求由 curl 内部排队，不需要额外的线程
+    curl_multi_setopt(multi_, CURLMOPT_MAX_TOTAL_CONNECTIONS, max_connections);
+    curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS, max_connections);
+
+    thread_ = std::thread(&HttpReactor::run, this);
+}
+
+HttpReactor::~HttpReactor()
+{
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        stop_ = true;
+    }
+    uint64_t one = 1;
+    (void)write(wake_fd_, &one, sizeof(one));
+    thread_.join();
+
+    curl_multi_cleanup(multi_);
+    close(wake_fd_);
+    close(epoll_fd_);
+}
+
+void HttpReactor::submit(Request* request)
+{
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending_.push_back(request);
+    }
+    uint64_t one = 1;
+    (void)write(wake_fd_, &one, sizeof(one));
+}
+
+size_t HttpReactor::write_callback(char* data, size_t size, size_t nmemb, void* userp)
+{
+    static_cast<std::string*>(userp)->append(data, size * nmemb);
+    return size * nmemb;
+}
+
+int HttpReactor::socket_callback(CURL*, curl_socket_t socket, int what, void* userp, void* socketp)
+{
+    auto* reactor = static_cast<HttpReactor*>(userp);
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(reactor->epoll_fd_, EPOLL_CTL_DEL, socket, nullptr);
+        return 0;
+    }
+
+    epoll_event event{};
+    event.data.fd = socket;
+    if (what == CURL_POLL_IN || what == CURL_POLL_INOUT) {
+        event.events |= EPOLLIN;
+    }
+    if (what == CURL_POLL_OUT || what == CURL_POLL_INOUT) {
+        event.events |= EPOLLOUT;
+    }
+    if (socketp) {
+        epoll_ctl(reactor->epoll_fd_, EPOLL_CTL_MOD, socket, &event);
+    }
+    else {
+        epoll_ctl(reactor->epoll_fd_, EPOLL_CTL_ADD, socket, &event);
+        curl_multi_assign(reactor->multi_, socket, reactor);
+    }
+    return 0;
+}
+
+int HttpReactor::timer_callback(CURLM*, long timeout_ms, void* userp)
+{
+    auto* reactor = static_cast<HttpReactor*>(userp);
+    if (timeout_ms < 0) {
+        reactor->deadline_.reset();
+    }
+    else {
+        reactor->deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    }
+    return 0;
+}
+
+void HttpReactor::start_pending()
+{
+    std::vector<Request*> requests;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        requests.swap(pending_);
+    }
+    for (Request* request : requests) {
+        request->easy = curl_easy_init();
+        if (!request->easy) {
+            request->response.code = CURLE_FAILED_INIT;
+            complete(request);
+            continue;
+        }
+        curl_easy_setopt(request->easy, CURLOPT_URL, request->url.c_str());
+        curl_easy_setopt(request->easy, CURLOPT_WRITEFUNCTION, &HttpReactor::write_callback);
+        curl_easy_setopt(request->easy, CURLOPT_WRITEDATA, &request->response.body);
+        curl_easy_setopt(request->easy, CURLOPT_PRIVATE, request);
+        curl_easy_setopt(request->easy, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(request->easy, CURLOPT_NOSIGNAL, 1L);
+        curl_multi_add_handle(multi_, request->easy);
+        active_.insert(request);
+    }
+}
+
+void HttpReactor::complete(Request* request)
+{
+    if (request->easy) {
+        curl_easy_getinfo(request->easy, CURLINFO_RESPONSE_CODE, &request->response.status);
+        curl_multi_remove_handle(multi_, request->easy);
+        curl_easy_cleanup(request->easy);
+        request->easy = nullptr;
+    }
+    active_.erase(request);
+    // 恢复协程后 request 所在的帧可能立即销毁，之后不能再访问 request
+    auto handle = request->handle;
+    resume_pool_.post([handle]() { handle.resume(); });
+}
+
+void HttpReactor::check_finished()
+{
+    int remaining = 0;
+    while (CURLMsg* message = curl_multi_info_read(multi_, &remaining)) {
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+        Request* request = nullptr;
+        curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &request);
+        request->response.code = message->data.result;
+        complete(request);
+    }
+}
+
+void HttpReactor::run()
+{
+    TRACE_THREAD_NAME("http reactor");
+    // 响应正文在本线程中追加，记在下载阶段上
+    AllocTracker::set_thread_stage(AllocStage::DOWNLOAD);
+    const int MAX_EVENTS = 64;
+    epoll_event events[MAX_EVENTS];
+    int running = 0;
+    while (true) {
+        int timeout = -1;
+        if (deadline_) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                *deadline_ - std::chrono::steady_clock::now()).count();
+            timeout = static_cast<int>(std::max<long long>(remaining, 0));
+        }
+
+        int count = epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout);
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                uint64_t value;
+                while (read(wake_fd_, &value, sizeof(value)) > 0) {}
+                continue;
+            }
+            int flags = 0;
+            if (events[i].events & EPOLLIN) flags |= CURL_CSELECT_IN;
+            if (events[i].events & EPOLLOUT) flags |= CURL_CSELECT_OUT;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) flags |= CURL_CSELECT_ERR;
+            curl_multi_socket_action(multi_, fd, flags, &running);
+        }
+
+        if (deadline_ && std::chrono::steady_clock::now() >= *deadline_) {
+            deadline_.reset();
+            curl_multi_socket_action(multi_, CURL_SOCKET_TIMEOUT, 0, &running);
+        }
+
+        bool stop;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            stop = stop_;
+        }
+        if (stop) {
+            break;
+        }
+        start_pending();
+        check_finished();
+    }
+
+    // 停止时仍未完成的请求以失败结果恢复
+    start_pending();
+    check_finished();
+    std::vector<Request*> unfinished(active_.begin(), active_.end());
+    for (Request* request : unfinished) {
+        request->response.code = CURLE_ABORTED_BY_CALLBACK;
+        complete(request);
+    }
+}
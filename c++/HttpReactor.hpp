@@ -0,0 +1,87 @@
+#ifndef FUND_HTTPREACTOR_HPP_
+#define FUND_HTTPREACTOR_HPP_
+
+#include <chrono>
+#include <coroutine>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <curl/curl.h>
+
+#include "ThreadPool.hpp"
+
+struct HttpResponse
+{
+    CURLcode code = CURLE_OK;
+    long status = 0;
+    std::string body;
+};
+
+// 基于 curl_multi_socket_action + epoll 的单线程 I/O 反应器。
+// co_await reactor.fetch(url) 挂起协程而不占用线程，完成后在 resume_pool 中恢复。
+class HttpReactor
+{
+    struct Request
+    {
+        std::string url;
+        HttpResponse response;
+        std::coroutine_handle<> handle;
+        CURL* easy = nullptr;
+    };
+
+public:
+    class FetchAwaitable
+    {
+    public:
+        FetchAwaitable(HttpReactor& reactor, std::string url) : reactor_(reactor) { request_.url = std::move(url); }
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            request_.handle = handle;
+            reactor_.submit(&request_);
+        }
+        HttpResponse await_resume() { return std::move(request_.response); }
+
+    private:
+        HttpReactor& reactor_;
+        Request request_;
+    };
+
+    explicit HttpReactor(ThreadPool& resume_pool, long max_connections = 32);
+    ~HttpReactor();
+
+    HttpReactor(const HttpReactor&) = delete;
+    HttpReactor& operator=(const HttpReactor&) = delete;
+
+    FetchAwaitable fetch(std::string url) { return FetchAwaitable(*this, std::move(url)); }
+
+private:
+    void submit(Request* request);
+    void run();
+    void start_pending();
+    void check_finished();
+    void complete(Request* request);
+
+    static int socket_callback(CURL* easy, curl_socket_t socket, int what, void* userp, void* socketp);
+    static int timer_callback(CURLM* multi, long timeout_ms, void* userp);
+    static size_t write_callback(char* data, size_t size, size_t nmemb, void* userp);
+
+    ThreadPool& resume_pool_;
+    CURLM* multi_ = nullptr;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    std::optional<std::chrono::steady_clock::time_point> deadline_;
+    std::unordered_set<Request*> active_;
+
+    std::mutex pending_mutex_;
+    std::vector<Request*> pending_;
+    bool stop_ = false;
+
+    std::thread thread_;
+};
+
+#endif  // FUND_HTTPREACTOR_HPP_
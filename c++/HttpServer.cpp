@@ -0,0 +1,478 @@
+#include "HttpServer.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Logger.hpp"
+
+namespace {
+
+const uint64_t LISTEN_ID = 0;
+const uint64_t WAKE_ID = 1;
+const size_t MAX_HEADER_BYTES = 16 * 1024;
+const size_t MAX_BODY_BYTES = 1024 * 1024;
+
+const char* reason_phrase(int status)
+{
+    switch (status) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        case 422: return "Unprocessable Entity";
+        case 431: return "Request Header Fields Too Large";
+        case 501: return "Not Implemented";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        default: return status < 400 ? "OK" : "Error";
+    }
+}
+
+std::string lowercase(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+std::string trim(const std::string& text)
+{
+    size_t begin = text.find_first_not_of(" \t");
+    size_t end = text.find_last_not_of(" \t");
+    return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+}
+
+int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+std::string url_decode(const std::string& text)
+{
+    std::string decoded;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '+') {
+            decoded.push_back(' ');
+        } else if (text[i] == '%' && i + 2 < text.size() && hex_value(text[i + 1]) >= 0 && hex_value(text[i + 2]) >= 0) {
+            decoded.push_back(static_cast<char>(hex_value(text[i + 1]) * 16 + hex_value(text[i + 2])));
+            i += 2;
+        } else {
+            decoded.push_back(text[i]);
+        }
+    }
+    return decoded;
+}
+
+}  // namespace
+
+std::unordered_map<std::string, std::string> parse_query(const std::string& query)
+{
+    std::unordered_map<std::string, std::string> parameters;
+    size_t begin = 0;
+    while (begin < query.size()) {
+        size_t end = query.find('&', begin);
+        if (end == std::string::npos) {
+            end = query.size();
+        }
+        std::string pair = query.substr(begin, end - begin);
+        size_t eq = pair.find('=');
+        if (!pair.empty()) {
+            parameters[url_decode(pair.substr(0, eq))] = eq == std::string::npos ? "" : url_decode(pair.substr(eq + 1));
+        }
+        begin = end + 1;
+    }
+    return parameters;
+}
+
+struct HttpServer::Connection
+{
+    uint64_t id = 0;
+    int fd = -1;
+    std::string input;
+    std::string output;
+    size_t written = 0;
+    uint64_t sequence = 0;   // 当前请求的序号，过期的回复按序号丢弃
+    bool busy = false;       // 已交给处理函数，等待回复
+    bool closing = false;    // 写完当前回复后关闭
+    bool dead = false;       // 对端已关闭或出错，立即关闭
+    bool want_write = false;
+};
+
+// 其他线程交回的回复。Responder 持有它的 shared_ptr，服务端析构后回复直接丢弃
+struct HttpServer::Completions
+{
+    struct Reply
+    {
+        uint64_t connection;
+        uint64_t sequence;
+        HttpReply reply;
+    };
+
+    std::mutex mutex;
+    std::vector<Reply> replies;
+    bool closed = false;
+    int wake_fd = -1;
+
+    ~Completions()
+    {
+        if (wake_fd >= 0) {
+            close(wake_fd);
+        }
+    }
+
+    void wake()
+    {
+        uint64_t one = 1;
+        (void)write(wake_fd, &one, sizeof(one));
+    }
+
+    void post(uint64_t connection, uint64_t sequence, HttpReply reply)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (closed) {
+                return;
+            }
+            replies.push_back({connection, sequence, std::move(reply)});
+        }
+        wake();
+    }
+};
+
+HttpServer::HttpServer(const std::string& address, int port, Handler handler)
+    : handler_(std::move(handler)), completions_(std::make_shared<Completions>())
+{
+    sockaddr_in socket_address{};
+    socket_address.sin_family = AF_INET;
+    socket_address.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, address.c_str(), &socket_address.sin_addr) != 1) {
+        throw std::runtime_error("HttpServer: invalid address " + address);
+    }
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    if (listen_fd_ < 0 || setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0
+        || bind(listen_fd_, reinterpret_cast<sockaddr*>(&socket_address), sizeof(socket_address)) != 0
+        || listen(listen_fd_, SOMAXCONN) != 0) {
+        std::string error = std::strerror(errno);
+        if (listen_fd_ >= 0) {
+            close(listen_fd_);
+        }
+        throw std::runtime_error("HttpServer: cannot listen on " + address + ":" + std::to_string(port) + ": " + error);
+    }
+    socklen_t length = sizeof(socket_address);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&socket_address), &length);
+    port_ = ntohs(socket_address.sin_port);
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    completions_->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || completions_->wake_fd < 0) {
+        close(listen_fd_);
+        throw std::runtime_error("HttpServer: failed to create epoll/eventfd");
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = LISTEN_ID;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+    event.data.u64 = WAKE_ID;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, completions_->wake_fd, &event);
+}
+
+HttpServer::~HttpServer()
+{
+    {
+        std::lock_guard<std::mutex> lock(completions_->mutex);
+        completions_->closed = true;
+        completions_->replies.clear();
+    }
+    for (auto& [id, connection] : connections_) {
+        close(connection->fd);
+    }
+    close(listen_fd_);
+    close(epoll_fd_);
+}
+
+void HttpServer::stop()
+{
+    stop_.store(true);
+    completions_->wake();
+}
+
+void HttpServer::run()
+{
+    const int MAX_EVENTS = 64;
+    epoll_event events[MAX_EVENTS];
+    while (!stop_.load()) {
+        int count = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+        if (count < 0 && errno != EINTR) {
+            LOG_ERROR("HttpServer: epoll_wait failed: %s", std::strerror(errno));
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            uint64_t id = events[i].data.u64;
+            if (id == LISTEN_ID) {
+                accept_connections();
+                continue;
+            }
+            if (id == WAKE_ID) {
+                uint64_t value;
+                while (read(completions_->wake_fd, &value, sizeof(value)) > 0) {}
+                deliver_replies();
+                continue;
+            }
+            auto found = connections_.find(id);
+            if (found == connections_.end()) {
+                continue;
+            }
+            Connection& connection = *found->second;
+            if (events[i].events & EPOLLERR) {
+                connection.dead = true;
+            }
+            if (!connection.dead && (events[i].events & (EPOLLIN | EPOLLHUP))) {
+                on_readable(connection);
+            }
+            if (!connection.dead && (events[i].events & EPOLLOUT)) {
+                on_writable(connection);
+            }
+            if (connection.dead || (connection.closing && !connection.busy && connection.output.empty())) {
+                close_connection(id);
+            }
+        }
+    }
+}
+
+void HttpServer::accept_connections()
+{
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_WARN("HttpServer: accept failed: %s", std::strerror(errno));
+            }
+            return;
+        }
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        auto connection = std::make_unique<Connection>();
+        connection->id = next_id_++;
+        connection->fd = fd;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = connection->id;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+        connections_.emplace(connection->id, std::move(connection));
+    }
+}
+
+void HttpServer::on_readable(Connection& connection)
+{
+    char buffer[16 * 1024];
+    while (true) {
+        ssize_t received = read(connection.fd, buffer, sizeof(buffer));
+        if (received > 0) {
+            connection.input.append(buffer, static_cast<size_t>(received));
+            // 处理中的连接不会 dispatch，头部和正文的上限在这里也要限制，否则客户端能让缓冲区无限增长
+            if (connection.input.size() > MAX_HEADER_BYTES + MAX_BODY_BYTES) {
+                LOG_WARN("HttpServer: closing connection %llu, %zu unprocessed bytes",
+                    static_cast<unsigned long long>(connection.id), connection.input.size());
+                connection.dead = true;
+                return;
+            }
+            continue;
+        }
+        if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            connection.dead = true;
+            return;
+        }
+        if (errno != EINTR) {
+            break;
+        }
+    }
+    if (!connection.busy) {
+        dispatch(connection);
+    }
+}
+
+void HttpServer::on_writable(Connection& connection)
+{
+    while (connection.written < connection.output.size()) {
+        ssize_t sent = send(connection.fd, connection.output.data() + connection.written,
+            connection.output.size() - connection.written, MSG_NOSIGNAL);
+        if (sent > 0) {
+            connection.written += static_cast<size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        connection.dead = true;
+        return;
+    }
+    bool pending = connection.written < connection.output.size();
+    if (!pending) {
+        connection.output.clear();
+        connection.written = 0;
+    }
+    if (pending != connection.want_write) {
+        epoll_event event{};
+        event.events = pending ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        event.data.u64 = connection.id;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.want_write = pending;
+    }
+}
+
+void HttpServer::dispatch(Connection& connection)
+{
+    if (connection.closing) {
+        return;
+    }
+    auto reject = [this, &connection](int status) {
+        HttpReply reply;
+        reply.status = status;
+        reply.body = std::string("{\"error\":\"") + reason_phrase(status) + "\"}";
+        connection.closing = true;
+        queue_reply(connection, reply);
+    };
+    size_t header_end = connection.input.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        if (connection.input.size() > MAX_HEADER_BYTES) {
+            reject(431);
+        }
+        return;
+    }
+
+    HttpRequest request;
+    bool keep_alive = true;
+    size_t line_end = connection.input.find("\r\n");
+    {
+        std::string line = connection.input.substr(0, line_end);
+        size_t first = line.find(' ');
+        size_t second = line.rfind(' ');
+        if (first == std::string::npos || second == first) {
+            reject(400);
+            return;
+        }
+        request.method = line.substr(0, first);
+        std::string target = line.substr(first + 1, second - first - 1);
+        size_t question = target.find('?');
+        request.path = target.substr(0, question);
+        request.query = question == std::string::npos ? "" : target.substr(question + 1);
+        keep_alive = line.compare(second + 1, std::string::npos, "HTTP/1.0") != 0;
+    }
+    size_t position = line_end + 2;
+    while (position < header_end) {
+        size_t end = connection.input.find("\r\n", position);
+        std::string line = connection.input.substr(position, end - position);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            request.headers[lowercase(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+        }
+        position = end + 2;
+    }
+    if (request.headers.count("transfer-encoding")) {
+        reject(501);
+        return;
+    }
+    size_t content_length = 0;
+    if (request.headers.count("content-length")) {
+        try {
+            content_length = std::stoul(request.headers["content-length"]);
+        } catch (const std::exception&) {
+            reject(400);
+            return;
+        }
+    }
+    if (content_length > MAX_BODY_BYTES) {
+        reject(413);
+        return;
+    }
+    size_t total = header_end + 4 + content_length;
+    if (connection.input.size() < total) {
+        return;
+    }
+    request.body = connection.input.substr(header_end + 4, content_length);
+    connection.input.erase(0, total);
+
+    auto found = request.headers.find("connection");
+    if (found != request.headers.end()) {
+        std::string value = lowercase(found->second);
+        keep_alive = value == "keep-alive" || (keep_alive && value != "close");
+    }
+    connection.closing = !keep_alive;
+    connection.busy = true;
+    uint64_t sequence = ++connection.sequence;
+    std::shared_ptr<Completions> completions = completions_;
+    uint64_t id = connection.id;
+    handler_(request, [completions, id, sequence](HttpReply reply) {
+        completions->post(id, sequence, std::move(reply));
+    });
+}
+
+void HttpServer::deliver_replies()
+{
+    std::vector<Completions::Reply> replies;
+    {
+        std::lock_guard<std::mutex> lock(completions_->mutex);
+        replies.swap(completions_->replies);
+    }
+    for (auto& item : replies) {
+        auto found = connections_.find(item.connection);
+        if (found == connections_.end()) {
+            continue;
+        }
+        Connection& connection = *found->second;
+        if (!connection.busy || connection.sequence != item.sequence) {
+            continue;
+        }
+        connection.busy = false;
+        queue_reply(connection, item.reply);
+        // 同一连接上已经到达的下一个请求
+        if (!connection.dead) {
+            dispatch(connection);
+        }
+        if (connection.dead || (connection.closing && !connection.busy && connection.output.empty())) {
+            close_connection(item.connection);
+        }
+    }
+}
+
+void HttpServer::queue_reply(Connection& connection, const HttpReply& reply)
+{
+    std::string& output = connection.output;
+    output.append("HTTP/1.1 ").append(std::to_string(reply.status)).append(" ").append(reason_phrase(reply.status)).append("\r\n");
+    output.append("Content-Type: ").append(reply.content_type).append("\r\n");
+    output.append("Content-Length: ").append(std::to_string(reply.body.size())).append("\r\n");
+    for (const auto& [name, value] : reply.headers) {
+        output.append(name).append(": ").append(value).append("\r\n");
+    }
+    output.append(connection.closing ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n");
+    output.append(reply.body);
+    on_writable(connection);
+}
+
+void HttpServer::close_connection(uint64_t id)
+{
+    auto found = connections_.find(id);
+    if (found == connections_.end()) {
+        return;
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, found->second->fd, nullptr);
+    close(found->second->fd);
+    connections_.erase(found);
+}
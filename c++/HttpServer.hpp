@@ -0,0 +1,81 @@
+#ifndef FUND_HTTPSERVER_HPP_
+#define FUND_HTTPSERVER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct HttpRequest
+{
+    std::string method;
+    std::string path;   // 不含查询串
+    std::string query;  // '?' 之后的部分，未解码
+    std::unordered_map<std::string, std::string> headers;  // 名称为小写
+    std::string body;
+};
+
+struct HttpReply
+{
+    int status = 200;
+    std::string content_type = "application/json";
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+};
+
+// 查询串 a=1&b=x%20y 解码为键值对
+std::unordered_map<std::string, std::string> parse_query(const std::string& query);
+
+// 基于 epoll 的单线程 HTTP/1.1 服务端，支持 keep-alive，同一连接上的请求依次处理。
+// 处理函数在服务线程中调用，可以把请求交给其他线程，之后在任意线程调用一次 Responder 回复；
+// 回复经 eventfd 交回服务线程写出，连接已关闭时丢弃
+class HttpServer
+{
+public:
+    using Responder = std::function<void(HttpReply)>;
+    using Handler = std::function<void(const HttpRequest&, Responder)>;
+
+    // 监听 address:port，port 为 0 时由系统分配；失败时抛出 std::runtime_error
+    HttpServer(const std::string& address, int port, Handler handler);
+    ~HttpServer();
+
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    int port() const { return port_; }
+
+    // 在当前线程处理连接，直到 stop()
+    void run();
+    // 可以在任意线程和信号处理函数中调用
+    void stop();
+
+private:
+    struct Connection;
+    struct Completions;
+
+    void accept_connections();
+    void on_readable(Connection& connection);
+    void on_writable(Connection& connection);
+    // 缓冲区中有完整的请求时交给处理函数；格式错误时回复 400 并关闭连接
+    void dispatch(Connection& connection);
+    void deliver_replies();
+    void queue_reply(Connection& connection, const HttpReply& reply);
+    void close_connection(uint64_t id);
+
+    Handler handler_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int port_ = 0;
+    std::shared_ptr<Completions> completions_;
+    std::atomic<bool> stop_{false};
+
+    uint64_t next_id_ = 2;  // 0 和 1 留给监听套接字与 eventfd
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> connections_;
+};
+
+#endif  // FUND_HTTPSERVER_HPP_
@@ -0,0 +1,371 @@
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+const size_t MAX_MESSAGE = 240;
+const size_t RING_CAPACITY = 512; // 必须是 2 的幂
+const int64_t RATE_WINDOW_NS = 1000000000;
+const uint32_t RATE_BURST = 10;
+// 每个线程同时跟踪的不同日志条数上限，超出时新的日志不限流
+const size_t MAX_RATE_ENTRIES = 4096;
+
+const char* LEVEL_NAMES[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+
+int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+struct LogRecord
+{
+    int64_t time_ns;
+    LogLevel level;
+    uint32_t thread_id;
+    uint32_t length;
+    char text[MAX_MESSAGE];
+};
+
+// 每个线程、每条日志（按格式化后的文本）的限流状态，由 LogRing::rates_mutex_ 保护。
+// 窗口结束后还没报告的 suppressed 由所属线程下次记录同一条日志时报告，或由后台线程取走
+struct RateState
+{
+    int64_t window_start = 0;
+    uint32_t count = 0;
+    uint32_t suppressed = 0;
+    LogLevel level = LogLevel::INFO;
+    std::string text;
+};
+
+uint32_t clamp_length(int n)
+{
+    return static_cast<uint32_t>(std::min<size_t>(std::max(n, 0), MAX_MESSAGE - 1));
+}
+
+void format_suppressed(LogRecord& record, uint32_t suppressed, const std::string& text)
+{
+    record.length = clamp_length(std::snprintf(record.text, MAX_MESSAGE, "(suppressed %u repeats of \"%s\")",
+        suppressed, text.c_str()));
+}
+
+void format_line(std::string& out, const LogRecord& record)
+{
+    time_t seconds = record.time_ns / 1000000000;
+    int millis = static_cast<int>(record.time_ns / 1000000 % 1000);
+    std::tm tm_buf;
+    localtime_r(&seconds, &tm_buf);
+    char prefix[64];
+    int n = std::snprintf(prefix, sizeof(prefix), "%04d-%02d-%02d %02d:%02d:%02d.%03d %s [T%02u] ",
+        tm_buf.tm_year + 1900, tm_buf.tm_mon + 1, tm_buf.tm_mday,
+        tm_buf.tm_hour, tm_buf.tm_min, tm_buf.tm_sec, millis,
+        LEVEL_NAMES[static_cast<int>(record.level)], record.thread_id);
+    out.append(prefix, n);
+    out.append(record.text, record.length);
+    out.push_back('\n');
+}
+
+}  // namespace
+
+LogLevel parse_log_level(const std::string& name)
+{
+    if (name == "debug") return LogLevel::DEBUG;
+    if (name == "info") return LogLevel::INFO;
+    if (name == "warn") return LogLevel::WARN;
+    if (name == "error") return LogLevel::ERROR;
+    if (name == "off") return LogLevel::OFF;
+    return LogLevel::INFO;
+}
+
+// 单生产者单消费者环形缓冲区：生产者是所属线程，消费者是持有 drain_mutex_ 的线程
+class LogRing
+{
+public:
+    explicit LogRing(uint32_t thread_id) : thread_id_(thread_id) {}
+
+    LogRecord* begin_push()
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= RING_CAPACITY) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &records_[tail & (RING_CAPACITY - 1)];
+    }
+
+    void commit_push()
+    {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool pop(LogRecord& record)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        record = records_[head & (RING_CAPACITY - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    uint32_t thread_id() const { return thread_id_; }
+    size_t take_dropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+    // 限流：同一条日志每个窗口最多输出 RATE_BURST 条，超出部分只计数，返回 false。
+    // 新窗口开始时通过 suppressed 返回上一窗口还没报告的条数
+    bool admit(std::string_view text, LogLevel level, int64_t now, uint32_t& suppressed, std::string& reported)
+    {
+        size_t key = std::hash<std::string_view>()(text);
+        std::lock_guard<std::mutex> lock(rates_mutex_);
+        auto it = rates_.find(key);
+        if (it == rates_.end()) {
+            if (rates_.size() >= MAX_RATE_ENTRIES) {
+                return true;
+            }
+            it = rates_.emplace(key, RateState{}).first;
+            it->second.text.assign(text);
+        }
+        RateState& rate = it->second;
+        if (now - rate.window_start >= RATE_WINDOW_NS) {
+            suppressed = rate.suppressed;
+            reported = rate.text;
+            rate.suppressed = 0;
+            rate.window_start = now;
+            rate.count = 0;
+        }
+        if (++rate.count > RATE_BURST) {
+            rate.level = level;
+            ++rate.suppressed;
+            return false;
+        }
+        return true;
+    }
+
+    // 取走窗口已结束（force 时不论窗口）的抑制计数，生成说明记录；窗口已结束且没有待报告计数的条目移除
+    void take_suppressed(int64_t now, bool force, std::vector<LogRecord>& batch)
+    {
+        std::lock_guard<std::mutex> lock(rates_mutex_);
+        for (auto it = rates_.begin(); it != rates_.end();) {
+            RateState& rate = it->second;
+            bool expired = now - rate.window_start >= RATE_WINDOW_NS;
+            if (rate.suppressed > 0 && (force || expired)) {
+                LogRecord record;
+                record.time_ns = now;
+                record.level = rate.level;
+                record.thread_id = thread_id_;
+                format_suppressed(record, rate.suppressed, rate.text);
+                batch.push_back(record);
+                rate.suppressed = 0;
+            }
+            it = expired && rate.suppressed == 0 ? rates_.erase(it) : std::next(it);
+        }
+    }
+
+    std::atomic<bool> retired{false};
+
+private:
+    uint32_t thread_id_;
+    std::array<LogRecord, RING_CAPACITY> records_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    std::atomic<size_t> dropped_{0};
+    std::mutex rates_mutex_;
+    std::unordered_map<size_t, RateState> rates_;
+};
+
+namespace {
+
+struct RingHolder
+{
+    std::shared_ptr<LogRing> ring;
+
+    ~RingHolder()
+    {
+        if (ring) {
+            ring->retired.store(true, std::memory_order_release);
+        }
+    }
+};
+
+thread_local RingHolder local_holder;
+
+}  // namespace
+
+Logger& Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+{
+    running_ = true;
+    drain_thread_ = std::thread(&Logger::drain_loop, this);
+}
+
+Logger::~Logger()
+{
+    shutdown();
+}
+
+LogRing& Logger::local_ring()
+{
+    if (!local_holder.ring) {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        static uint32_t next_thread_id = 0;
+        local_holder.ring = std::make_shared<LogRing>(next_thread_id++);
+        rings_.push_back(local_holder.ring);
+    }
+    return *local_holder.ring;
+}
+
+namespace {
+
+// 写入缓冲区；后台线程已停止时直接同步输出
+void emit(LogRing& ring, bool async, const LogRecord& formatted)
+{
+    if (async) {
+        if (LogRecord* record = ring.begin_push()) {
+            *record = formatted;
+            ring.commit_push();
+        }
+        return;
+    }
+    std::string line;
+    format_line(line, formatted);
+    std::fwrite(line.data(), 1, line.size(), formatted.level >= LogLevel::WARN ? stderr : stdout);
+}
+
+}  // namespace
+
+void Logger::log(LogLevel level, const char* format, ...)
+{
+    LogRing& ring = local_ring();
+    LogRecord record;
+    record.time_ns = now_ns();
+    record.level = level;
+    record.thread_id = ring.thread_id();
+    va_list args;
+    va_start(args, format);
+    record.length = clamp_length(std::vsnprintf(record.text, MAX_MESSAGE, format, args));
+    va_end(args);
+
+    // 只限流文本完全相同的 DEBUG/INFO 日志；同一格式的不同内容（例如每只基金的结果）和 WARN/ERROR 全部输出
+    uint32_t suppressed = 0;
+    std::string reported;
+    if (level < LogLevel::WARN
+        && !ring.admit(std::string_view(record.text, record.length), level, record.time_ns, suppressed, reported)) {
+        return;
+    }
+
+    bool async = running_.load(std::memory_order_acquire);
+    if (suppressed > 0) {
+        LogRecord note = record;
+        format_suppressed(note, suppressed, reported);
+        emit(ring, async, note);
+    }
+    emit(ring, async, record);
+}
+
+size_t Logger::drain(bool force)
+{
+    std::lock_guard<std::mutex> drain_lock(drain_mutex_);
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings = rings_;
+    }
+
+    std::vector<LogRecord> batch;
+    LogRecord record;
+    size_t dropped = 0;
+    const int64_t now = now_ns();
+    for (auto& ring : rings) {
+        while (ring->pop(record)) {
+            batch.push_back(record);
+        }
+        dropped += ring->take_dropped();
+        // 抑制的条数在窗口结束时输出，不必等同一格式串再次出现；刷新、退出和线程结束时全部输出
+        ring->take_suppressed(now, force || ring->retired.load(std::memory_order_acquire), batch);
+    }
+
+    // 已退出线程的缓冲区读空后移除
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const std::shared_ptr<LogRing>& ring) {
+            return ring->retired.load(std::memory_order_acquire) && ring->empty();
+        }), rings_.end());
+    }
+
+    if (batch.empty() && dropped == 0) {
+        return 0;
+    }
+    std::stable_sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) {
+        return a.time_ns < b.time_ns;
+    });
+
+    std::string out, err;
+    for (const auto& item : batch) {
+        format_line(item.level >= LogLevel::WARN ? err : out, item);
+    }
+    if (dropped > 0) {
+        LogRecord note;
+        note.time_ns = now_ns();
+        note.level = LogLevel::WARN;
+        note.thread_id = 0;
+        int n = std::snprintf(note.text, MAX_MESSAGE, "log buffer full, dropped %zu messages", dropped);
+        note.length = static_cast<uint32_t>(n);
+        format_line(err, note);
+    }
+    if (!out.empty()) {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+    }
+    if (!err.empty()) {
+        std::fwrite(err.data(), 1, err.size(), stderr);
+        std::fflush(stderr);
+    }
+    return batch.size();
+}
+
+void Logger::drain_loop()
+{
+    while (running_.load(std::memory_order_acquire)) {
+        if (drain() == 0) {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait_for(lock, std::chrono::milliseconds(10));
+        }
+    }
+}
+
+void Logger::flush()
+{
+    drain(true);
+}
+
+void Logger::shutdown()
+{
+    if (!running_.exchange(false)) {
+        return;
+    }
+    wake_.notify_all();
+    if (drain_thread_.joinable()) {
+        drain_thread_.join();
+    }
+    drain(true);
+}
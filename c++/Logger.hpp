@@ -0,0 +1,74 @@
+#ifndef FUND_LOGGER_HPP_
+#define FUND_LOGGER_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class LogLevel {
+    DEBUG = 0,
+    INFO,
+    WARN,
+    ERROR,
+    OFF
+};
+
+LogLevel parse_log_level(const std::string& name);
+
+class LogRing;
+
+// 异步日志：每个线程写自己的无锁环形缓冲区（满了直接丢弃，从不阻塞），
+// 由单独的后台线程汇总输出。文本完全相同的 DEBUG/INFO 日志在一个时间窗口内重复过多会被限流，WARN/ERROR 不限流。
+class Logger
+{
+public:
+    static Logger& instance();
+
+    void set_level(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const { return level >= level_.load(std::memory_order_relaxed); }
+
+    void log(LogLevel level, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+    // 把所有线程已写入的日志立即输出
+    void flush();
+    // 输出剩余日志并停止后台线程，之后的日志同步输出
+    void shutdown();
+
+private:
+    Logger();
+    ~Logger();
+
+    LogRing& local_ring();
+    void drain_loop();
+    // force 时同时输出所有尚未报告的抑制条数，否则只输出窗口已结束的
+    size_t drain(bool force = false);
+
+    std::atomic<LogLevel> level_{LogLevel::INFO};
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+
+    std::mutex drain_mutex_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::thread drain_thread_;
+    std::atomic<bool> running_{false};
+};
+
+#define FUND_LOG(level, ...)                                   \
+    do {                                                       \
+        if (Logger::instance().enabled(level)) {               \
+            Logger::instance().log(level, __VA_ARGS__);        \
+        }                                                      \
+    } while (0)
+
+#define LOG_DEBUG(...) FUND_LOG(LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) FUND_LOG(LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARN(...) FUND_LOG(LogLevel::WARN, __VA_ARGS__)
+#define LOG_ERROR(...) FUND_LOG(LogLevel::ERROR, __VA_ARGS__)
+
+#endif  // FUND_LOGGER_HPP_
@@ -0,0 +1,385 @@
+#include "PerfCounters.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "Logger.hpp"
+
+namespace {
+
+struct EventSpec
+{
+    uint32_t type;
+    uint64_t config;
+    const char* name;
+};
+
+// 顺序与 PerfEvent 一致；末级缓存未命中与 perf 工具的 LLC-load-misses 相同
+const EventSpec EVENTS[PERF_EVENT_COUNT] = {
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, "task_clock_ns"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch_misses"},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), "llc_misses"},
+};
+
+const char* const STAGE_NAMES[PERF_STAGE_COUNT] = {"parse", "thresholds", "trade_loop"};
+
+int open_event(const EventSpec& spec, int group_fd)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec.type;
+    attr.config = spec.config;
+    // 只统计用户态，perf_event_paranoid 为 2（多数发行版的默认值）时普通用户也能打开
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+// 一个线程的计数器组，线程退出时关闭
+struct CounterGroup
+{
+    bool tried = false;
+    int fds[PERF_EVENT_COUNT];
+    PerfEvent events[PERF_EVENT_COUNT];  // 读数中第 k 个值对应的事件
+    int count = 0;
+
+    ~CounterGroup()
+    {
+        for (int k = 0; k < count; ++k) {
+            close(fds[k]);
+        }
+    }
+
+    // wanted 中的硬件事件打不开时跳过，记入 opened；组长打不开时返回其 errno
+    int open(const bool wanted[PERF_EVENT_COUNT], bool opened[PERF_EVENT_COUNT])
+    {
+        tried = true;
+        int leader = open_event(EVENTS[TASK_CLOCK], -1);
+        if (leader < 0) {
+            return errno;
+        }
+        fds[0] = leader;
+        events[0] = TASK_CLOCK;
+        count = 1;
+        opened[TASK_CLOCK] = true;
+        for (int event = TASK_CLOCK + 1; event < PERF_EVENT_COUNT; ++event) {
+            opened[event] = false;
+            if (!wanted[event]) {
+                continue;
+            }
+            int fd = open_event(EVENTS[event], leader);
+            if (fd >= 0) {
+                fds[count] = fd;
+                events[count] = static_cast<PerfEvent>(event);
+                ++count;
+                opened[event] = true;
+            }
+        }
+        return 0;
+    }
+};
+
+thread_local CounterGroup counter_group;
+
+const char* unavailable_reason(int error)
+{
+    switch (error) {
+        case ENOSYS:
+            return "the kernel has no perf events";
+        case EACCES:
+        case EPERM:
+            return "permission denied, check /proc/sys/kernel/perf_event_paranoid and the container's seccomp profile";
+        case ENOENT:
+        case EOPNOTSUPP:
+            return "the event is not supported on this machine";
+        default:
+            return std::strerror(error);
+    }
+}
+
+double per_day(uint64_t value, uint64_t days)
+{
+    return days > 0 ? static_cast<double>(value) / static_cast<double>(days) : 0;
+}
+
+}  // namespace
+
+const char* perf_stage_name(PerfStage stage)
+{
+    return STAGE_NAMES[static_cast<size_t>(stage)];
+}
+
+void PerfCounts::add(const PerfCounts& other)
+{
+    calls += other.calls;
+    days += other.days;
+    for (int event = 0; event < PERF_EVENT_COUNT; ++event) {
+        values[event] += other.values[event];
+    }
+}
+
+struct PerfProfile::ThreadTotals
+{
+    std::map<std::string, FundCounts> funds;
+};
+
+std::atomic<bool> PerfProfile::enabled_{false};
+
+PerfProfile& PerfProfile::instance()
+{
+    static PerfProfile profile;
+    return profile;
+}
+
+bool PerfProfile::start()
+{
+    bool wanted[PERF_EVENT_COUNT];
+    std::fill(std::begin(wanted), std::end(wanted), true);
+    int error = counter_group.open(wanted, available_);
+    if (error != 0) {
+        LOG_WARN("Performance counters are unavailable (perf_event_open: %s), profiling is disabled",
+            unavailable_reason(error));
+        return false;
+    }
+    std::string missing;
+    for (int event = TASK_CLOCK + 1; event < PERF_EVENT_COUNT; ++event) {
+        if (!available_[event]) {
+            missing += std::string(missing.empty() ? "" : ", ") + EVENTS[event].name;
+        }
+    }
+    if (!missing.empty()) {
+        LOG_WARN("Hardware counters unavailable (%s), reporting only what the kernel provides", missing.c_str());
+    }
+    enabled_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+bool PerfProfile::read(Reading& reading)
+{
+    if (!counter_group.tried) {
+        bool opened[PERF_EVENT_COUNT];
+        if (counter_group.open(available_, opened) != 0) {
+            return false;
+        }
+    }
+    if (counter_group.count == 0) {
+        return false;
+    }
+    // PERF_FORMAT_GROUP：值的个数、启用时间、实际运行时间，然后按打开顺序是各事件的值
+    uint64_t buffer[3 + PERF_EVENT_COUNT];
+    ssize_t size = ::read(counter_group.fds[0], buffer, sizeof(buffer));
+    if (size < static_cast<ssize_t>((3 + counter_group.count) * sizeof(uint64_t))) {
+        return false;
+    }
+    // 硬件计数器不够时内核轮流调度各组，按运行时间的比例估算全程的计数
+    const uint64_t enabled = buffer[1], running = buffer[2];
+    const double scale = running > 0 && running < enabled ? static_cast<double>(enabled) / running : 1.0;
+    reading.fill(0);
+    for (int k = 0; k < counter_group.count; ++k) {
+        reading[counter_group.events[k]] = scale == 1.0 ? buffer[3 + k]
+            : static_cast<uint64_t>(static_cast<double>(buffer[3 + k]) * scale);
+    }
+    return true;
+}
+
+PerfProfile::ThreadTotals& PerfProfile::local_totals()
+{
+    // 累计值由 PerfProfile 持有，线程退出后仍保留到写出
+    thread_local ThreadTotals* totals = nullptr;
+    if (!totals) {
+        auto created = std::make_unique<ThreadTotals>();
+        std::lock_guard<std::mutex> lock(totals_mutex_);
+        totals = created.get();
+        totals_.push_back(std::move(created));
+    }
+    return *totals;
+}
+
+void PerfProfile::add(PerfStage stage, const char* fund, uint64_t days, const Reading& begin, const Reading& end)
+{
+    if (!enabled()) {
+        return;
+    }
+    PerfCounts& counts = local_totals().funds[fund ? fund : ""][static_cast<size_t>(stage)];
+    ++counts.calls;
+    counts.days += days;
+    for (int event = 0; event < PERF_EVENT_COUNT; ++event) {
+        // 换算后的估计值可能略有回退
+        counts.values[event] += end[event] > begin[event] ? end[event] - begin[event] : 0;
+    }
+}
+
+bool PerfProfile::merge_file(const std::string& path, std::map<std::string, FundCounts>& funds)
+{
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        for (std::string field; std::getline(stream, field, '\t');) {
+            fields.push_back(field);
+        }
+        // 跳过表头和汇总行，汇总由合并后的数据重新计算
+        if (fields.size() < 4 + PERF_EVENT_COUNT || fields[0] == "fund" || fields[0] == "*") {
+            continue;
+        }
+        size_t stage = 0;
+        while (stage < PERF_STAGE_COUNT && fields[1] != STAGE_NAMES[stage]) {
+            ++stage;
+        }
+        if (stage == PERF_STAGE_COUNT) {
+            continue;
+        }
+        PerfCounts counts;
+        counts.calls = std::stoull(fields[2]);
+        counts.days = std::stoull(fields[3]);
+        for (int event = 0; event < PERF_EVENT_COUNT; ++event) {
+            if (fields[4 + event] == "-") {
+                available_[event] = false;
+            } else {
+                counts.values[event] = std::stoull(fields[4 + event]);
+            }
+        }
+        funds[fields[0]][stage].add(counts);
+    }
+    in.close();
+    std::remove(path.c_str());
+    return true;
+}
+
+void PerfProfile::print_summary(const std::array<PerfCounts, PERF_STAGE_COUNT>& stages) const
+{
+    auto column = [this](char* text, size_t size, int event, const PerfCounts& counts) {
+        if (available_[event]) {
+            snprintf(text, size, "%.1f", per_day(counts.values[event], counts.days));
+        } else {
+            snprintf(text, size, "n/a");
+        }
+    };
+    fprintf(stderr, "Performance counters per trading day (user space, n/a = counter unavailable):\n");
+    fprintf(stderr, "%-12s %8s %12s %10s %12s %12s %6s %12s %12s\n",
+        "stage", "calls", "days", "ns", "cycles", "instructions", "IPC", "br-misses", "LLC-misses");
+    for (size_t stage = 0; stage < PERF_STAGE_COUNT; ++stage) {
+        const PerfCounts& counts = stages[stage];
+        if (counts.calls == 0) {
+            continue;
+        }
+        char clock[32], cycles[32], instructions[32], ipc[32], branch_misses[32], llc_misses[32];
+        column(clock, sizeof(clock), TASK_CLOCK, counts);
+        column(cycles, sizeof(cycles), CYCLES, counts);
+        column(instructions, sizeof(instructions), INSTRUCTIONS, counts);
+        column(branch_misses, sizeof(branch_misses), BRANCH_MISSES, counts);
+        column(llc_misses, sizeof(llc_misses), LLC_MISSES, counts);
+        if (available_[CYCLES] && available_[INSTRUCTIONS] && counts.values[CYCLES] > 0) {
+            snprintf(ipc, sizeof(ipc), "%.2f", static_cast<double>(counts.values[INSTRUCTIONS]) / counts.values[CYCLES]);
+        } else {
+            snprintf(ipc, sizeof(ipc), "n/a");
+        }
+        fprintf(stderr, "%-12s %8llu %12llu %10s %12s %12s %6s %12s %12s\n", STAGE_NAMES[stage],
+            static_cast<unsigned long long>(counts.calls), static_cast<unsigned long long>(counts.days),
+            clock, cycles, instructions, ipc, branch_misses, llc_misses);
+    }
+}
+
+bool PerfProfile::write(const std::string& path, const std::vector<std::string>& merge_files)
+{
+    const bool started = enabled();
+    enabled_.store(false, std::memory_order_relaxed);
+    std::map<std::string, FundCounts> funds;
+    {
+        std::lock_guard<std::mutex> lock(totals_mutex_);
+        for (const auto& totals : totals_) {
+            for (const auto& [fund, stages] : totals->funds) {
+                for (size_t stage = 0; stage < PERF_STAGE_COUNT; ++stage) {
+                    funds[fund][stage].add(stages[stage]);
+                }
+            }
+        }
+    }
+    bool merged = false;
+    for (const auto& merge_file_path : merge_files) {
+        merged = merge_file(merge_file_path, funds) || merged;
+    }
+    if (!started && !merged) {
+        return true;
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        LOG_ERROR("无法创建计数器文件: %s", path.c_str());
+        return false;
+    }
+    std::fprintf(file, "fund\tstage\tcalls\tdays");
+    for (const EventSpec& spec : EVENTS) {
+        std::fprintf(file, "\t%s", spec.name);
+    }
+    std::fprintf(file, "\tns_per_day\tcycles_per_day\tipc\tbranch_misses_per_day\tllc_misses_per_day\n");
+    auto write_row = [this, file](const std::string& fund, size_t stage, const PerfCounts& counts) {
+        std::fprintf(file, "%s\t%s\t%llu\t%llu", fund.c_str(), STAGE_NAMES[stage],
+            static_cast<unsigned long long>(counts.calls), static_cast<unsigned long long>(counts.days));
+        for (int event = 0; event < PERF_EVENT_COUNT; ++event) {
+            if (available_[event]) {
+                std::fprintf(file, "\t%llu", static_cast<unsigned long long>(counts.values[event]));
+            } else {
+                std::fprintf(file, "\t-");
+            }
+        }
+        for (int event : {TASK_CLOCK, CYCLES}) {
+            if (available_[event]) {
+                std::fprintf(file, "\t%.3f", per_day(counts.values[event], counts.days));
+            } else {
+                std::fprintf(file, "\t-");
+            }
+        }
+        if (available_[CYCLES] && available_[INSTRUCTIONS] && counts.values[CYCLES] > 0) {
+            std::fprintf(file, "\t%.3f", static_cast<double>(counts.values[INSTRUCTIONS]) / counts.values[CYCLES]);
+        } else {
+            std::fprintf(file, "\t-");
+        }
+        for (int event : {BRANCH_MISSES, LLC_MISSES}) {
+            if (available_[event]) {
+                std::fprintf(file, "\t%.3f", per_day(counts.values[event], counts.days));
+            } else {
+                std::fprintf(file, "\t-");
+            }
+        }
+        std::fprintf(file, "\n");
+    };
+    std::array<PerfCounts, PERF_STAGE_COUNT> stages;
+    for (const auto& [fund, fund_stages] : funds) {
+        for (size_t stage = 0; stage < PERF_STAGE_COUNT; ++stage) {
+            if (fund_stages[stage].calls > 0) {
+                write_row(fund, stage, fund_stages[stage]);
+                stages[stage].add(fund_stages[stage]);
+            }
+        }
+    }
+    // 各阶段的汇总行，基金列为 *
+    for (size_t stage = 0; stage < PERF_STAGE_COUNT; ++stage) {
+        if (stages[stage].calls > 0) {
+            write_row("*", stage, stages[stage]);
+        }
+    }
+    if (std::fclose(file) != 0) {
+        LOG_ERROR("写入计数器文件失败: %s", path.c_str());
+        return false;
+    }
+    print_summary(stages);
+    LOG_INFO("Wrote performance counters of %zu funds to %s", funds.size(), path.c_str());
+    return true;
+}
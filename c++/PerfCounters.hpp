@@ -0,0 +1,100 @@
+#ifndef FUND_PERFCOUNTERS_HPP_
+#define FUND_PERFCOUNTERS_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 性能计数器剖析：用 perf_event_open 在解析、阈值和交易循环三个阶段前后读取本线程的计数器组，
+// 按基金和阶段累计周期、指令、分支预测失败和末级缓存未命中，并换算成每个交易日的数值。
+// 计数器组以软件事件 task-clock 为首，硬件事件能打开几个用几个：容器和虚拟机里常常没有硬件计数器，
+// 这时只报告 task-clock；连 perf_event_open 都不可用时剖析不启用，运行照常进行。
+// 没有启用时每个剖析点只有一次 relaxed 读
+
+enum class PerfStage { PARSE, THRESHOLDS, TRADE_LOOP };
+const size_t PERF_STAGE_COUNT = 3;
+const char* perf_stage_name(PerfStage stage);
+
+// 计数器组中的事件，TASK_CLOCK 是组长
+enum PerfEvent { TASK_CLOCK, CYCLES, INSTRUCTIONS, BRANCH_MISSES, LLC_MISSES, PERF_EVENT_COUNT };
+
+struct PerfCounts
+{
+    uint64_t calls = 0;
+    uint64_t days = 0;  // 该阶段处理的交易日数（解析阶段为解析出的净值点数）
+    std::array<uint64_t, PERF_EVENT_COUNT> values{};
+
+    void add(const PerfCounts& other);
+};
+
+class PerfProfile
+{
+public:
+    using Reading = std::array<uint64_t, PERF_EVENT_COUNT>;
+
+    static PerfProfile& instance();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // 在调用线程上试开计数器组，确定哪些事件可用；perf_event_open 不可用时记录原因并返回 false，不启用剖析
+    bool start();
+
+    // 本线程计数器组的当前读数（已按多路复用的运行比例换算），首次调用时打开组；组打不开时返回 false
+    bool read(Reading& reading);
+    void add(PerfStage stage, const char* fund, uint64_t days, const Reading& begin, const Reading& end);
+
+    // 停止剖析，把每个基金、每个阶段的计数写成制表符分隔的文件，并把各阶段的汇总输出到标准错误。
+    // merge_files 是分片工作进程写出的同格式文件，并入后删除。调用时其他线程不能再记录
+    bool write(const std::string& path, const std::vector<std::string>& merge_files = {});
+
+private:
+    using FundCounts = std::array<PerfCounts, PERF_STAGE_COUNT>;
+    struct ThreadTotals;
+
+    PerfProfile() = default;
+    ThreadTotals& local_totals();
+    bool merge_file(const std::string& path, std::map<std::string, FundCounts>& funds);
+    void print_summary(const std::array<PerfCounts, PERF_STAGE_COUNT>& stages) const;
+
+    static std::atomic<bool> enabled_;
+
+    std::mutex totals_mutex_;
+    std::vector<std::unique_ptr<ThreadTotals>> totals_;
+    bool available_[PERF_EVENT_COUNT] = {};
+};
+
+// 作用域内的一个阶段；处理的天数在构造时未知的（解析）之后用 set_days 补上
+class PerfScope
+{
+public:
+    PerfScope(PerfStage stage, const char* fund, uint64_t days = 0)
+        : stage_(stage), fund_(fund), days_(days), active_(PerfProfile::enabled() && PerfProfile::instance().read(begin_))
+    {
+    }
+    ~PerfScope()
+    {
+        PerfProfile::Reading end;
+        if (active_ && PerfProfile::instance().read(end)) {
+            PerfProfile::instance().add(stage_, fund_, days_, begin_, end);
+        }
+    }
+
+    void set_days(uint64_t days) { days_ = days; }
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    PerfStage stage_;
+    const char* fund_;
+    uint64_t days_;
+    PerfProfile::Reading begin_;
+    bool active_;
+};
+
+#endif  // FUND_PERFCOUNTERS_HPP_
@@ -0,0 +1,128 @@
+#include "ReferenceEngine.hpp"
+
+#include <algorithm>
+#include <vector>
+
+// 以下逻辑是冻结的，不要为了性能或风格修改
+
+static const double BASE = 1;
+
+Thredhold reference_thresholds(const FundData& fund_data, size_t start, size_t end, const ResultParameters& parameters)
+{
+    std::vector<double> values;
+    for (size_t i = start; i < end; ++i) {
+        values.push_back(fund_data.price(i));
+    }
+    std::sort(values.begin(), values.end());
+
+    size_t n = values.size();
+    Thredhold thresholds;
+    if (n > 0) {
+        // 分位阈值在配置中是 float，按 float 相乘取下标
+        size_t high_index = std::min(static_cast<size_t>(n * static_cast<float>(parameters.threshold_high)), n - 1);
+        size_t low_index = std::min(static_cast<size_t>(n * static_cast<float>(parameters.threshold_low)), n - 1);
+        thresholds.percentile_high = values[high_index];
+        thresholds.percentile_low = values[low_index];
+    }
+    return thresholds;
+}
+
+GridOutcome reference_run_grid(const FundData& fund_data, size_t start, size_t end, const ResultParameters& parameters)
+{
+    const double grid_size = parameters.grid_size;
+    const double big_grid_size = parameters.big_grid_size;
+    const double amount = parameters.amount;
+    const double big_amount = parameters.amount * parameters.factor;
+
+    GridOutcome outcome;
+    outcome.start = start;
+    outcome.end = end;
+    outcome.thresholds = reference_thresholds(fund_data, start, end, parameters);
+    const Thredhold& thresholds = outcome.thresholds;
+    double current_balance = parameters.sum;
+    double touched_lowest_balance = current_balance;
+    double current_holdings = 0;
+    double total_profit = 0;
+    double current_base_price = fund_data.price(start);
+    double current_big_base_price = fund_data.price(start);
+    std::vector<TradeOperation>& operations = outcome.operations;
+    for (size_t i = start; i < end; ++i) {
+        long timestamp = fund_data.timestamp(i);
+        double price = fund_data.price(i);
+        if (current_base_price * (BASE - grid_size) >= price and price < thresholds.percentile_high and price >= thresholds.percentile_low) {
+            TradeOperation operation;
+            if (current_balance < amount) {
+                operation.money_not_enough = true;
+                operation.buy_timestamp = timestamp;
+                operation.buy_price = price;
+                operations.push_back(operation);
+            }
+            else {
+                current_balance -= amount;
+                touched_lowest_balance = std::min(touched_lowest_balance, current_balance);
+                current_holdings += amount / price;
+                current_base_price = price;
+                operation.buy_timestamp = timestamp;
+                operation.buy_price = price;
+                operations.push_back(operation);
+            }
+        }
+        else if (current_big_base_price * (BASE - grid_size) >= price and price < thresholds.percentile_low) {
+            TradeOperation operation;
+            if (current_balance < big_amount) {
+                operation.money_not_enough = true;
+                operation.buy_timestamp = timestamp;
+                operation.buy_price = price;
+                operation.big_grid_size = true;
+                operations.push_back(operation);
+            }
+            else {
+                current_balance -= big_amount;
+                touched_lowest_balance = std::min(touched_lowest_balance, current_balance);
+                current_holdings += big_amount / price;
+                current_big_base_price = price;
+                operation.buy_timestamp = timestamp;
+                operation.buy_price = price;
+                operation.big_grid_size = true;
+                operations.push_back(operation);
+            }
+        }
+        else if (current_base_price * (BASE + grid_size) <= price) {
+            current_base_price = price; // 更新基准价格
+            for (auto& operation : operations) {
+                if (operation.money_not_enough || operation.dealed || operation.big_grid_size || operation.buy_price * (BASE + grid_size) > price) {
+                    continue;
+                }
+                operation.sell_timestamp = timestamp;
+                operation.sell_price = price;
+                double profit = (amount / operation.buy_price) * operation.sell_price - amount;
+                total_profit += profit;
+                current_balance += (amount / operation.buy_price) * operation.sell_price;
+                current_holdings -= amount / operation.buy_price;
+                operation.dealed = true;
+            }
+        }
+        else if (current_big_base_price * (BASE + big_grid_size) <= price) {
+            current_big_base_price = price; // 更新基准价格
+            for (auto& operation : operations) {
+                if (operation.money_not_enough || operation.dealed || !operation.big_grid_size || operation.buy_price * (BASE + big_grid_size) > price) {
+                    continue;
+                }
+                operation.sell_timestamp = timestamp;
+                operation.sell_price = price;
+                double profit = (big_amount / operation.buy_price) * operation.sell_price - big_amount;
+                total_profit += profit;
+                current_balance += (big_amount / operation.buy_price) * operation.sell_price;
+                current_holdings -= big_amount / operation.buy_price;
+                operation.dealed = true;
+            }
+        }
+    }
+    // 区间截止于序列末尾时取最后一个净值
+    outcome.latest_price = fund_data.price(std::min(end, fund_data.size() - 1));
+    outcome.balance = current_balance;
+    outcome.holdings = current_holdings;
+    outcome.total_profit = total_profit;
+    outcome.touched_lowest_balance = touched_lowest_balance;
+    return outcome;
+}
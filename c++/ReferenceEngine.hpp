@@ -0,0 +1,22 @@
+#ifndef FUND_REFERENCEENGINE_HPP_
+#define FUND_REFERENCEENGINE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "FundData.hpp"
+#include "GridEngine.hpp"
+
+// 网格回测的参考实现：ENGINE_VERSION 1 的 calculate_profit / run_grid 逻辑原样冻结于此，
+// 不做任何优化，也不记录日志、跟踪或计数。任何更快的实现（向量化、跳过无事件的交易日、
+// 未平仓账本、定点数净值……）都要用 funddiff 与它逐笔对比，结果一致才能替换 run_grid。
+// 有意改变结果的修改同时改这里和 run_grid，并增加 ENGINE_VERSION
+
+const uint64_t REFERENCE_ENGINE_VERSION = 1;
+
+Thredhold reference_thresholds(const FundData& fund_data, size_t start, size_t end, const ResultParameters& parameters);
+
+// 与 run_grid 的约定相同：start < end <= fund_data.size()
+GridOutcome reference_run_grid(const FundData& fund_data, size_t start, size_t end, const ResultParameters& parameters);
+
+#endif  // FUND_REFERENCEENGINE_HPP_
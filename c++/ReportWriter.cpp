@@ -0,0 +1,177 @@
+#include "ReportWriter.hpp"
+
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+#include "AllocTracker.hpp"
+#include "FundData.hpp"
+#include "Logger.hpp"
+#include "Trace.hpp"
+
+namespace {
+
+// 1970-01-01 到 2099-12-31
+const int DAY_TABLE_SIZE = 47482;
+
+void civil_from_days(int days, char* out)
+{
+    long z = days + 719468L;
+    long era = (z >= 0 ? z : z - 146096) / 146097;
+    long doe = z - era * 146097;
+    long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long year = yoe + era * 400;
+    long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long mp = (5 * doy + 2) / 153;
+    long day = doy - (153 * mp + 2) / 5 + 1;
+    long month = mp < 10 ? mp + 3 : mp - 9;
+    year += month <= 2;
+    if (year < 0 || year > 9999) {
+        std::memcpy(out, "0000-00-00", 11);
+        return;
+    }
+    const char* digits = "0123456789";
+    out[0] = digits[year / 1000];
+    out[1] = digits[year / 100 % 10];
+    out[2] = digits[year / 10 % 10];
+    out[3] = digits[year % 10];
+    out[4] = '-';
+    out[5] = digits[month / 10];
+    out[6] = digits[month % 10];
+    out[7] = '-';
+    out[8] = digits[day / 10];
+    out[9] = digits[day % 10];
+    out[10] = '\0';
+}
+
+const std::vector<std::array<char, 11>>& day_table()
+{
+    static const std::vector<std::array<char, 11>> table = []() {
+        std::vector<std::array<char, 11>> dates(DAY_TABLE_SIZE);
+        for (int day = 0; day < DAY_TABLE_SIZE; ++day) {
+            civil_from_days(day, dates[day].data());
+        }
+        return dates;
+    }();
+    return table;
+}
+
+}  // namespace
+
+const char* format_day(int day)
+{
+    if (day >= 0 && day < DAY_TABLE_SIZE) {
+        return day_table()[day].data();
+    }
+    thread_local char buffer[16];
+    civil_from_days(day, buffer);
+    return buffer;
+}
+
+ReportBuffer& ReportBuffer::thread_local_buffer()
+{
+    thread_local ReportBuffer buffer;
+    buffer.clear();
+    return buffer;
+}
+
+ReportBuffer& ReportBuffer::operator<<(double value)
+{
+    char digits[64];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, 2);
+    text_.append(digits, result.ptr);
+    return *this;
+}
+
+ReportBuffer& ReportBuffer::operator<<(long value)
+{
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    text_.append(digits, result.ptr);
+    return *this;
+}
+
+ReportBuffer& ReportBuffer::date(long timestamp)
+{
+    text_.append(format_day(day_index(timestamp)), 10);
+    return *this;
+}
+
+ReportWriter::ReportWriter(bool async) : async_(async)
+{
+    if (async_) {
+        thread_ = std::thread(&ReportWriter::run, this);
+    }
+}
+
+ReportWriter::~ReportWriter()
+{
+    if (!async_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void ReportWriter::write(const std::string& path, ReportBuffer& buffer)
+{
+    if (!async_) {
+        write_file(path, buffer.str());
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.emplace_back(path, std::move(buffer.str()));
+    }
+    buffer.str().clear();
+    wake_.notify_one();
+}
+
+bool ReportWriter::write_file(const std::string& path, const std::string& content)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("无法打开报告文件: %s", path.c_str());
+        return false;
+    }
+    size_t written = 0;
+    while (written < content.size()) {
+        ssize_t n = ::write(fd, content.data() + written, content.size() - written);
+        if (n <= 0) {
+            LOG_ERROR("写入报告文件失败: %s", path.c_str());
+            ::close(fd);
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    return true;
+}
+
+void ReportWriter::run()
+{
+    TRACE_THREAD_NAME("report writer");
+    AllocTracker::set_thread_stage(AllocStage::REPORT);
+    while (true) {
+        std::deque<std::pair<std::string, std::string>> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+            if (queue_.empty() && stop_) {
+                return;
+            }
+            batch.swap(queue_);
+        }
+        TRACE_SCOPE("write reports", "report");
+        for (const auto& [path, content] : batch) {
+            write_file(path, content);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef FUND_REPORTWRITER_HPP_
+#define FUND_REPORTWRITER_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+// 天数（自 1970-01-01 起）对应的 "YYYY-MM-DD"，常用范围查预先生成的表，线程安全
+const char* format_day(int day);
+
+// 报告格式化缓冲区：每个线程复用一个，浮点数用 to_chars 固定两位小数输出
+class ReportBuffer
+{
+public:
+    static ReportBuffer& thread_local_buffer();
+
+    void clear() { text_.clear(); }
+    std::string& str() { return text_; }
+
+    ReportBuffer& operator<<(const char* text) { text_.append(text); return *this; }
+    ReportBuffer& operator<<(const std::string& text) { text_.append(text); return *this; }
+    ReportBuffer& operator<<(char c) { text_.push_back(c); return *this; }
+    ReportBuffer& operator<<(double value);
+    ReportBuffer& operator<<(long value);
+    ReportBuffer& operator<<(int value) { return *this << static_cast<long>(value); }
+
+    // 追加时间戳对应的日期
+    ReportBuffer& date(long timestamp);
+
+private:
+    std::string text_;
+};
+
+// 把整份报告一次 write 到文件；异步模式下由单独的线程写盘
+class ReportWriter
+{
+public:
+    explicit ReportWriter(bool async);
+    ~ReportWriter();
+
+    ReportWriter(const ReportWriter&) = delete;
+    ReportWriter& operator=(const ReportWriter&) = delete;
+
+    // 同步模式直接写出 buffer；异步模式取走 buffer 的内容入队
+    void write(const std::string& path, ReportBuffer& buffer);
+
+private:
+    static bool write_file(const std::string& path, const std::string& content);
+    void run();
+
+    bool async_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::pair<std::string, std::string>> queue_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+#endif  // FUND_REPORTWRITER_HPP_
@@ -0,0 +1,79 @@
+#include "ResultCache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+const uint64_t MULTIPLIER = 0xff51afd7ed558ccdULL;
+
+uint64_t rotate_left(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t finalize(uint64_t value)
+{
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+}  // namespace
+
+ContentHasher& ContentHasher::add(uint64_t value)
+{
+    state_ = rotate_left(state_ ^ (value * MULTIPLIER), 29) * 0xc4ceb9fe1a85ec53ULL;
+    ++count_;
+    return *this;
+}
+
+ContentHasher& ContentHasher::add(double value)
+{
+    // -0.0 与 0.0 的结果相同，按同一个值处理
+    if (value == 0) {
+        value = 0;
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return add(bits);
+}
+
+ContentHasher& ContentHasher::add(const std::string& text)
+{
+    add(static_cast<uint64_t>(text.size()));
+    for (size_t i = 0; i < text.size(); i += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        std::memcpy(&word, text.data() + i, std::min(sizeof(word), text.size() - i));
+        add(word);
+    }
+    return *this;
+}
+
+ContentHasher& ContentHasher::add(const FundData& fund_data, size_t begin, size_t end)
+{
+    add(static_cast<uint64_t>(end - begin));
+    for (size_t i = begin; i < end; ++i) {
+        add(static_cast<uint64_t>(fund_data.timestamp(i)));
+        add(fund_data.price(i));
+    }
+    return *this;
+}
+
+uint64_t ContentHasher::value() const
+{
+    return finalize(state_ ^ count_);
+}
+
+ResultCache::ResultCache(std::vector<long long> keys)
+    : keys_(std::move(keys))
+{
+}
+
+bool ResultCache::contains(long long key) const
+{
+    return std::binary_search(keys_.begin(), keys_.end(), key);
+}
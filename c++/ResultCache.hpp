@@ -0,0 +1,44 @@
+#ifndef FUND_RESULTCACHE_HPP_
+#define FUND_RESULTCACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FundData.hpp"
+
+// 结果缓存键的哈希：按 64 位字累加，最后做一次 splitmix64 混合。
+// 同样的输入在任何机器和运行中都得到同样的值，键会持久化到结果库
+class ContentHasher
+{
+public:
+    ContentHasher& add(uint64_t value);
+    ContentHasher& add(double value);
+    ContentHasher& add(const std::string& text);
+    // 净值序列区间 [begin, end) 的时间戳和净值
+    ContentHasher& add(const FundData& fund_data, size_t begin, size_t end);
+
+    uint64_t value() const;
+
+private:
+    uint64_t state_ = 0x9e3779b97f4a7c15ULL;
+    uint64_t count_ = 0;
+};
+
+// 结果库中已有结果的键，按值排序后二分查找。加载后只读，计算线程可以并发查询
+class ResultCache
+{
+public:
+    ResultCache() = default;
+    // keys 需按升序排列（TB_RESULT_CACHE 的主键顺序）
+    explicit ResultCache(std::vector<long long> keys);
+
+    bool contains(long long key) const;
+    size_t size() const { return keys_.size(); }
+
+private:
+    std::vector<long long> keys_;
+};
+
+#endif  // FUND_RESULTCACHE_HPP_
@@ -0,0 +1,432 @@
+#include "RunProgress.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <nlohmann/json.hpp>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Logger.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+const size_t RING_CAPACITY = 65536;
+const size_t MAX_PENDING_BYTES = 4 * 1024 * 1024;  // 读得太慢的客户端超过这么多未发送的数据时断开
+
+const char* const COUNTER_NAMES[RunProgress::COUNTER_COUNT] = {
+    "funds_queued", "series_cached", "series_downloaded", "series_failed",
+    "periods_computed", "periods_cached", "periods_empty", "funds_done",
+};
+
+const char* fund_status(ProgressEvent::Type type)
+{
+    switch (type) {
+        case ProgressEvent::FUND_NO_DATA: return "no_data";
+        case ProgressEvent::FUND_FAILED: return "failed";
+        default: return "done";
+    }
+}
+
+void copy_text(char* target, size_t size, const std::string& text)
+{
+    size_t length = std::min(text.size(), size - 1);
+    std::memcpy(target, text.data(), length);
+    target[length] = '\0';
+}
+
+int listen_unix(const std::string& path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        LOG_ERROR("progress_socket path too long: %s", path.c_str());
+        return -1;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    ::unlink(path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, 16) != 0) {
+        LOG_ERROR("Cannot listen on progress socket %s: %s", path.c_str(), std::strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+int listen_tcp(int port)
+{
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0
+        || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, 16) != 0) {
+        LOG_ERROR("Cannot listen on progress port %d: %s", port, std::strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+}  // namespace
+
+ProgressRing::ProgressRing(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    cells_.reset(new Cell[size]);
+    for (size_t i = 0; i < size; ++i) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask_ = size - 1;
+}
+
+bool ProgressRing::push(const ProgressEvent& event)
+{
+    size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells_[position & mask_];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+            if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = enqueue_position_.load(std::memory_order_relaxed);
+        }
+    }
+    cell->event = event;
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool ProgressRing::pop(ProgressEvent& event)
+{
+    Cell* cell = &cells_[dequeue_position_ & mask_];
+    if (cell->sequence.load(std::memory_order_acquire) != dequeue_position_ + 1) {
+        return false;
+    }
+    event = cell->event;
+    cell->sequence.store(dequeue_position_ + mask_ + 1, std::memory_order_release);
+    ++dequeue_position_;
+    return true;
+}
+
+struct RunProgress::Client
+{
+    int fd = -1;
+    bool sse = false;      // TCP 端口上的客户端按 Server-Sent Events 格式输出
+    bool reading = true;   // 对端关闭写方向后不再读，只推送
+    std::string pending;
+};
+
+// 发布线程：poll 监听套接字、客户端和 eventfd，每 interval_ms 汇总一次
+struct RunProgress::Publisher
+{
+    RunProgress& progress;
+    int unix_fd = -1;
+    int tcp_fd = -1;
+    int wake_fd = -1;
+    std::atomic<bool> stop{false};
+    std::vector<Client> clients;
+    std::vector<ProgressEvent> top;
+    std::thread thread;
+
+    explicit Publisher(RunProgress& owner) : progress(owner) {}
+
+    ~Publisher()
+    {
+        for (const Client& client : clients) {
+            close(client.fd);
+        }
+        for (int fd : {unix_fd, tcp_fd, wake_fd}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        if (unix_fd >= 0) {
+            ::unlink(progress.options_.socket_path.c_str());
+        }
+    }
+
+    void emit(const char* type, json body)
+    {
+        body["type"] = type;
+        std::string line = body.dump();
+        for (Client& client : clients) {
+            if (client.sse) {
+                client.pending.append("event: ").append(type).append("\ndata: ").append(line).append("\n\n");
+            } else {
+                client.pending.append(line).append("\n");
+            }
+        }
+    }
+
+    void accept_clients(int listen_fd, bool sse)
+    {
+        while (true) {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            Client client;
+            client.fd = fd;
+            client.sse = sse;
+            // 不解析请求，连上即开始推送；请求内容在 drain 中丢弃
+            if (sse) {
+                client.pending = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                    "Access-Control-Allow-Origin: *\r\nConnection: keep-alive\r\n\r\n";
+            }
+            clients.push_back(std::move(client));
+        }
+    }
+
+    // 写出缓冲的数据；对端关闭、出错或积压过多时返回 false
+    static bool flush(Client& client)
+    {
+        while (!client.pending.empty()) {
+            ssize_t sent = send(client.fd, client.pending.data(), client.pending.size(), MSG_NOSIGNAL);
+            if (sent > 0) {
+                client.pending.erase(0, static_cast<size_t>(sent));
+            } else if (sent < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && client.pending.size() <= MAX_PENDING_BYTES;
+            }
+        }
+        return true;
+    }
+
+    // 丢弃客户端发来的数据；读出错时返回 false
+    static bool drain(Client& client)
+    {
+        char buffer[4096];
+        while (true) {
+            ssize_t received = read(client.fd, buffer, sizeof(buffer));
+            if (received > 0) {
+                continue;
+            }
+            if (received == 0) {
+                client.reading = false;
+                return true;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+    }
+
+    void remember_top(const ProgressEvent& event)
+    {
+        if (progress.options_.top == 0) {
+            return;
+        }
+        auto position = std::upper_bound(top.begin(), top.end(), event, [](const ProgressEvent& a, const ProgressEvent& b) {
+            return a.profit > b.profit;
+        });
+        if (static_cast<size_t>(position - top.begin()) < progress.options_.top) {
+            top.insert(position, event);
+            if (top.size() > progress.options_.top) {
+                top.pop_back();
+            }
+        }
+    }
+
+    // 取出计算线程的事件，逐条转发
+    void forward_events()
+    {
+        ProgressEvent event;
+        while (progress.ring_.pop(event)) {
+            if (event.type == ProgressEvent::RESULT) {
+                remember_top(event);
+                emit("result", {{"fund_code", std::string(event.fund_code)}, {"period", std::string(event.period)},
+                    {"profit", event.profit}, {"total_value", event.total_value}});
+            } else {
+                emit("fund", {{"fund_code", std::string(event.fund_code)}, {"status", fund_status(event.type)}});
+            }
+        }
+    }
+
+    json summary() const
+    {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - progress.started_).count();
+        json body;
+        body["elapsed_ms"] = static_cast<long long>(elapsed * 1000);
+        body["funds_total"] = progress.funds_total_;
+        for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+            body[COUNTER_NAMES[i]] = progress.counters_[i].load(std::memory_order_relaxed);
+        }
+        size_t done = progress.counters_[FUNDS_DONE].load(std::memory_order_relaxed)
+            + progress.counters_[SERIES_FAILED].load(std::memory_order_relaxed);
+        body["funds_per_second"] = elapsed > 0 ? done / elapsed : 0.0;
+        body["events_dropped"] = progress.dropped_.load(std::memory_order_relaxed);
+        json best = json::array();
+        for (const auto& event : top) {
+            best.push_back({{"fund_code", std::string(event.fund_code)}, {"period", std::string(event.period)},
+                {"profit", event.profit}, {"total_value", event.total_value}});
+        }
+        body["top"] = std::move(best);
+        return body;
+    }
+
+    void flush_clients(bool final)
+    {
+        std::vector<Client> kept;
+        for (Client& client : clients) {
+            if (flush(client) && !final) {
+                kept.push_back(std::move(client));
+            } else {
+                close(client.fd);
+            }
+        }
+        clients.swap(kept);
+    }
+
+    void run()
+    {
+        const auto interval = std::chrono::milliseconds(progress.options_.interval_ms);
+        auto next_tick = std::chrono::steady_clock::now();
+        while (!stop.load()) {
+            std::vector<pollfd> fds;
+            fds.push_back({wake_fd, POLLIN, 0});
+            fds.push_back({unix_fd, POLLIN, 0});
+            fds.push_back({tcp_fd, POLLIN, 0});
+            for (const Client& client : clients) {
+                fds.push_back({client.fd, static_cast<short>((client.reading ? POLLIN : 0) | (client.pending.empty() ? 0 : POLLOUT)), 0});
+            }
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_tick - std::chrono::steady_clock::now());
+            poll(fds.data(), fds.size(), static_cast<int>(std::max<long long>(wait.count(), 0)));
+
+            if (fds[0].revents & POLLIN) {
+                uint64_t value;
+                while (read(wake_fd, &value, sizeof(value)) > 0) {}
+            }
+            std::vector<Client> kept;
+            for (size_t i = 0; i < clients.size(); ++i) {
+                short events = fds[3 + i].revents;
+                bool alive = !(events & (POLLERR | POLLHUP | POLLNVAL)) && (!(events & POLLIN) || drain(clients[i]));
+                if (alive && (events & POLLOUT)) {
+                    alive = flush(clients[i]);
+                }
+                if (alive) {
+                    kept.push_back(std::move(clients[i]));
+                } else {
+                    close(clients[i].fd);
+                }
+            }
+            clients.swap(kept);
+            if (fds[1].revents & POLLIN) {
+                accept_clients(unix_fd, false);
+            }
+            if (fds[2].revents & POLLIN) {
+                accept_clients(tcp_fd, true);
+            }
+            if (std::chrono::steady_clock::now() >= next_tick) {
+                forward_events();
+                emit("progress", summary());
+                flush_clients(false);
+                next_tick = std::chrono::steady_clock::now() + interval;
+            }
+        }
+        forward_events();
+        emit("progress", summary());
+        emit("done", summary());
+        // 最后的事件尽量写完：每个客户端最多等 1 秒
+        for (Client& client : clients) {
+            int flags = fcntl(client.fd, F_GETFL);
+            fcntl(client.fd, F_SETFL, flags & ~O_NONBLOCK);
+            timeval timeout{1, 0};
+            setsockopt(client.fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        }
+        flush_clients(true);
+    }
+};
+
+RunProgress::RunProgress(size_t funds_total, Options options)
+    : funds_total_(funds_total), options_(std::move(options)), started_(std::chrono::steady_clock::now()),
+      ring_(options_.socket_path.empty() && options_.port <= 0 ? 1 : RING_CAPACITY)
+{
+    if (options_.socket_path.empty() && options_.port <= 0) {
+        return;
+    }
+    auto publisher = std::make_unique<Publisher>(*this);
+    publisher->unix_fd = options_.socket_path.empty() ? -1 : listen_unix(options_.socket_path);
+    publisher->tcp_fd = options_.port > 0 ? listen_tcp(options_.port) : -1;
+    publisher->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((publisher->unix_fd < 0 && publisher->tcp_fd < 0) || publisher->wake_fd < 0) {
+        return;
+    }
+    if (publisher->unix_fd >= 0) {
+        LOG_INFO("Publishing progress as NDJSON on %s", options_.socket_path.c_str());
+    }
+    if (publisher->tcp_fd >= 0) {
+        LOG_INFO("Publishing progress as Server-Sent Events on 127.0.0.1:%d", options_.port);
+    }
+    publisher_ = std::move(publisher);
+    publisher_->thread = std::thread(&Publisher::run, publisher_.get());
+}
+
+RunProgress::~RunProgress()
+{
+    finish();
+}
+
+void RunProgress::finish()
+{
+    if (!publisher_) {
+        return;
+    }
+    publisher_->stop.store(true);
+    uint64_t one = 1;
+    (void)write(publisher_->wake_fd, &one, sizeof(one));
+    publisher_->thread.join();
+    publisher_.reset();
+}
+
+void RunProgress::publish(ProgressEvent event)
+{
+    if (!publisher_) {
+        return;
+    }
+    if (!ring_.push(event)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void RunProgress::fund_finished(const std::string& fund_code, ProgressEvent::Type type)
+{
+    ProgressEvent event;
+    event.type = type;
+    copy_text(event.fund_code, sizeof(event.fund_code), fund_code);
+    publish(event);
+}
+
+void RunProgress::result(const std::string& fund_code, const std::string& period, double profit, double total_value)
+{
+    ProgressEvent event;
+    event.type = ProgressEvent::RESULT;
+    copy_text(event.fund_code, sizeof(event.fund_code), fund_code);
+    copy_text(event.period, sizeof(event.period), period);
+    event.profit = profit;
+    event.total_value = total_value;
+    publish(event);
+}
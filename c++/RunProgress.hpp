@@ -0,0 +1,105 @@
+#ifndef FUND_RUNPROGRESS_HPP_
+#define FUND_RUNPROGRESS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 计算线程产生的事件，定长，放进环形队列时不分配内存
+struct ProgressEvent
+{
+    enum Type : uint8_t { FUND_DONE, FUND_NO_DATA, FUND_FAILED, RESULT };
+
+    Type type = FUND_DONE;
+    char fund_code[16] = {};
+    char period[8] = {};
+    double profit = 0;
+    double total_value = 0;
+};
+
+// 有界的多生产者环形队列（Vyukov），入队只有一次 CAS，队列满时返回 false，生产者从不等待
+class ProgressRing
+{
+public:
+    explicit ProgressRing(size_t capacity);  // capacity 向上取 2 的幂
+
+    bool push(const ProgressEvent& event);
+    // 只由发布线程调用
+    bool pop(ProgressEvent& event);
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        ProgressEvent event;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> enqueue_position_{0};
+    alignas(64) size_t dequeue_position_ = 0;
+};
+
+// 批量运行的进度：各阶段计数、每个基金的完成情况和当前收益最高的结果。
+// 计算线程只做原子加和无锁入队；单独的发布线程定时汇总，以换行分隔的 JSON 写给 Unix 套接字上的客户端，
+// 以 Server-Sent Events 写给 TCP 端口上的 HTTP 客户端（浏览器的 EventSource）。没有配置监听时不启动发布线程
+class RunProgress
+{
+public:
+    enum Counter {
+        FUNDS_QUEUED,
+        SERIES_CACHED,      // 从快照或 TB_PRICE 取得序列
+        SERIES_DOWNLOADED,
+        SERIES_FAILED,      // 下载失败或没有数据
+        PERIODS_COMPUTED,
+        PERIODS_CACHED,     // 结果缓存命中，跳过
+        PERIODS_EMPTY,      // 区间内没有净值
+        FUNDS_DONE,
+        COUNTER_COUNT
+    };
+
+    struct Options
+    {
+        std::string socket_path;  // 为空时不监听 Unix 套接字
+        int port = 0;             // 0 时不监听 TCP 端口
+        int interval_ms = 500;
+        size_t top = 10;
+    };
+
+    RunProgress(size_t funds_total, Options options);
+    ~RunProgress();
+
+    RunProgress(const RunProgress&) = delete;
+    RunProgress& operator=(const RunProgress&) = delete;
+
+    void add(Counter counter, size_t count = 1)
+    {
+        counters_[counter].fetch_add(count, std::memory_order_relaxed);
+    }
+    void fund_finished(const std::string& fund_code, ProgressEvent::Type type);
+    void result(const std::string& fund_code, const std::string& period, double profit, double total_value);
+
+    // 结束运行：发出最后的汇总和 done 事件，把缓冲的输出写完后关闭连接
+    void finish();
+
+private:
+    struct Client;
+    struct Publisher;
+
+    void publish(ProgressEvent event);
+
+    const size_t funds_total_;
+    const Options options_;
+    const std::chrono::steady_clock::time_point started_;
+    std::atomic<size_t> counters_[COUNTER_COUNT] = {};
+    std::atomic<size_t> dropped_{0};
+    ProgressRing ring_;
+    std::unique_ptr<Publisher> publisher_;
+};
+
+#endif  // FUND_RUNPROGRESS_HPP_
@@ -0,0 +1,405 @@
+#include "SeriesCodec.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const uint32_t SERIES_MAGIC = 0x52455346;  // "FSER"
+const uint8_t SERIES_VERSION = 1;
+const int MAX_SCALE_DIGITS = 8;
+// Rice 编码的商超过这个值时改为写 64 位原值
+const int RICE_ESCAPE = 24;
+
+const long SECONDS_PER_DAY = 86400;
+const long BEIJING_OFFSET = 8 * 3600;
+
+// 位流按字节从低位到高位排列
+class BitWriter
+{
+public:
+    // 从 bit_count 位处继续写，out 中最后一个不完整的字节会被接着填满
+    BitWriter(std::string& out, uint64_t bit_count) : out_(out), bits_(bit_count)
+    {
+        out_.resize(sizeof(SeriesHeader) + (bit_count + 7) / 8);
+        pending_ = bit_count % 8;
+        if (pending_ > 0) {
+            accumulator_ = static_cast<uint8_t>(out_.back()) & ((1u << pending_) - 1);
+            out_.pop_back();
+        }
+    }
+
+    void put(uint64_t value, int bits)
+    {
+        if (bits > 32) {
+            put(value & 0xffffffffu, 32);
+            put(value >> 32, bits - 32);
+            return;
+        }
+        if (bits < 64) {
+            value &= (uint64_t(1) << bits) - 1;
+        }
+        accumulator_ |= value << pending_;
+        pending_ += bits;
+        bits_ += bits;
+        while (pending_ >= 8) {
+            out_.push_back(static_cast<char>(accumulator_));
+            accumulator_ >>= 8;
+            pending_ -= 8;
+        }
+    }
+
+    void put_rice(uint64_t value, int k)
+    {
+        uint64_t quotient = value >> k;
+        if (quotient >= RICE_ESCAPE) {
+            put((uint64_t(1) << RICE_ESCAPE) - 1, RICE_ESCAPE);
+            put(value, 64);
+            return;
+        }
+        // quotient 个 1 加一个 0 结束
+        put((uint64_t(1) << quotient) - 1, static_cast<int>(quotient) + 1);
+        put(value, k);
+    }
+
+    uint64_t finish()
+    {
+        if (pending_ > 0) {
+            out_.push_back(static_cast<char>(accumulator_));
+        }
+        return bits_;
+    }
+
+private:
+    std::string& out_;
+    uint64_t bits_;
+    uint64_t accumulator_ = 0;
+    int pending_ = 0;
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t* data, uint64_t bit_count) : data_(data), end_(bit_count) {}
+
+    bool failed() const { return failed_; }
+
+    uint64_t get(int bits)
+    {
+        if (bits > 32) {
+            uint64_t low = get(32);
+            return low | (get(bits - 32) << 32);
+        }
+        uint64_t value = peek() & ((uint64_t(1) << bits) - 1);
+        advance(bits);
+        return value;
+    }
+
+    uint64_t get_rice(int k)
+    {
+        int quotient = __builtin_ctzll(~peek());
+        if (quotient >= RICE_ESCAPE) {
+            advance(RICE_ESCAPE);
+            return get(64);
+        }
+        advance(quotient + 1);
+        return (uint64_t(quotient) << k) | get(k);
+    }
+
+private:
+    // 从当前位置起的至少 56 位，超出位流的部分为 0
+    uint64_t peek() const
+    {
+        uint64_t byte = position_ / 8;
+        uint64_t bytes = (end_ + 7) / 8;
+        uint64_t word = 0;
+        if (byte + 8 <= bytes) {
+            std::memcpy(&word, data_ + byte, 8);
+        } else if (byte < bytes) {
+            std::memcpy(&word, data_ + byte, bytes - byte);
+        }
+        return word >> (position_ % 8);
+    }
+
+    void advance(int bits)
+    {
+        position_ += bits;
+        if (position_ > end_) {
+            failed_ = true;
+            position_ = end_;
+        }
+    }
+
+    const uint8_t* data_;
+    uint64_t end_;
+    uint64_t position_ = 0;
+    bool failed_ = false;
+};
+
+uint64_t zigzag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// 使总长度最短的 Rice 参数
+int best_rice_k(const std::vector<uint64_t>& values)
+{
+    int best_k = 0;
+    uint64_t best_bits = UINT64_MAX;
+    for (int k = 0; k < 32; ++k) {
+        uint64_t bits = 0;
+        for (uint64_t value : values) {
+            uint64_t quotient = value >> k;
+            bits += quotient >= RICE_ESCAPE ? RICE_ESCAPE + 64 : quotient + 1 + k;
+        }
+        if (bits < best_bits) {
+            best_bits = bits;
+            best_k = k;
+        }
+    }
+    return best_k;
+}
+
+long day_start(int64_t day, int32_t time_offset)
+{
+    return static_cast<long>(day) * SECONDS_PER_DAY - BEIJING_OFFSET + time_offset;
+}
+
+bool day_of(long timestamp, int32_t time_offset, int32_t& day)
+{
+    day = day_index(timestamp - time_offset);
+    return day_start(day, time_offset) == timestamp;
+}
+
+bool scale_price(double price, uint32_t digits, int64_t& scaled)
+{
+    double factor = std::pow(10.0, digits);
+    double value = std::round(price * factor);
+    if (!(std::fabs(value) < 9007199254740992.0) || value / factor != price) {
+        return false;
+    }
+    scaled = static_cast<int64_t>(value);
+    return true;
+}
+
+int64_t price_bits(double price)
+{
+    int64_t bits;
+    std::memcpy(&bits, &price, sizeof(bits));
+    return bits;
+}
+
+// 把第 [from, to) 个点按头部中的编码状态写入位流，并更新头部的末尾状态
+bool encode_points(SeriesHeader& header, BitWriter& writer, const FundData& fund_data, size_t from, size_t to)
+{
+    for (size_t i = from; i < to; ++i) {
+        int32_t day;
+        if (!day_of(fund_data.timestamp(i), header.time_offset, day) || day <= header.last_day) {
+            return false;
+        }
+        int32_t delta = day - header.last_day;
+        writer.put_rice(zigzag(static_cast<int64_t>(delta) - header.last_day_delta), header.day_rice_k);
+        header.last_day = day;
+        header.last_day_delta = delta;
+
+        if (header.price_encoding == PriceEncoding::SCALED_DELTA) {
+            int64_t scaled;
+            if (!scale_price(fund_data.price(i), header.scale_digits, scaled)) {
+                return false;
+            }
+            writer.put_rice(zigzag(scaled - header.last_price), header.price_rice_k);
+            header.last_price = scaled;
+        } else {
+            uint64_t x = static_cast<uint64_t>(price_bits(fund_data.price(i)) ^ header.last_price);
+            if (x == 0) {
+                writer.put(0, 1);
+            } else {
+                int leading = std::min(__builtin_clzll(x), 63);
+                int trailing = __builtin_ctzll(x);
+                int significant = 64 - leading - trailing;
+                writer.put(1, 1);
+                writer.put(leading, 6);
+                writer.put(significant - 1, 6);
+                writer.put(x >> trailing, significant);
+            }
+            header.last_price = price_bits(fund_data.price(i));
+        }
+        header.count++;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool read_series_header(const uint8_t* data, size_t size, SeriesHeader& header)
+{
+    if (size < sizeof(SeriesHeader)) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    // 损坏或截断的 BLOB 不能让解码按 count 分配内存或用越界的 Rice 参数移位：
+    // 第一个点之后每个点至少占一位，Rice 参数不超过 63
+    return header.magic == SERIES_MAGIC && header.version == SERIES_VERSION && header.count > 0
+        && header.bit_count <= (size - sizeof(SeriesHeader)) * 8
+        && header.count - 1 <= header.bit_count
+        && header.day_rice_k <= 63 && header.price_rice_k <= 63;
+}
+
+bool encode_series(const FundData& fund_data, std::string& blob)
+{
+    if (fund_data.empty()) {
+        return false;
+    }
+    SeriesHeader header = {};
+    header.magic = SERIES_MAGIC;
+    header.version = SERIES_VERSION;
+    header.first_day = day_index(fund_data.timestamp(0));
+    header.time_offset = static_cast<int32_t>(fund_data.timestamp(0) - day_start(header.first_day, 0));
+
+    // 取能精确表示所有净值的最小缩放位数
+    header.price_encoding = PriceEncoding::XOR;
+    for (uint32_t digits = 0; digits <= MAX_SCALE_DIGITS; ++digits) {
+        int64_t scaled;
+        bool exact = true;
+        for (double price : fund_data.prices()) {
+            if (!scale_price(price, digits, scaled)) {
+                exact = false;
+                break;
+            }
+        }
+        if (exact) {
+            header.price_encoding = PriceEncoding::SCALED_DELTA;
+            header.scale_digits = digits;
+            break;
+        }
+    }
+
+    // 用整个序列选出日期和净值各自的 Rice 参数，追加时沿用
+    std::vector<uint64_t> day_values;
+    std::vector<uint64_t> price_values;
+    int64_t previous_delta = 1;
+    int64_t previous_price = 0;
+    for (size_t i = 0; i < fund_data.size(); ++i) {
+        int32_t day;
+        day_of(fund_data.timestamp(i), header.time_offset, day);
+        if (i > 0) {
+            int32_t previous_day;
+            day_of(fund_data.timestamp(i - 1), header.time_offset, previous_day);
+            day_values.push_back(zigzag(day - previous_day - previous_delta));
+            previous_delta = day - previous_day;
+        }
+        if (header.price_encoding == PriceEncoding::SCALED_DELTA) {
+            int64_t scaled = 0;
+            scale_price(fund_data.price(i), header.scale_digits, scaled);
+            if (i > 0) {
+                price_values.push_back(zigzag(scaled - previous_price));
+            }
+            previous_price = scaled;
+        }
+    }
+    header.day_rice_k = static_cast<uint8_t>(best_rice_k(day_values));
+    header.price_rice_k = static_cast<uint8_t>(best_rice_k(price_values));
+
+    if (header.price_encoding == PriceEncoding::SCALED_DELTA) {
+        scale_price(fund_data.price(0), header.scale_digits, header.first_price);
+    } else {
+        header.first_price = price_bits(fund_data.price(0));
+    }
+    header.count = 1;
+    header.last_day = header.first_day;
+    header.last_day_delta = 1;
+    header.last_price = header.first_price;
+
+    blob.clear();
+    BitWriter writer(blob, 0);
+    if (!encode_points(header, writer, fund_data, 1, fund_data.size())) {
+        return false;
+    }
+    header.bit_count = writer.finish();
+    std::memcpy(blob.data(), &header, sizeof(header));
+    return true;
+}
+
+bool append_series(std::string& blob, const FundData& fund_data)
+{
+    SeriesHeader header;
+    if (!read_series_header(reinterpret_cast<const uint8_t*>(blob.data()), blob.size(), header)
+        || fund_data.size() < header.count) {
+        return false;
+    }
+    size_t last = header.count - 1;
+    int32_t day;
+    if (!day_of(fund_data.timestamp(last), header.time_offset, day) || day != header.last_day) {
+        return false;
+    }
+    int64_t last_price;
+    bool same_price = header.price_encoding == PriceEncoding::SCALED_DELTA
+        ? scale_price(fund_data.price(last), header.scale_digits, last_price) && last_price == header.last_price
+        : price_bits(fund_data.price(last)) == header.last_price;
+    if (!same_price) {
+        return false;
+    }
+    if (fund_data.size() == header.count) {
+        return true;
+    }
+
+    std::string appended = blob;
+    BitWriter writer(appended, header.bit_count);
+    if (!encode_points(header, writer, fund_data, header.count, fund_data.size())) {
+        return false;
+    }
+    header.bit_count = writer.finish();
+    std::memcpy(appended.data(), &header, sizeof(header));
+    blob.swap(appended);
+    return true;
+}
+
+bool decode_series(const uint8_t* data, size_t size, FundData& fund_data)
+{
+    SeriesHeader header;
+    if (!read_series_header(data, size, header)) {
+        return false;
+    }
+    std::vector<long> timestamps(header.count);
+    std::vector<double> prices(header.count);
+    BitReader reader(data + sizeof(SeriesHeader), header.bit_count);
+
+    double factor = std::pow(10.0, header.scale_digits);
+    int64_t day = header.first_day;
+    int64_t delta = 1;
+    int64_t price = header.first_price;
+    for (uint32_t i = 0; i < header.count; ++i) {
+        if (i > 0) {
+            delta += unzigzag(reader.get_rice(header.day_rice_k));
+            day += delta;
+            if (header.price_encoding == PriceEncoding::SCALED_DELTA) {
+                price += unzigzag(reader.get_rice(header.price_rice_k));
+            } else if (reader.get(1)) {
+                int leading = static_cast<int>(reader.get(6));
+                int significant = static_cast<int>(reader.get(6)) + 1;
+                int trailing = 64 - leading - significant;
+                if (trailing < 0) {
+                    return false;
+                }
+                price ^= static_cast<int64_t>(reader.get(significant) << trailing);
+            }
+        }
+        timestamps[i] = day_start(day, header.time_offset);
+        if (header.price_encoding == PriceEncoding::SCALED_DELTA) {
+            prices[i] = static_cast<double>(price) / factor;
+        } else {
+            std::memcpy(&prices[i], &price, sizeof(price));
+        }
+    }
+    if (reader.failed() || day != header.last_day) {
+        return false;
+    }
+    fund_data = FundData(std::move(timestamps), std::move(prices));
+    return true;
+}
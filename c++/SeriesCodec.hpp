@@ -0,0 +1,50 @@
+#ifndef FUND_SERIESCODEC_HPP_
+#define FUND_SERIESCODEC_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "FundData.hpp"
+
+// 净值序列的压缩格式，用于 TB_PRICE 中的 BLOB。
+// 头部之后是位流，每个点依次编码：
+//   日期：与前一个间隔的差（delta-of-delta），zigzag 后用 Rice 编码，工作日连续时为 0
+//   净值：能按 10^k 精确缩放成整数时编码与前一个的整数差（zigzag + Rice），
+//         否则与前一个 double 按位异或，只写有效位（Gorilla）
+// 头部保存末尾点的编码状态，新的交易日可以直接追加到位流末尾。
+enum class PriceEncoding : uint8_t { SCALED_DELTA = 0, XOR = 1 };
+
+struct SeriesHeader
+{
+    uint32_t magic;          // "FSER"
+    uint8_t version;
+    PriceEncoding price_encoding;
+    uint8_t day_rice_k;
+    uint8_t price_rice_k;
+    uint32_t count;
+    uint32_t scale_digits;   // SCALED_DELTA 时净值乘以 10^scale_digits
+    int32_t first_day;
+    int32_t last_day;
+    int32_t last_day_delta;
+    int32_t time_offset;     // 时间戳相对北京时间零点的固定偏移（秒）
+    int64_t first_price;     // 缩放后的整数或 double 的位
+    int64_t last_price;
+    uint64_t bit_count;      // 位流中有效的位数
+};
+
+// 整个序列编码成 BLOB；时间戳相对零点的偏移不一致或序列为空时返回 false
+bool encode_series(const FundData& fund_data, std::string& blob);
+
+// 把 fund_data 中比 blob 多出来的交易日追加到 blob。
+// fund_data 的前 count 个点必须与 blob 中的一致（末尾点的日期和净值相同），
+// 否则返回 false，调用者应重新编码整个序列
+bool append_series(std::string& blob, const FundData& fund_data);
+
+// 从 BLOB 直接解码到 FundData 的列，不经过中间容器
+bool decode_series(const uint8_t* data, size_t size, FundData& fund_data);
+
+// 只读取头部
+bool read_series_header(const uint8_t* data, size_t size, SeriesHeader& header);
+
+#endif  // FUND_SERIESCODEC_HPP_
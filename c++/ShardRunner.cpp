@@ -0,0 +1,169 @@
+#include "ShardRunner.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <cstdio>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Logger.hpp"
+
+ShardPlan plan_shards(const std::vector<std::string>& fund_codes,
+    const std::map<std::string, int>& series_lengths, size_t shard_count)
+{
+    ShardPlan plan(std::max<size_t>(shard_count, 1));
+
+    double known_total = 0;
+    size_t known_count = 0;
+    for (const auto& code : fund_codes) {
+        auto it = series_lengths.find(code);
+        if (it != series_lengths.end() && it->second > 0) {
+            known_total += it->second;
+            ++known_count;
+        }
+    }
+    double default_weight = known_count > 0 ? known_total / known_count : 1.0;
+
+    std::vector<std::pair<double, size_t>> weighted;
+    for (size_t i = 0; i < fund_codes.size(); ++i) {
+        auto it = series_lengths.find(fund_codes[i]);
+        double weight = (it != series_lengths.end() && it->second > 0) ? it->second : default_weight;
+        weighted.emplace_back(weight, i);
+    }
+    // 权重相同时按原顺序：基金列表和序列长度相同的节点算出的计划一致，series_lengths 为空时只取决于基金列表
+    std::stable_sort(weighted.begin(), weighted.end(), [](const auto& a, const auto& b) {
+        return a.first > b.first;
+    });
+
+    std::vector<double> load(plan.size(), 0);
+    std::vector<std::vector<size_t>> members(plan.size());
+    for (const auto& [weight, index] : weighted) {
+        size_t target = std::min_element(load.begin(), load.end()) - load.begin();
+        load[target] += weight;
+        members[target].push_back(index);
+    }
+    for (size_t shard = 0; shard < plan.size(); ++shard) {
+        std::sort(members[shard].begin(), members[shard].end());
+        for (size_t index : members[shard]) {
+            plan[shard].push_back(fund_codes[index]);
+        }
+    }
+    return plan;
+}
+
+bool write_shard_plan(const std::string& path, const ShardPlan& plan, int run_id)
+{
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        LOG_ERROR("无法写入分片计划: %s", path.c_str());
+        return false;
+    }
+    file << "# shards " << plan.size() << "\n";
+    file << "# run " << run_id << "\n";
+    for (size_t shard = 0; shard < plan.size(); ++shard) {
+        for (const auto& code : plan[shard]) {
+            file << shard << " " << code << "\n";
+        }
+    }
+    return true;
+}
+
+ShardPlan read_shard_plan(const std::string& path, int* run_id)
+{
+    ShardPlan plan;
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        LOG_ERROR("无法读取分片计划: %s", path.c_str());
+        return plan;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        if (line[0] == '#') {
+            size_t shard_count = 0;
+            if (std::sscanf(line.c_str(), "# shards %zu", &shard_count) == 1 && shard_count > plan.size()) {
+                plan.resize(shard_count);
+            }
+            if (run_id) {
+                std::sscanf(line.c_str(), "# run %d", run_id);
+            }
+            continue;
+        }
+        size_t space = line.find(' ');
+        if (space == std::string::npos) {
+            continue;
+        }
+        size_t shard = std::stoul(line.substr(0, space));
+        if (shard >= plan.size()) {
+            plan.resize(shard + 1);
+        }
+        plan[shard].push_back(line.substr(space + 1));
+    }
+    return plan;
+}
+
+std::string shard_db_path(const std::string& shard_dir, size_t shard_index)
+{
+    return shard_dir + "/shard_" + std::to_string(shard_index) + ".db";
+}
+
+std::string shard_trace_path(const std::string& trace_path, size_t shard_index)
+{
+    return trace_path + ".shard" + std::to_string(shard_index);
+}
+
+size_t run_shard_workers(const std::string& plan_path, const std::string& shard_dir, size_t shard_count,
+    const std::string& trace_path, const std::string& perf_path, const std::string& alloc_path)
+{
+    std::string executable = std::filesystem::read_symlink("/proc/self/exe").string();
+    std::vector<pid_t> children;
+    for (size_t shard = 0; shard < shard_count; ++shard) {
+        std::string db_path = shard_db_path(shard_dir, shard);
+        std::filesystem::remove(db_path);
+        std::string shard_arg = std::to_string(shard) + "/" + std::to_string(shard_count);
+
+        std::string trace_arg = trace_path.empty() ? "" : shard_trace_path(trace_path, shard);
+        std::vector<const char*> args = {executable.c_str(), "--shard", shard_arg.c_str(),
+            "--plan", plan_path.c_str(), "--db", db_path.c_str()};
+        if (!trace_arg.empty()) {
+            args.push_back("--trace");
+            args.push_back(trace_arg.c_str());
+        }
+        std::string perf_arg = perf_path.empty() ? "" : shard_trace_path(perf_path, shard);
+        if (!perf_arg.empty()) {
+            args.push_back("--perf");
+            args.push_back(perf_arg.c_str());
+        }
+        std::string alloc_arg = alloc_path.empty() ? "" : shard_trace_path(alloc_path, shard);
+        if (!alloc_arg.empty()) {
+            args.push_back("--alloc");
+            args.push_back(alloc_arg.c_str());
+        }
+        args.push_back(nullptr);
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            execv(executable.c_str(), const_cast<char* const*>(args.data()));
+            _exit(127);
+        }
+        if (pid < 0) {
+            LOG_ERROR("无法启动分片 %zu 的工作进程", shard);
+            continue;
+        }
+        LOG_INFO("Started shard %zu/%zu worker (pid %d)", shard, shard_count, static_cast<int>(pid));
+        children.push_back(pid);
+    }
+
+    size_t failures = shard_count - children.size();
+    for (pid_t pid : children) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            LOG_ERROR("Shard worker pid %d failed (status %d)", static_cast<int>(pid), status);
+            ++failures;
+        }
+    }
+    return failures;
+}
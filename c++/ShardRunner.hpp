@@ -0,0 +1,31 @@
+#ifndef FUND_SHARDRUNNER_HPP_
+#define FUND_SHARDRUNNER_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+
+using ShardPlan = std::vector<std::vector<std::string>>;
+
+// 按序列长度加权把基金代码分成 shard_count 份：从最长的序列开始，每次分给当前负载最小的分片。
+// 没有记录长度的基金按已知长度的平均值估计；series_lengths 为空时各基金等权，计划只取决于 fund_codes。
+ShardPlan plan_shards(const std::vector<std::string>& fund_codes,
+    const std::map<std::string, int>& series_lengths, size_t shard_count);
+
+// 分片计划文件：头部记录分片数和 run_id，之后每行 "<分片序号> <基金代码>"，
+// 用于在多台机器上使用同一份计划和同一个 run_id
+bool write_shard_plan(const std::string& path, const ShardPlan& plan, int run_id);
+ShardPlan read_shard_plan(const std::string& path, int* run_id = nullptr);
+
+std::string shard_db_path(const std::string& shard_dir, size_t shard_index);
+
+// 第 i 个工作进程的跟踪文件（以及计数器、分配统计文件），由协调者合并
+std::string shard_trace_path(const std::string& trace_path, size_t shard_index);
+
+// fork/exec 本程序启动 shard_count 个工作进程（--shard i/N --plan ... --db ...）并等待结束，返回失败的进程数。
+// trace_path、perf_path、alloc_path 非空时各工作进程写出自己的跟踪文件 shard_trace_path(trace_path, i)、
+// 计数器文件和分配统计文件
+size_t run_shard_workers(const std::string& plan_path, const std::string& shard_dir, size_t shard_count,
+    const std::string& trace_path = "", const std::string& perf_path = "", const std::string& alloc_path = "");
+
+#endif  // FUND_SHARDRUNNER_HPP_
@@ -0,0 +1,230 @@
+#include "SyntheticSeries.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "Logger.hpp"
+#include "ThreadPool.hpp"
+#include "UniverseSnapshot.hpp"
+
+namespace {
+
+// splitmix64：状态只有一个整数，由 (seed, stream) 直接确定，不依赖标准库分布的实现
+class Random
+{
+public:
+    Random(uint64_t seed, uint64_t stream) : state_(seed * 0x9e3779b97f4a7c15ULL ^ (stream + 1) * 0xd1b54a32d192ed03ULL) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // (0, 1]
+    double uniform() { return static_cast<double>((next() >> 11) + 1) * 0x1.0p-53; }
+
+    // Box-Muller，每次变换得到两个，第二个留给下一次
+    double normal()
+    {
+        if (has_spare_) {
+            has_spare_ = false;
+            return spare_;
+        }
+        double radius = std::sqrt(-2 * std::log(uniform()));
+        double angle = 2 * M_PI * uniform();
+        spare_ = radius * std::sin(angle);
+        has_spare_ = true;
+        return radius * std::cos(angle);
+    }
+
+private:
+    uint64_t state_;
+    double spare_ = 0;
+    bool has_spare_ = false;
+};
+
+}  // namespace
+
+bool parse_synthetic_model(const std::string& name, SyntheticModel& model)
+{
+    if (name == "gbm") {
+        model = SyntheticModel::GBM;
+    } else if (name == "regime") {
+        model = SyntheticModel::REGIME_SWITCHING;
+    } else if (name == "jump") {
+        model = SyntheticModel::JUMP_DIFFUSION;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void generate_series(const SyntheticSpec& spec, uint64_t seed, uint64_t stream, size_t days, long* timestamps, double* prices)
+{
+    // 从最后一天往前取工作日，1970-01-01 是星期四：day % 7 为 2、3 的是周六、周日
+    size_t filled = 0;
+    for (long day = spec.last_day; filled < days; --day) {
+        long weekday = ((day % 7) + 7) % 7;
+        if (weekday != 2 && weekday != 3) {
+            timestamps[days - 1 - filled++] = day * 86400 - 8 * 3600;
+        }
+    }
+
+    const double dt = 1.0 / TRADING_DAYS_PER_YEAR;
+    const double sqrt_dt = std::sqrt(dt);
+    // 每种状态下一个交易日对数价格的均值和标准差
+    const double calm_mean = (spec.drift - spec.volatility * spec.volatility / 2) * dt;
+    const double calm_deviation = spec.volatility * sqrt_dt;
+    const double stress_mean = (spec.stress_drift - spec.stress_volatility * spec.stress_volatility / 2) * dt;
+    const double stress_deviation = spec.stress_volatility * sqrt_dt;
+    // 一个交易日内没有跳跃的概率（泊松分布）
+    const double no_jump = std::exp(-spec.jump_intensity * dt);
+    const double scale = spec.price_digits >= 0 ? std::pow(10.0, spec.price_digits) : 0;
+
+    Random random(seed, stream);
+    bool stressed = false;
+    double log_price = std::log(spec.start_price);
+    for (size_t i = 0; i < days; ++i) {
+        if (i > 0) {
+            double mean = calm_mean, deviation = calm_deviation;
+            if (spec.model == SyntheticModel::REGIME_SWITCHING) {
+                stressed = random.uniform() <= (stressed ? 1 - spec.recovery_probability : spec.stress_probability);
+                if (stressed) {
+                    mean = stress_mean;
+                    deviation = stress_deviation;
+                }
+            }
+            log_price += mean + deviation * random.normal();
+            if (spec.model == SyntheticModel::JUMP_DIFFUSION) {
+                for (double product = random.uniform(); product > no_jump; product *= random.uniform()) {
+                    log_price += spec.jump_mean + spec.jump_volatility * random.normal();
+                }
+            }
+        }
+        double price = std::exp(log_price);
+        prices[i] = scale > 0 ? std::max(std::round(price * scale), 1.0) / scale : price;
+    }
+}
+
+FundData synthetic_fund_data(const SyntheticSpec& spec, uint64_t seed, uint64_t stream, size_t days)
+{
+    std::vector<long> timestamps(days);
+    std::vector<double> prices(days);
+    generate_series(spec, seed, stream, days, timestamps.data(), prices.data());
+    return FundData(std::move(timestamps), std::move(prices));
+}
+
+std::string synthetic_fund_code(size_t index)
+{
+    char code[16];
+    snprintf(code, sizeof(code), "9%06zu", index);
+    return code;
+}
+
+size_t synthetic_fund_days(const SyntheticUniverse& universe, size_t index)
+{
+    size_t low = std::max<size_t>(universe.min_days, 1);
+    size_t high = std::max(universe.max_days, low);
+    // 长度使用单独的流，不影响净值的随机数
+    Random random(universe.seed, ~static_cast<uint64_t>(index));
+    return low + random.next() % (high - low + 1);
+}
+
+bool write_synthetic_snapshot(const std::string& path, const SyntheticSpec& spec, const SyntheticUniverse& universe,
+    ThreadPool& pool)
+{
+    auto started = std::chrono::steady_clock::now();
+    std::vector<SnapshotBuilder::Fund> funds(universe.funds);
+    long now = std::time(nullptr);
+    for (size_t i = 0; i < funds.size(); ++i) {
+        funds[i] = {synthetic_fund_code(i), synthetic_fund_days(universe, i), now};
+    }
+    auto builder = SnapshotBuilder::create(path, funds);
+    if (!builder) {
+        return false;
+    }
+    // 每个任务一个基金，直接写入映射中该基金的位置，线程之间不共享任何写入的内存
+    for (size_t i = 0; i < funds.size(); ++i) {
+        pool.post([&builder, &spec, &universe, &funds, i]() {
+            SnapshotBuilder::Arrays arrays = builder->arrays(i);
+            size_t days = funds[i].size;
+            generate_series(spec, universe.seed, i, days, arrays.timestamps, arrays.prices);
+            FundData::build_index(days, arrays.prices, arrays.price_sum, arrays.price_square_sum,
+                arrays.log_return_square_sum, arrays.block_min, arrays.block_max);
+        });
+    }
+    pool.wait_idle();
+    if (!builder->commit()) {
+        return false;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    LOG_INFO("Generated %zu synthetic funds into %s: %zu bytes in %.2f s", funds.size(), path.c_str(),
+        builder->file_size(), seconds);
+    return true;
+}
+
+std::string pingzhongdata_script(const std::string& fund_code, const FundData& fund_data)
+{
+    std::string script = "var fS_code = \"" + fund_code + "\";var Data_netWorthTrend = [";
+    char value[32];
+    auto format = [&value](double price) {
+        return std::string(value, std::to_chars(value, value + sizeof(value), price).ptr);
+    };
+    for (size_t i = 0; i < fund_data.size(); ++i) {
+        script += "{\"x\":" + std::to_string(fund_data.timestamp(i)) + "000,\"y\":" + format(fund_data.price(i))
+            + ",\"equityReturn\":0,\"unitMoney\":\"\"},";
+    }
+    if (script.back() == ',') {
+        script.pop_back();
+    }
+    script += "];var Data_ACWorthTrend = [";
+    for (size_t i = 0; i < fund_data.size(); ++i) {
+        script += "[" + std::to_string(fund_data.timestamp(i)) + "000," + format(fund_data.price(i)) + "],";
+    }
+    if (script.back() == ',') {
+        script.pop_back();
+    }
+    script += "];";
+    return script;
+}
+
+bool write_synthetic_scripts(const std::string& dir, const SyntheticSpec& spec, const SyntheticUniverse& universe,
+    ThreadPool& pool)
+{
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    if (error) {
+        LOG_ERROR("无法创建目录 %s: %s", dir.c_str(), error.message().c_str());
+        return false;
+    }
+    std::atomic<size_t> failures{0};
+    for (size_t i = 0; i < universe.funds; ++i) {
+        pool.post([&dir, &spec, &universe, &failures, i]() {
+            std::string code = synthetic_fund_code(i);
+            FundData fund_data = synthetic_fund_data(spec, universe.seed, i, synthetic_fund_days(universe, i));
+            std::ofstream file(dir + "/" + code + ".js", std::ios::binary);
+            file << pingzhongdata_script(code, fund_data);
+            if (!file) {
+                failures.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    pool.wait_idle();
+    if (failures > 0) {
+        LOG_ERROR("Failed to write %zu of %zu scripts into %s", failures.load(), universe.funds, dir.c_str());
+        return false;
+    }
+    LOG_INFO("Generated %zu synthetic pingzhongdata scripts into %s", universe.funds, dir.c_str());
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef FUND_SYNTHETICSERIES_HPP_
+#define FUND_SYNTHETICSERIES_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "FundData.hpp"
+
+class ThreadPool;
+
+// 合成净值序列，用于在远超真实规模的数据上测试性能：几何布朗运动、两状态切换和跳跃扩散三种模型。
+// 同一 (seed, stream) 总是生成完全相同的序列，与生成顺序和线程数无关
+
+enum class SyntheticModel { GBM, REGIME_SWITCHING, JUMP_DIFFUSION };
+
+// gbm / regime / jump
+bool parse_synthetic_model(const std::string& name, SyntheticModel& model);
+
+// 没有节假日，工作日即交易日
+const int TRADING_DAYS_PER_YEAR = 261;
+
+struct SyntheticSpec
+{
+    SyntheticModel model = SyntheticModel::GBM;
+    double drift = 0.05;               // 年化漂移
+    double volatility = 0.2;           // 年化波动率
+    // 状态切换：平稳状态使用上面的参数，每个交易日以 stress_probability 进入动荡状态，以 recovery_probability 恢复
+    double stress_drift = -0.4;
+    double stress_volatility = 0.6;
+    double stress_probability = 0.01;
+    double recovery_probability = 0.05;
+    // 跳跃扩散：平均每年 jump_intensity 次跳跃，跳跃幅度的对数服从 N(jump_mean, jump_volatility^2)
+    double jump_intensity = 3;
+    double jump_mean = -0.05;
+    double jump_volatility = 0.08;
+    double start_price = 1;
+    int price_digits = 4;              // 净值保留的小数位数，与真实净值一致；负数表示不舍入
+    int last_day = 20453;              // 最后一个交易日，自 1970-01-01 起的天数（2025-12-31）
+};
+
+// 截止于 spec.last_day 的 days 个交易日，时间戳为北京时间零点，写入调用者提供的数组
+void generate_series(const SyntheticSpec& spec, uint64_t seed, uint64_t stream, size_t days, long* timestamps, double* prices);
+FundData synthetic_fund_data(const SyntheticSpec& spec, uint64_t seed, uint64_t stream, size_t days);
+
+// 第 index 个合成基金的代码："9" 加 6 位序号，按序号排序与按代码排序一致
+std::string synthetic_fund_code(size_t index);
+
+// 合成基金集合：funds 个基金，长度在 [min_days, max_days] 内按基金均匀分布
+struct SyntheticUniverse
+{
+    size_t funds = 1000;
+    size_t min_days = 5 * TRADING_DAYS_PER_YEAR;
+    size_t max_days = 5 * TRADING_DAYS_PER_YEAR;
+    uint64_t seed = 1;
+};
+
+size_t synthetic_fund_days(const SyntheticUniverse& universe, size_t index);
+
+// 直接生成快照文件：预先排好布局，各基金在线程池中并行生成到映射的文件中并计算索引，不经过中间容器
+bool write_synthetic_snapshot(const std::string& path, const SyntheticSpec& spec, const SyntheticUniverse& universe,
+    ThreadPool& pool);
+
+// pingzhongdata 形式的文本，结构与下载的文件相同：单位净值对象数组 Data_netWorthTrend 和累计净值二维数组 Data_ACWorthTrend
+std::string pingzhongdata_script(const std::string& fund_code, const FundData& fund_data);
+
+// 每个基金写一个 <dir>/<代码>.js
+bool write_synthetic_scripts(const std::string& dir, const SyntheticSpec& spec, const SyntheticUniverse& universe,
+    ThreadPool& pool);
+
+#endif  // FUND_SYNTHETICSERIES_HPP_
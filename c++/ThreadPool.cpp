@@ -0,0 +1,150 @@
+#include "ThreadPool.hpp"
+
+#include <exception>
+#include <string>
+
+#include "Logger.hpp"
+#include "Trace.hpp"
+
+namespace {
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+// 任务无论正常返回还是抛出任何异常都要计入完成，否则 wait_idle 会一直等待
+template <typename F>
+struct ScopeExit
+{
+    F f;
+    ~ScopeExit() { f(); }
+};
+template <typename F>
+ScopeExit(F) -> ScopeExit<F>;
+}
+
+ThreadPool::ThreadPool(size_t threads)
+{
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPool::post(std::function<void()> task)
+{
+    ++unfinished_;
+    // 工作线程内提交的任务放入自己的队列，外部提交的轮询分配
+    size_t index = current_pool == this ? current_index : next_worker_++ % workers_.size();
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        ++queued_;
+    }
+    wake_.notify_one();
+}
+
+void ThreadPool::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    idle_.wait(lock, [this]() { return unfinished_ == 0; });
+}
+
+bool ThreadPool::pop_local(size_t index, std::function<void()>& task)
+{
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t index, std::function<void()>& task)
+{
+    // 先用 try_lock 避开正在操作队列的线程；有队列没锁上时再阻塞地扫一遍，
+    // 否则 queued_ > 0 时回到 wake_.wait 会立即返回，空转直到锁被释放
+    bool contended = false;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t i = 1; i < workers_.size(); ++i) {
+            Worker& victim = *workers_[(index + i) % workers_.size()];
+            std::unique_lock<std::mutex> lock(victim.mutex, std::defer_lock);
+            if (pass == 0) {
+                if (!lock.try_lock()) {
+                    contended = true;
+                    continue;
+                }
+            } else {
+                lock.lock();
+            }
+            if (victim.tasks.empty()) {
+                continue;
+            }
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+        if (!contended) {
+            break;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::finish_task()
+{
+    if (--unfinished_ == 0) {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        idle_.notify_all();
+    }
+}
+
+void ThreadPool::run(size_t index)
+{
+    current_pool = this;
+    current_index = index;
+    TRACE_THREAD_NAME("worker " + std::to_string(index));
+    while (true) {
+        std::function<void()> task;
+        if (pop_local(index, task) || steal(index, task)) {
+            --queued_;
+            ScopeExit finished{[this]() { finish_task(); }};
+            try {
+                task();
+            }
+            catch (const std::exception& e) {
+                LOG_ERROR("Thread pool task failed: %s", e.what());
+            }
+            catch (...) {
+                LOG_ERROR("Thread pool task failed: unknown exception");
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0) {
+            return;
+        }
+    }
+}
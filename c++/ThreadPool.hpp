@@ -0,0 +1,67 @@
+#ifndef FUND_THREADPOOL_HPP_
+#define FUND_THREADPOOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// 工作窃取线程池：每个工作线程有自己的双端队列，本线程从队尾取任务，
+// 空闲线程从其他队列的队首窃取。工作线程内提交的任务进入本线程队列。
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void post(std::function<void()> task);
+
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F&& func)
+    {
+        using Result = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+        auto future = task->get_future();
+        post([task]() { (*task)(); });
+        return future;
+    }
+
+    // 阻塞直到所有已提交（包括任务中再提交）的任务执行完毕
+    void wait_idle();
+
+    size_t size() const { return workers_.size(); }
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(size_t index);
+    bool pop_local(size_t index, std::function<void()>& task);
+    bool steal(size_t index, std::function<void()>& task);
+    void finish_task();
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> unfinished_{0};
+    std::atomic<size_t> next_worker_{0};
+    bool stop_ = false;
+};
+
+#endif  // FUND_THREADPOOL_HPP_
@@ -0,0 +1,256 @@
+#include "Trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "Logger.hpp"
+
+namespace {
+
+// 每个线程最多记录的事件数，超出的丢弃并计数
+const size_t MAX_EVENTS_PER_THREAD = size_t(1) << 22;
+
+int64_t steady_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void copy_text(char* target, size_t size, const char* text)
+{
+    if (text) {
+        std::strncpy(target, text, size - 1);
+        target[size - 1] = '\0';
+    } else {
+        target[0] = '\0';
+    }
+}
+
+// 名称都是字符串常量或基金代码，这里只防止引号和控制字符破坏 JSON
+std::string escape(const char* text)
+{
+    std::string escaped;
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            escaped.push_back('\\');
+        }
+        if (static_cast<unsigned char>(*c) >= 0x20) {
+            escaped.push_back(*c);
+        }
+    }
+    return escaped;
+}
+
+}  // namespace
+
+struct Tracer::Event
+{
+    const char* name;
+    const char* category;
+    uint64_t begin;
+    uint64_t end;
+    uint64_t id;
+    char phase;  // X 完整区间，B/E 开始/结束，b/e 异步开始/结束
+    char fund[16];
+    char period[8];
+};
+
+struct Tracer::ThreadBuffer
+{
+    int tid = 0;
+    std::string name;
+    std::vector<Event> events;
+};
+
+std::atomic<bool> Tracer::enabled_{false};
+
+Tracer& Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+uint64_t Tracer::now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(steady_ns());
+#endif
+}
+
+void Tracer::start()
+{
+    start_ns_ = steady_ns();
+    start_ticks_ = now();
+    enabled_.store(true, std::memory_order_relaxed);
+}
+
+Tracer::ThreadBuffer& Tracer::local_buffer()
+{
+    // 缓冲区由 Tracer 持有，线程退出后仍保留到写出
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        auto created = std::make_unique<ThreadBuffer>();
+        created->events.reserve(4096);
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        created->tid = static_cast<int>(buffers_.size()) + 1;
+        buffer = created.get();
+        buffers_.push_back(std::move(created));
+    }
+    return *buffer;
+}
+
+void Tracer::record(const Event& event)
+{
+    if (!enabled()) {
+        return;
+    }
+    ThreadBuffer& buffer = local_buffer();
+    if (buffer.events.size() >= MAX_EVENTS_PER_THREAD) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events.push_back(event);
+}
+
+void Tracer::name_thread(const std::string& name)
+{
+    local_buffer().name = name;
+}
+
+void Tracer::complete(const char* name, const char* category, uint64_t begin, uint64_t end,
+    const char* fund, const char* period)
+{
+    Event event{name, category, begin, end, 0, 'X', {}, {}};
+    copy_text(event.fund, sizeof(event.fund), fund);
+    copy_text(event.period, sizeof(event.period), period);
+    record(event);
+}
+
+void Tracer::begin(const char* name, const char* category, const char* fund)
+{
+    Event event{name, category, now(), 0, 0, 'B', {}, {}};
+    copy_text(event.fund, sizeof(event.fund), fund);
+    record(event);
+}
+
+void Tracer::end()
+{
+    record(Event{"", "", now(), 0, 0, 'E', {}, {}});
+}
+
+uint64_t Tracer::async_begin(const char* name, const char* category, const char* fund)
+{
+    uint64_t id = next_async_id_.fetch_add(1, std::memory_order_relaxed);
+    Event event{name, category, now(), 0, id, 'b', {}, {}};
+    copy_text(event.fund, sizeof(event.fund), fund);
+    record(event);
+    return id;
+}
+
+void Tracer::async_end(const char* name, const char* category, uint64_t id, const char* fund)
+{
+    Event event{name, category, now(), 0, id, 'e', {}, {}};
+    copy_text(event.fund, sizeof(event.fund), fund);
+    record(event);
+}
+
+bool Tracer::write(const std::string& path, const std::vector<std::string>& merge_files)
+{
+    enabled_.store(false, std::memory_order_relaxed);
+    const uint64_t end_ticks = now();
+    const int64_t end_ns = steady_ns();
+    // TSC 周期换算成 steady_clock 的纳秒；各进程使用同一个单调时钟，合并后时间一致
+    const double ns_per_tick = end_ticks > start_ticks_
+        ? static_cast<double>(end_ns - start_ns_) / static_cast<double>(end_ticks - start_ticks_) : 1.0;
+    auto microseconds = [&](uint64_t ticks) {
+        double elapsed = static_cast<double>(static_cast<int64_t>(ticks - start_ticks_)) * ns_per_tick;
+        return (static_cast<double>(start_ns_) + elapsed) / 1000;
+    };
+
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        LOG_ERROR("无法创建跟踪文件: %s", path.c_str());
+        return false;
+    }
+    const int pid = static_cast<int>(::getpid());
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"fund %d\"}}", pid, pid);
+    size_t count = 0;
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (const auto& buffer : buffers_) {
+        const int tid = buffer->tid;
+        std::string thread_name = buffer->name.empty() ? "thread " + std::to_string(tid) : buffer->name;
+        std::fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            pid, tid, escape(thread_name.c_str()).c_str());
+        std::fprintf(file, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+            pid, tid, tid);
+        for (const Event& event : buffer->events) {
+            std::string args;
+            if (event.fund[0]) {
+                args = "\"fund\":\"" + escape(event.fund) + "\"";
+            }
+            if (event.period[0]) {
+                args += std::string(args.empty() ? "" : ",") + "\"period\":\"" + escape(event.period) + "\"";
+            }
+            switch (event.phase) {
+                case 'X':
+                    std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{%s}}",
+                        event.name, event.category, microseconds(event.begin),
+                        microseconds(event.end) - microseconds(event.begin), pid, tid, args.c_str());
+                    break;
+                case 'B':
+                    std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{%s}}",
+                        event.name, event.category, microseconds(event.begin), pid, tid, args.c_str());
+                    break;
+                case 'E':
+                    std::fprintf(file, ",\n{\"ph\":\"E\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d}", microseconds(event.begin), pid, tid);
+                    break;
+                default:
+                    std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{%s}}",
+                        event.name, event.category, event.phase, static_cast<unsigned long long>(event.id),
+                        microseconds(event.begin), pid, tid, args.c_str());
+                    break;
+            }
+            ++count;
+        }
+    }
+    for (const auto& merge_file : merge_files) {
+        std::ifstream in(merge_file);
+        if (!in) {
+            continue;
+        }
+        try {
+            nlohmann::json trace = nlohmann::json::parse(in);
+            for (const auto& event : trace["traceEvents"]) {
+                std::fprintf(file, ",\n%s", event.dump().c_str());
+                ++count;
+            }
+        } catch (const nlohmann::json::exception& e) {
+            LOG_WARN("跟踪文件 %s 无法解析: %s", merge_file.c_str(), e.what());
+            continue;
+        }
+        in.close();
+        std::remove(merge_file.c_str());
+    }
+    std::fprintf(file, "\n]}\n");
+    bool ok = std::fclose(file) == 0;
+    if (!ok) {
+        LOG_ERROR("写入跟踪文件失败: %s", path.c_str());
+        return false;
+    }
+    if (dropped_ > 0) {
+        LOG_WARN("%zu trace events were dropped, the per-thread buffers were full", dropped_.load());
+    }
+    LOG_INFO("Wrote %zu trace events to %s", count, path.c_str());
+    return true;
+}
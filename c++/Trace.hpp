@@ -0,0 +1,104 @@
+#ifndef FUND_TRACE_HPP_
+#define FUND_TRACE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 运行过程的时间线：各线程把跟踪事件记入自己的缓冲区（只有本线程写入，不加锁），
+// 运行结束后统一写成 Chrome / Perfetto 的 trace event JSON（chrome://tracing 或 ui.perfetto.dev 打开）。
+// 时间取自 TSC，写出时按开始和结束时刻与 steady_clock 的对照换算成微秒，多个进程的文件可以合并到同一时间轴。
+// 没有开始跟踪时每个跟踪点只有一次 relaxed 读；编译时定义 FUND_NO_TRACE 则跟踪点全部去掉
+class Tracer
+{
+public:
+    static Tracer& instance();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+    // 当前时刻，单位为 TSC 周期（非 x86 为纳秒）
+    static uint64_t now();
+
+    void start();
+
+    // 事件中的 fund、period 会被复制，超出长度的部分截断；name、category 必须是字符串常量
+    void name_thread(const std::string& name);
+    void complete(const char* name, const char* category, uint64_t begin, uint64_t end,
+        const char* fund = nullptr, const char* period = nullptr);
+    void begin(const char* name, const char* category, const char* fund = nullptr);
+    void end();
+    // 跨越挂起点或线程的区间（下载、整个基金），在时间线上单独成行；返回的 id 交给 async_end
+    uint64_t async_begin(const char* name, const char* category, const char* fund);
+    void async_end(const char* name, const char* category, uint64_t id, const char* fund);
+
+    // 停止跟踪并写出全部事件，同时并入 merge_files 中其他进程写出的跟踪文件（分片工作进程）并删除它们。
+    // 调用时其他线程不能再记录事件
+    bool write(const std::string& path, const std::vector<std::string>& merge_files = {});
+
+private:
+    struct Event;
+    struct ThreadBuffer;
+
+    Tracer() = default;
+    ThreadBuffer& local_buffer();
+    void record(const Event& event);
+
+    static std::atomic<bool> enabled_;
+
+    std::mutex buffers_mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::atomic<uint64_t> next_async_id_{1};
+    std::atomic<size_t> dropped_{0};
+    uint64_t start_ticks_ = 0;
+    int64_t start_ns_ = 0;
+};
+
+// 作用域内的一段区间，析构时记录
+class TraceScope
+{
+public:
+    TraceScope(const char* name, const char* category, const char* fund = nullptr, const char* period = nullptr)
+        : name_(name), category_(category), fund_(fund), period_(period), begin_(Tracer::enabled() ? Tracer::now() : 0)
+    {
+    }
+    ~TraceScope()
+    {
+        if (begin_ != 0) {
+            Tracer::instance().complete(name_, category_, begin_, Tracer::now(), fund_, period_);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    const char* category_;
+    const char* fund_;
+    const char* period_;
+    uint64_t begin_;
+};
+
+#ifdef FUND_NO_TRACE
+#define TRACE_SCOPE(...) do {} while (0)
+#define TRACE_BEGIN(name, category) do {} while (0)
+#define TRACE_END() do {} while (0)
+#define TRACE_ASYNC_BEGIN(name, category, fund) uint64_t(0)
+#define TRACE_ASYNC_END(name, category, id, fund) do { (void)(id); } while (0)
+#define TRACE_THREAD_NAME(name) do {} while (0)
+#else
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(__VA_ARGS__)
+#define TRACE_BEGIN(name, category) do { if (Tracer::enabled()) Tracer::instance().begin(name, category); } while (0)
+#define TRACE_END() do { if (Tracer::enabled()) Tracer::instance().end(); } while (0)
+#define TRACE_ASYNC_BEGIN(name, category, fund) \
+    (Tracer::enabled() ? Tracer::instance().async_begin(name, category, fund) : uint64_t(0))
+#define TRACE_ASYNC_END(name, category, id, fund) \
+    do { if ((id) != 0) Tracer::instance().async_end(name, category, id, fund); } while (0)
+#define TRACE_THREAD_NAME(name) do { if (Tracer::enabled()) Tracer::instance().name_thread(name); } while (0)
+#endif
+
+#endif  // FUND_TRACE_HPP_
@@ -0,0 +1,276 @@
+#include "UniverseSnapshot.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Logger.hpp"
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'F', 'U', 'N', 'D', 'S', 'N', 'A', 'P'};
+const size_t ARRAY_ALIGNMENT = 64;
+const size_t ARRAY_COUNT = 7;
+
+static_assert(sizeof(long) == sizeof(int64_t), "timestamps are stored as 64-bit integers");
+
+size_t align(size_t offset)
+{
+    return (offset + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT;
+}
+
+// 一个基金各数组的长度，顺序与 FundData::Arrays 相同
+void array_lengths(size_t points, size_t (&lengths)[ARRAY_COUNT])
+{
+    const size_t table = FundData::block_table_size(points);
+    const size_t values[ARRAY_COUNT] = {points, points, points + 1, points + 1, points, table, table};
+    std::copy(values, values + ARRAY_COUNT, lengths);
+}
+
+// 从 offset 开始依次对齐存放各数组时每个数组的位置；返回数据结尾
+size_t layout(size_t offset, size_t points, size_t (&positions)[ARRAY_COUNT])
+{
+    size_t lengths[ARRAY_COUNT];
+    array_lengths(points, lengths);
+    for (size_t i = 0; i < ARRAY_COUNT; ++i) {
+        offset = align(offset);
+        positions[i] = offset;
+        offset += lengths[i] * sizeof(double);
+    }
+    return offset;
+}
+
+}  // namespace
+
+bool write_snapshot(const std::string& path, const std::vector<SnapshotSeries>& series)
+{
+    std::vector<SnapshotSeries> sorted;
+    for (const auto& item : series) {
+        if (!item.data || item.data->empty()) {
+            continue;
+        }
+        if (item.fund_code.size() >= sizeof(SnapshotEntry::fund_code)) {
+            LOG_WARN("基金代码过长，不写入快照: %s", item.fund_code.c_str());
+            continue;
+        }
+        sorted.push_back(item);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.fund_code < b.fund_code; });
+    sorted.erase(std::unique(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.fund_code == b.fund_code;
+    }), sorted.end());
+
+    std::vector<SnapshotBuilder::Fund> funds;
+    funds.reserve(sorted.size());
+    for (const auto& item : sorted) {
+        funds.push_back({item.fund_code, item.data->size(), item.updated_at});
+    }
+    auto builder = SnapshotBuilder::create(path, funds);
+    if (!builder) {
+        return false;
+    }
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const FundData& fund_data = *sorted[i].data;
+        const FundData::Arrays source = fund_data.arrays();
+        const SnapshotBuilder::Arrays target = builder->arrays(i);
+        const void* sources[ARRAY_COUNT] = {source.timestamps, source.prices, source.price_sum,
+            source.price_square_sum, source.log_return_square_sum, source.block_min, source.block_max};
+        void* targets[ARRAY_COUNT] = {target.timestamps, target.prices, target.price_sum,
+            target.price_square_sum, target.log_return_square_sum, target.block_min, target.block_max};
+        size_t lengths[ARRAY_COUNT];
+        array_lengths(fund_data.size(), lengths);
+        for (size_t a = 0; a < ARRAY_COUNT; ++a) {
+            std::memcpy(targets[a], sources[a], lengths[a] * sizeof(double));
+        }
+    }
+    if (!builder->commit()) {
+        return false;
+    }
+    LOG_INFO("快照 %s 写入 %zu 个基金，%zu 字节", path.c_str(), sorted.size(), builder->file_size());
+    return true;
+}
+
+std::unique_ptr<SnapshotBuilder> SnapshotBuilder::create(const std::string& path, const std::vector<Fund>& funds)
+{
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.fund_count = static_cast<uint32_t>(funds.size());
+    header.created_at = std::time(nullptr);
+
+    std::vector<SnapshotEntry> entries(funds.size());
+    size_t offset = sizeof(SnapshotHeader) + sizeof(SnapshotEntry) * funds.size();
+    for (size_t i = 0; i < funds.size(); ++i) {
+        size_t positions[ARRAY_COUNT];
+        std::strncpy(entries[i].fund_code, funds[i].fund_code.c_str(), sizeof(entries[i].fund_code) - 1);
+        entries[i].offset = align(offset);
+        entries[i].size = funds[i].size;
+        entries[i].updated_at = funds[i].updated_at;
+        header.last_update = std::max<int64_t>(header.last_update, funds[i].updated_at);
+        offset = layout(offset, funds[i].size, positions);
+    }
+    header.file_size = offset;
+
+    std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("无法创建快照文件: %s", temporary.c_str());
+        return nullptr;
+    }
+    // 文件按最终大小一次分配，数组之间的对齐填充保持为 0
+    void* mapped = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(offset)) == 0) {
+        mapped = ::mmap(nullptr, offset, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        LOG_ERROR("无法分配或映射快照文件: %s (%zu 字节)", temporary.c_str(), offset);
+        std::remove(temporary.c_str());
+        return nullptr;
+    }
+    uint8_t* data = static_cast<uint8_t*>(mapped);
+    std::memcpy(data, &header, sizeof(header));
+    std::memcpy(data + sizeof(header), entries.data(), sizeof(SnapshotEntry) * entries.size());
+    return std::unique_ptr<SnapshotBuilder>(new SnapshotBuilder(path, data, offset, funds.size()));
+}
+
+SnapshotBuilder::SnapshotBuilder(std::string path, uint8_t* data, size_t size, size_t count)
+    : path_(std::move(path)), data_(data), size_(size), count_(count)
+{
+}
+
+SnapshotBuilder::~SnapshotBuilder()
+{
+    ::munmap(data_, size_);
+    if (!committed_) {
+        std::remove((path_ + ".tmp").c_str());
+    }
+}
+
+SnapshotBuilder::Arrays SnapshotBuilder::arrays(size_t index)
+{
+    const SnapshotEntry& entry = reinterpret_cast<const SnapshotEntry*>(data_ + sizeof(SnapshotHeader))[index];
+    size_t positions[ARRAY_COUNT];
+    layout(entry.offset, entry.size, positions);
+    Arrays arrays;
+    arrays.timestamps = reinterpret_cast<long*>(data_ + positions[0]);
+    arrays.prices = reinterpret_cast<double*>(data_ + positions[1]);
+    arrays.price_sum = reinterpret_cast<double*>(data_ + positions[2]);
+    arrays.price_square_sum = reinterpret_cast<double*>(data_ + positions[3]);
+    arrays.log_return_square_sum = reinterpret_cast<double*>(data_ + positions[4]);
+    arrays.block_min = reinterpret_cast<double*>(data_ + positions[5]);
+    arrays.block_max = reinterpret_cast<double*>(data_ + positions[6]);
+    return arrays;
+}
+
+bool SnapshotBuilder::commit()
+{
+    std::string temporary = path_ + ".tmp";
+    if (::msync(data_, size_, MS_SYNC) != 0 || std::rename(temporary.c_str(), path_.c_str()) != 0) {
+        LOG_ERROR("写入快照文件失败: %s", path_.c_str());
+        return false;
+    }
+    committed_ = true;
+    return true;
+}
+
+std::shared_ptr<UniverseSnapshot> UniverseSnapshot::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+        LOG_WARN("快照文件为空或无法读取: %s", path.c_str());
+        ::close(fd);
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    // MAP_SHARED 只读映射：各进程直接使用同一份页缓存
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        LOG_ERROR("无法映射快照文件: %s", path.c_str());
+        return nullptr;
+    }
+    std::shared_ptr<UniverseSnapshot> snapshot(new UniverseSnapshot(static_cast<const uint8_t*>(mapped), size));
+    if (!snapshot->validate()) {
+        LOG_WARN("快照文件不完整或不是当前版本: %s", path.c_str());
+        return nullptr;
+    }
+    return snapshot;
+}
+
+UniverseSnapshot::UniverseSnapshot(const uint8_t* data, size_t size)
+    : data_(data), size_(size)
+{
+}
+
+UniverseSnapshot::~UniverseSnapshot()
+{
+    ::munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+bool UniverseSnapshot::validate() const
+{
+    const SnapshotHeader* file_header = header();
+    if (std::memcmp(file_header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+        || file_header->version != SNAPSHOT_VERSION || file_header->file_size != size_
+        || sizeof(SnapshotHeader) + sizeof(SnapshotEntry) * static_cast<size_t>(file_header->fund_count) > size_) {
+        return false;
+    }
+    for (size_t i = 0; i < file_header->fund_count; ++i) {
+        const SnapshotEntry& entry = entries()[i];
+        size_t positions[ARRAY_COUNT];
+        if (entry.fund_code[sizeof(entry.fund_code) - 1] != '\0' || entry.offset % ARRAY_ALIGNMENT != 0
+            || entry.size > size_ || layout(entry.offset, entry.size, positions) > size_) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const FundData> UniverseSnapshot::view(const SnapshotEntry& entry) const
+{
+    size_t positions[ARRAY_COUNT];
+    layout(entry.offset, entry.size, positions);
+    FundData::Arrays arrays;
+    arrays.timestamps = reinterpret_cast<const long*>(data_ + positions[0]);
+    arrays.prices = reinterpret_cast<const double*>(data_ + positions[1]);
+    arrays.price_sum = reinterpret_cast<const double*>(data_ + positions[2]);
+    arrays.price_square_sum = reinterpret_cast<const double*>(data_ + positions[3]);
+    arrays.log_return_square_sum = reinterpret_cast<const double*>(data_ + positions[4]);
+    arrays.block_min = reinterpret_cast<const double*>(data_ + positions[5]);
+    arrays.block_max = reinterpret_cast<const double*>(data_ + positions[6]);
+    return std::make_shared<const FundData>(FundData::view(entry.size, arrays, shared_from_this()));
+}
+
+std::shared_ptr<const FundData> UniverseSnapshot::find(const std::string& fund_code) const
+{
+    const SnapshotEntry* first = entries();
+    const SnapshotEntry* last = first + size();
+    const SnapshotEntry* entry = std::lower_bound(first, last, fund_code, [](const SnapshotEntry& e, const std::string& code) {
+        return std::strcmp(e.fund_code, code.c_str()) < 0;
+    });
+    if (entry == last || fund_code != entry->fund_code) {
+        return nullptr;
+    }
+    return view(*entry);
+}
+
+std::vector<SnapshotSeries> UniverseSnapshot::funds() const
+{
+    std::vector<SnapshotSeries> series(size());
+    for (size_t i = 0; i < size(); ++i) {
+        series[i].fund_code = entries()[i].fund_code;
+        series[i].updated_at = static_cast<long>(entries()[i].updated_at);
+        series[i].data = view(entries()[i]);
+    }
+    return series;
+}
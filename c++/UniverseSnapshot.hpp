@@ -0,0 +1,128 @@
+#ifndef FUND_UNIVERSESNAPSHOT_HPP_
+#define FUND_UNIVERSESNAPSHOT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FundData.hpp"
+
+// 所有基金净值序列的二进制快照，数组布局与 FundData 相同，映射后直接作为 FundData 使用，
+// 不解析也不重新计算前缀和与稀疏表。
+// 文件头之后是按基金代码排序的索引，然后是各基金的数组，每个数组按 64 字节对齐。
+// 同一台机器上的多个进程（包括分片工作进程）映射同一个文件，共享页缓存。
+// 写入时先写临时文件再改名，已经映射旧快照的进程不受影响
+
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader
+{
+    char magic[8];        // "FUNDSNAP"
+    uint32_t version;
+    uint32_t fund_count;
+    int64_t created_at;   // 写入时间（秒）
+    int64_t last_update;  // 各序列 updated_at 的最大值，与 TB_PRICE 比较判断快照是否需要重建
+    uint64_t file_size;   // 用于发现被截断的文件
+};
+
+struct SnapshotEntry
+{
+    char fund_code[16];   // 以 '\0' 结尾
+    uint64_t offset;      // 第一个数组在文件中的位置
+    uint64_t size;        // 净值点数
+    int64_t updated_at;   // 序列在 TB_PRICE 中的更新时间（秒）
+};
+
+struct SnapshotSeries
+{
+    std::string fund_code;
+    long updated_at = 0;
+    std::shared_ptr<const FundData> data;
+};
+
+// 把序列写成快照文件，空序列和基金代码超过 15 个字符的序列被跳过
+bool write_snapshot(const std::string& path, const std::vector<SnapshotSeries>& series);
+
+// 按给定的基金和长度排好布局，映射可写的临时文件，各基金的数组由调用者直接写入（可以多个线程各写各的基金），
+// commit 后改名为目标文件。序列不必先在内存中构造成 FundData，写入大快照时不占用额外内存
+class SnapshotBuilder
+{
+public:
+    struct Fund
+    {
+        std::string fund_code;  // 不超过 15 个字符
+        size_t size = 0;        // 净值点数，大于 0
+        long updated_at = 0;
+    };
+
+    // 各数组在映射中的位置，长度见 FundData::Arrays
+    struct Arrays
+    {
+        long* timestamps;
+        double* prices;
+        double* price_sum;
+        double* price_square_sum;
+        double* log_return_square_sum;
+        double* block_min;
+        double* block_max;
+    };
+
+    // funds 必须按基金代码升序且不重复；创建或映射文件失败时返回 nullptr
+    static std::unique_ptr<SnapshotBuilder> create(const std::string& path, const std::vector<Fund>& funds);
+    // 未提交时删除临时文件
+    ~SnapshotBuilder();
+
+    SnapshotBuilder(const SnapshotBuilder&) = delete;
+    SnapshotBuilder& operator=(const SnapshotBuilder&) = delete;
+
+    size_t size() const { return count_; }
+    size_t file_size() const { return size_; }
+    Arrays arrays(size_t index);
+
+    // 写回磁盘并改名为目标文件，所有数组都写完后调用一次
+    bool commit();
+
+private:
+    SnapshotBuilder(std::string path, uint8_t* data, size_t size, size_t count);
+
+    std::string path_;
+    uint8_t* data_;
+    size_t size_;
+    size_t count_;
+    bool committed_ = false;
+};
+
+// 只读映射的快照。视图持有快照的 shared_ptr，最后一个视图释放后才解除映射
+class UniverseSnapshot : public std::enable_shared_from_this<UniverseSnapshot>
+{
+public:
+    // 文件不存在、版本不符或不完整时返回 nullptr
+    static std::shared_ptr<UniverseSnapshot> open(const std::string& path);
+    ~UniverseSnapshot();
+
+    UniverseSnapshot(const UniverseSnapshot&) = delete;
+    UniverseSnapshot& operator=(const UniverseSnapshot&) = delete;
+
+    size_t size() const { return header()->fund_count; }
+    long created_at() const { return static_cast<long>(header()->created_at); }
+    long last_update() const { return static_cast<long>(header()->last_update); }
+
+    // 找不到时返回 nullptr
+    std::shared_ptr<const FundData> find(const std::string& fund_code) const;
+    std::vector<SnapshotSeries> funds() const;
+
+private:
+    UniverseSnapshot(const uint8_t* data, size_t size);
+
+    const SnapshotHeader* header() const { return reinterpret_cast<const SnapshotHeader*>(data_); }
+    const SnapshotEntry* entries() const { return reinterpret_cast<const SnapshotEntry*>(data_ + sizeof(SnapshotHeader)); }
+    bool validate() const;
+    std::shared_ptr<const FundData> view(const SnapshotEntry& entry) const;
+
+    const uint8_t* data_;
+    size_t size_;
+};
+
+#endif  // FUND_UNIVERSESNAPSHOT_HPP_
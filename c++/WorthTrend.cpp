@@ -0,0 +1,39 @@
+#include "WorthTrend.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include "AllocTracker.hpp"
+#include "Logger.hpp"
+#include "PerfCounters.hpp"
+
+using json = nlohmann::json;
+
+std::map<long, double> parse_worth_trend(const std::string& js_text, const std::string& variable, const std::string& fund_code) {
+    std::map<long, double> net_worth_dict;
+    AllocScope alloc_scope(AllocStage::PARSE, fund_code.c_str());
+    PerfScope perf(PerfStage::PARSE, fund_code.c_str());
+    size_t start = js_text.find("var " + variable + " = ");
+    if (start == std::string::npos) {
+        LOG_ERROR("未找到 %s 变量 for fund code: %s", variable.c_str(), fund_code.c_str());
+        return net_worth_dict;
+    }
+    start = js_text.find('[', start);
+    size_t end = js_text.find("];", start);
+    if (start == std::string::npos || end == std::string::npos) {
+        LOG_ERROR("未找到完整的 JSON 数组 for fund code: %s", fund_code.c_str());
+        return net_worth_dict;
+    }
+    try {
+        json j = json::parse(js_text.begin() + start, js_text.begin() + end + 1);
+        for (const auto& item : j) {
+            bool is_array = item.is_array();
+            long timestamp = long(is_array ? item[0] : item["x"]) / 1000;
+            double net_value = is_array ? item[1] : item["y"];
+            net_worth_dict[timestamp] = net_value;
+        }
+    } catch (const json::exception& e) {
+        LOG_ERROR("JSON解析错误: %s for fund code: %s", e.what(), fund_code.c_str());
+    }
+    perf.set_days(net_worth_dict.size());
+    return net_worth_dict;
+}
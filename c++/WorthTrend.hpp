@@ -0,0 +1,11 @@
+#ifndef FUND_WORTHTREND_HPP_
+#define FUND_WORTHTREND_HPP_
+
+#include <map>
+#include <string>
+
+// 解析 pingzhongdata 中的净值数组 variable，元素可以是 {"x":..,"y":..} 或 [x, y]，x 为毫秒时间戳。
+// 找不到变量或解析失败时记录错误并返回已解析的部分；fund_code 只用于日志
+std::map<long, double> parse_worth_trend(const std::string& js_text, const std::string& variable, const std::string& fund_code);
+
+#endif  // FUND_WORTHTREND_HPP_
@@ -0,0 +1,655 @@
+// 基准测试：在固定的合成数据上分别测量各阶段（解析、建索引、分位阈值、网格模拟、区间统计、报告、编解码、写库）
+// 和整个批量运行，输出每个交易日的耗时、每秒基金数、每次执行的分配次数和峰值内存。
+// 数据由 SyntheticSeries 以固定种子生成，每次运行完全相同；--json 写出的结果用 --compare 在提交之间对比
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AllocTracker.hpp"
+#include "FundData.hpp"
+#include "GridEngine.hpp"
+#include "Logger.hpp"
+#include "ReportWriter.hpp"
+#include "SeriesCodec.hpp"
+#include "SyntheticSeries.hpp"
+#include "ThreadPool.hpp"
+#include "WorthTrend.hpp"
+#include "CppSQLite/DataBaseStorage.hpp"
+
+using json = nlohmann::json;
+using std::string;
+using std::vector;
+
+namespace {
+
+// 防止被测的计算被优化掉
+volatile double SINK = 0;
+
+// 与 config.txt 默认值相同的网格参数
+const ResultParameters PARAMETERS = {0.05, 0.3, 3, 40500, 2000, 0.1, 0.5};
+const char* const PERIODS[] = {"0", "1", "2", "3", "4", "5", "6"};
+
+struct Fixture
+{
+    string name;
+    vector<string> codes;
+    vector<std::map<long, double>> maps;
+    vector<FundData> series;
+    vector<string> scripts;  // 只为单基金的数据生成
+
+    size_t days() const
+    {
+        size_t total = 0;
+        for (const auto& fund_data : series) {
+            total += fund_data.size();
+        }
+        return total;
+    }
+};
+
+// 默认参数的几何布朗运动，净值保留四位小数
+Fixture single_fund_fixture(const string& name, size_t days)
+{
+    Fixture fixture;
+    fixture.name = name;
+    fixture.codes.push_back(synthetic_fund_code(0));
+    fixture.series.push_back(synthetic_fund_data(SyntheticSpec(), 1, days, days));
+    const FundData& fund_data = fixture.series.back();
+    std::map<long, double> net_worth;
+    for (size_t i = 0; i < fund_data.size(); ++i) {
+        net_worth.emplace(fund_data.timestamp(i), fund_data.price(i));
+    }
+    fixture.maps.push_back(std::move(net_worth));
+    fixture.scripts.push_back(pingzhongdata_script(fixture.codes.back(), fund_data));
+    return fixture;
+}
+
+// 长度在 1 到 20 年之间的基金
+Fixture universe_fixture(size_t funds)
+{
+    Fixture fixture;
+    fixture.name = "universe";
+    SyntheticUniverse universe;
+    universe.funds = funds;
+    universe.min_days = TRADING_DAYS_PER_YEAR;
+    universe.max_days = 20 * TRADING_DAYS_PER_YEAR;
+    universe.seed = 20251231;
+    for (size_t i = 0; i < funds; ++i) {
+        fixture.codes.push_back(synthetic_fund_code(i));
+        fixture.series.push_back(synthetic_fund_data(SyntheticSpec(), universe.seed, i, synthetic_fund_days(universe, i)));
+    }
+    return fixture;
+}
+
+// 一次执行计算全部周期，返回模拟的交易日数
+size_t run_all_periods(const string& fund_code, const FundData& fund_data)
+{
+    size_t days = 0;
+    for (const char* period : PERIODS) {
+        size_t start = get_start_date(fund_data, period);
+        size_t end = get_end_date(fund_data, period);
+        if (start < end) {
+            GridOutcome outcome = run_grid(fund_code, fund_data, start, end, PARAMETERS);
+            SINK = SINK + outcome.total_profit;
+            days += end - start;
+        }
+    }
+    return days;
+}
+
+struct Case
+{
+    string name;
+    size_t days = 0;    // 每次执行处理的交易日数
+    size_t funds = 0;   // 每次执行处理的基金数
+    std::function<void()> run;
+    bool single_shot = false;             // 每个样本只执行一次（外部进程）
+    std::function<long()> peak_rss_kb;    // 非空时峰值内存取自它（子进程），分配次数不可得
+
+    Case(string name, size_t days, size_t funds, std::function<void()> run)
+        : name(std::move(name)), days(days), funds(funds), run(std::move(run))
+    {
+    }
+};
+
+struct Options
+{
+    string filter;
+    size_t samples = 5;
+    long min_time_ms = 1000;
+    string json_path;
+    string fund_binary;
+    string alloc_path;
+    bool list = false;
+};
+
+struct Measurement
+{
+    string name;
+    size_t iterations = 0;  // 每个样本的执行次数
+    double ns_per_op = 0;   // 各样本的中位数
+    double ns_per_op_min = 0;
+    double spread = 0;      // 样本与中位数的绝对偏差的中位数，相对中位数
+    size_t days = 0;
+    size_t funds = 0;
+    double allocations_per_op = -1;
+    double bytes_per_op = -1;
+    long peak_rss_kb = 0;
+    long peak_live_kb = -1;  // 跟踪分配时，执行期间比开始时多出的存活字节的峰值
+};
+
+double now_ns()
+{
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// 把本进程的峰值内存重置为当前值（Linux 的 clear_refs），不支持时峰值从进程启动算起
+void reset_peak_rss()
+{
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (fd >= 0) {
+        ssize_t written = write(fd, "5", 1);
+        (void)written;
+        close(fd);
+    }
+}
+
+long peak_rss_kb()
+{
+    std::ifstream status("/proc/self/status");
+    string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return std::atol(line.c_str() + 6);
+        }
+    }
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+double median(vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+Measurement measure(const Case& bench, const Options& options)
+{
+    // 预热一次，同时估计每个样本需要执行多少次才能达到 min_time_ms / samples
+    double started = now_ns();
+    bench.run();
+    double once = std::max(now_ns() - started, 1.0);
+    size_t iterations = 1;
+    if (!bench.single_shot) {
+        double target = static_cast<double>(options.min_time_ms) * 1e6 / static_cast<double>(options.samples);
+        iterations = static_cast<size_t>(std::clamp(target / once, 1.0, 1e9));
+    }
+
+    reset_peak_rss();
+    uint64_t allocations = AllocTracker::allocations();
+    uint64_t bytes = AllocTracker::allocated_bytes();
+    int64_t live = AllocTracker::live_bytes();
+    AllocTracker::reset_peak();
+    vector<double> samples;
+    for (size_t sample = 0; sample < options.samples; ++sample) {
+        started = now_ns();
+        for (size_t i = 0; i < iterations; ++i) {
+            bench.run();
+        }
+        samples.push_back((now_ns() - started) / static_cast<double>(iterations));
+    }
+
+    Measurement result;
+    result.name = bench.name;
+    result.iterations = iterations;
+    result.days = bench.days;
+    result.funds = bench.funds;
+    result.ns_per_op = median(samples);
+    result.ns_per_op_min = *std::min_element(samples.begin(), samples.end());
+    vector<double> deviations;
+    for (double sample : samples) {
+        deviations.push_back(std::abs(sample - result.ns_per_op));
+    }
+    result.spread = median(deviations) / result.ns_per_op;
+    if (bench.peak_rss_kb) {
+        result.peak_rss_kb = bench.peak_rss_kb();
+    } else {
+        double runs = static_cast<double>(iterations * options.samples);
+        result.allocations_per_op = static_cast<double>(AllocTracker::allocations() - allocations) / runs;
+        result.bytes_per_op = static_cast<double>(AllocTracker::allocated_bytes() - bytes) / runs;
+        result.peak_rss_kb = peak_rss_kb();
+        if (AllocTracker::tracking()) {
+            result.peak_live_kb = static_cast<long>((AllocTracker::peak_live_bytes() - live) / 1024);
+        }
+    }
+    return result;
+}
+
+// 单基金数据上的各阶段
+void add_stage_cases(vector<Case>& cases, const Fixture& fixture)
+{
+    const string& code = fixture.codes[0];
+    const FundData& fund_data = fixture.series[0];
+    const size_t days = fund_data.size();
+    const string suffix = "/" + fixture.name;
+
+    cases.push_back({"parse" + suffix, days, 1, [&fixture, &code]() {
+        SINK = SINK + parse_worth_trend(fixture.scripts[0], "Data_ACWorthTrend", code).size();
+    }});
+    cases.push_back({"load" + suffix, days, 1, [&fixture]() {
+        SINK = SINK + FundData(fixture.maps[0]).size();
+    }});
+    cases.push_back({"thresholds" + suffix, days, 1, [&fund_data, days]() {
+        SINK = SINK + calculate_thresholds(fund_data, 0, days, PARAMETERS).percentile_high;
+    }});
+    cases.push_back({"grid" + suffix, days, 1, [&fund_data, &code, days]() {
+        SINK = SINK + run_grid(code, fund_data, 0, days, PARAMETERS).total_profit;
+    }});
+    cases.push_back({"periods" + suffix, days, 1, [&fund_data]() {
+        for (const char* period : PERIODS) {
+            size_t start = get_start_date(fund_data, period);
+            size_t end = get_end_date(fund_data, period);
+            if (start < end) {
+                SINK = SINK + fund_data.range_stats(start, end).stdev_price;
+            }
+        }
+    }});
+    auto outcome = std::make_shared<GridOutcome>(run_grid(code, fund_data, 0, days, PARAMETERS));
+    auto stats = fund_data.range_stats(0, days);
+    cases.push_back({"report" + suffix, days, 1, [outcome, stats]() {
+        ReportBuffer& report = ReportBuffer::thread_local_buffer();
+        format_report(report, *outcome, PARAMETERS, stats);
+        SINK = SINK + report.str().size();
+        report.clear();
+    }});
+    cases.push_back({"cache_key" + suffix, days, 1, [&fund_data, &code, days]() {
+        SINK = SINK + result_cache_key(code, "5", fund_data, 0, days, PARAMETERS, true);
+    }});
+    auto blob = std::make_shared<string>();
+    encode_series(fund_data, *blob);
+    cases.push_back({"encode" + suffix, days, 1, [&fund_data]() {
+        string encoded;
+        encode_series(fund_data, encoded);
+        SINK = SINK + encoded.size();
+    }});
+    cases.push_back({"decode" + suffix, days, 1, [blob]() {
+        FundData decoded;
+        decode_series(reinterpret_cast<const uint8_t*>(blob->data()), blob->size(), decoded);
+        SINK = SINK + decoded.size();
+    }});
+}
+
+// 全部基金的全部周期：单线程、线程池，以及结果写入 SQLite
+void add_universe_cases(vector<Case>& cases, const Fixture& fixture, ThreadPool& pool, const string& work_dir)
+{
+    size_t days = 0;
+    for (size_t i = 0; i < fixture.series.size(); ++i) {
+        days += run_all_periods(fixture.codes[i], fixture.series[i]);
+    }
+    const size_t funds = fixture.series.size();
+
+    cases.push_back({"grid/universe", days, funds, [&fixture]() {
+        for (size_t i = 0; i < fixture.series.size(); ++i) {
+            run_all_periods(fixture.codes[i], fixture.series[i]);
+        }
+    }});
+    cases.push_back({"grid_parallel/universe", days, funds, [&fixture, &pool]() {
+        for (size_t i = 0; i < fixture.series.size(); ++i) {
+            pool.post([&fixture, i]() { run_all_periods(fixture.codes[i], fixture.series[i]); });
+        }
+        pool.wait_idle();
+    }});
+
+    // 每个基金一条 SINCE_ESTABLISHED 的结果，带交易明细
+    auto results = std::make_shared<vector<FundResult>>();
+    for (size_t i = 0; i < funds; ++i) {
+        const FundData& fund_data = fixture.series[i];
+        GridOutcome outcome = run_grid(fixture.codes[i], fund_data, 0, fund_data.size(), PARAMETERS);
+        FundResult result;
+        result.fund_code = fixture.codes[i];
+        result.period = "5";
+        result.total_value = outcome.total_value();
+        result.balance = outcome.balance;
+        result.holdings_value = outcome.holdings_value();
+        result.profit = outcome.total_profit;
+        result.percentile_70_price = outcome.thresholds.percentile_high;
+        result.percentile_30_price = outcome.thresholds.percentile_low;
+        result.operation_id = 1;
+        result.parameters = PARAMETERS;
+        result.operations = operation_records(outcome, PARAMETERS);
+        results->push_back(std::move(result));
+    }
+    auto storage = std::make_shared<DatabaseStorage>(work_dir + "/results.db");
+    cases.push_back({"sqlite_insert/universe", 0, funds, [storage, results]() {
+        storage->beginTransaction();
+        for (const auto& result : *results) {
+            storage->insert(result);
+        }
+        storage->commitTransaction();
+    }});
+}
+
+// 端到端：在准备好的目录中运行 fund 可执行文件。全部序列预先写入 TB_PRICE 并视为未过期，
+// 代理指向不可用的端口，不会有任何下载
+bool add_end_to_end_case(vector<Case>& cases, const Fixture& fixture, const string& binary, const string& work_dir)
+{
+    string program = std::filesystem::absolute(binary).string();
+    if (access(program.c_str(), X_OK) != 0) {
+        fprintf(stderr, "%s is not executable\n", program.c_str());
+        return false;
+    }
+    string dir = work_dir + "/e2e";
+    std::filesystem::create_directories(dir + "/report");
+    {
+        DatabaseStorage storage(dir + "/fund.db");
+        storage.beginTransaction();
+        for (size_t i = 0; i < fixture.series.size(); ++i) {
+            string blob;
+            const FundData& fund_data = fixture.series[i];
+            encode_series(fund_data, blob);
+            storage.savePriceSeries(fixture.codes[i], "ACWorthTrend", blob,
+                static_cast<int>(fund_data.size()), day_index(fund_data.timestamps().back()));
+            storage.setSeriesLength(fixture.codes[i], static_cast<int>(fund_data.size()));
+        }
+        storage.commitTransaction();
+    }
+    std::ofstream config(dir + "/config.txt");
+    config << "fund_codes = [";
+    for (size_t i = 0; i < fixture.codes.size(); ++i) {
+        config << (i ? "," : "") << fixture.codes[i];
+    }
+    config << "]\ngrid_size = " << PARAMETERS.grid_size << "\nbig_grid_size = " << PARAMETERS.big_grid_size
+        << "\nfactor = " << PARAMETERS.factor << "\nsum = " << PARAMETERS.sum << "\namount = " << PARAMETERS.amount
+        << "\nperiod = [0,1,2,3,4,5,6]\nthreshold_low = " << PARAMETERS.threshold_low
+        << "\nthreshold_high = " << PARAMETERS.threshold_high
+        << "\ndb_path = " << dir << "/fund.db\nsave_operations = 1\nprice_cache_hours = 1000000\nresult_cache = 0"
+        << "\nlog_level = error\n";
+    config.close();
+
+    size_t days = 0;
+    for (size_t i = 0; i < fixture.series.size(); ++i) {
+        days += run_all_periods(fixture.codes[i], fixture.series[i]);
+    }
+    auto child_peak_rss = std::make_shared<long>(0);
+    Case bench{"main/universe", days, fixture.series.size(), [program, dir, child_peak_rss]() {
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (chdir(dir.c_str()) != 0) {
+                _exit(127);
+            }
+            setenv("http_proxy", "http://127.0.0.1:9", 1);
+            int null_fd = open("/dev/null", O_WRONLY);
+            dup2(null_fd, STDOUT_FILENO);
+            execl(program.c_str(), program.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        int status = 0;
+        struct rusage usage {};
+        if (pid < 0 || wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "%s failed (status %d)\n", program.c_str(), status);
+            return;
+        }
+        *child_peak_rss = std::max(*child_peak_rss, usage.ru_maxrss);
+    }};
+    bench.single_shot = true;
+    bench.peak_rss_kb = [child_peak_rss]() { return *child_peak_rss; };
+    cases.push_back(std::move(bench));
+    return true;
+}
+
+json to_json(const Measurement& m)
+{
+    json item = {
+        {"name", m.name}, {"iterations", m.iterations}, {"ns_per_op", m.ns_per_op}, {"ns_per_op_min", m.ns_per_op_min},
+        {"spread", m.spread}, {"days", m.days}, {"funds", m.funds}, {"peak_rss_kb", m.peak_rss_kb},
+    };
+    item["ns_per_day"] = m.days ? json(m.ns_per_op / static_cast<double>(m.days)) : json(nullptr);
+    item["funds_per_second"] = m.funds ? json(static_cast<double>(m.funds) * 1e9 / m.ns_per_op) : json(nullptr);
+    item["allocations_per_op"] = m.allocations_per_op >= 0 ? json(m.allocations_per_op) : json(nullptr);
+    item["bytes_per_op"] = m.bytes_per_op >= 0 ? json(m.bytes_per_op) : json(nullptr);
+    item["peak_live_kb"] = m.peak_live_kb >= 0 ? json(m.peak_live_kb) : json(nullptr);
+    return item;
+}
+
+void print_header()
+{
+    printf("%-24s %12s %10s %12s %11s %12s %9s %7s\n",
+        "case", "ns/op", "ns/day", "funds/s", "allocs/op", "bytes/op", "RSS MB", "spread");
+}
+
+void print_measurement(const Measurement& m)
+{
+    char per_day[32] = "-", funds[32] = "-", allocations[32] = "-", bytes[32] = "-";
+    if (m.days) {
+        snprintf(per_day, sizeof(per_day), "%.2f", m.ns_per_op / static_cast<double>(m.days));
+    }
+    if (m.funds) {
+        snprintf(funds, sizeof(funds), "%.1f", static_cast<double>(m.funds) * 1e9 / m.ns_per_op);
+    }
+    if (m.allocations_per_op >= 0) {
+        snprintf(allocations, sizeof(allocations), "%.1f", m.allocations_per_op);
+        snprintf(bytes, sizeof(bytes), "%.0f", m.bytes_per_op);
+    }
+    printf("%-24s %12.0f %10s %12s %11s %12s %9.1f %6.1f%%\n", m.name.c_str(), m.ns_per_op, per_day, funds,
+        allocations, bytes, static_cast<double>(m.peak_rss_kb) / 1024, m.spread * 100);
+    fflush(stdout);
+}
+
+json load_json(const string& path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    return json::parse(in);
+}
+
+// 按用例名对比两次结果：耗时变化超过两次结果波动之和（至少 3%）时标 *；
+// 分配次数是确定的，增加即标 !，两次都跟踪了分配时存活峰值增加超过 10% 也标 !
+int compare(const string& base_path, const string& new_path)
+{
+    json base, current;
+    try {
+        base = load_json(base_path);
+        current = load_json(new_path);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    std::map<string, json> base_cases;
+    for (const auto& item : base["cases"]) {
+        base_cases[item["name"].get<string>()] = item;
+    }
+    printf("%-24s %12s %12s %9s %11s %11s %9s %9s\n",
+        "case", "base ns/op", "new ns/op", "change", "base alloc", "new alloc", "base MB", "new MB");
+    auto allocations = [](const json& item) {
+        return item["allocations_per_op"].is_null() ? string("-") : std::to_string(std::lround(item["allocations_per_op"].get<double>()));
+    };
+    auto memory_regressed = [](const json& old, const json& item) {
+        if (!old["allocations_per_op"].is_null() && !item["allocations_per_op"].is_null()
+            && std::lround(item["allocations_per_op"].get<double>()) > std::lround(old["allocations_per_op"].get<double>())) {
+            return true;
+        }
+        if (old.contains("peak_live_kb") && item.contains("peak_live_kb")
+            && !old["peak_live_kb"].is_null() && !item["peak_live_kb"].is_null()) {
+            return item["peak_live_kb"].get<double>() > old["peak_live_kb"].get<double>() * 1.1 + 4;
+        }
+        return false;
+    };
+    for (const auto& item : current["cases"]) {
+        string name = item["name"].get<string>();
+        auto found = base_cases.find(name);
+        if (found == base_cases.end()) {
+            printf("%-24s %12s %12.0f %9s\n", name.c_str(), "-", item["ns_per_op"].get<double>(), "new");
+            continue;
+        }
+        const json& old = found->second;
+        double before = old["ns_per_op"].get<double>(), after = item["ns_per_op"].get<double>();
+        double change = after / before - 1;
+        double noise = std::max(old["spread"].get<double>() + item["spread"].get<double>(), 0.03);
+        printf("%-24s %12.0f %12.0f %+8.1f%%%s %10s %10s%s %9.1f %9.1f\n", name.c_str(), before, after, change * 100,
+            std::abs(change) > noise ? "*" : " ", allocations(old).c_str(), allocations(item).c_str(),
+            memory_regressed(old, item) ? "!" : " ",
+            old["peak_rss_kb"].get<double>() / 1024, item["peak_rss_kb"].get<double>() / 1024);
+        base_cases.erase(found);
+    }
+    for (const auto& [name, item] : base_cases) {
+        printf("%-24s %12.0f %12s %9s\n", name.c_str(), item["ns_per_op"].get<double>(), "-", "missing");
+    }
+    return 0;
+}
+
+void print_usage(const char* program)
+{
+    fprintf(stderr,
+        "Usage: %s [--filter TEXT] [--samples N] [--min-time MS] [--json FILE] [--fund PATH] [--alloc FILE] [--list]\n"
+        "       %s --compare BASE.json NEW.json\n"
+        "  --filter TEXT   only run cases whose name contains TEXT\n"
+        "  --samples N     samples per case, the median is reported (default 5)\n"
+        "  --min-time MS   total time per case used to choose the iteration count (default 1000)\n"
+        "  --json FILE     also write the results as JSON\n"
+        "  --fund PATH     run the end-to-end case with this fund binary against offline data\n"
+        "  --alloc FILE    track allocations by stage (adds peak live KB per case to the JSON) and write them to FILE\n",
+        program, program);
+}
+
+// 整个参数都是合法的数值时才接受，否则打印用法，避免以错误的设置跑完整套测试
+template <typename T>
+bool parse_number(const char* text, T& value)
+{
+    const char* end = text + strlen(text);
+    auto [ptr, error] = std::from_chars(text, end, value);
+    return error == std::errc() && ptr == end && ptr != text;
+}
+
+bool parse_options(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--filter" && has_value) {
+            options.filter = argv[++i];
+        } else if (arg == "--samples" && has_value) {
+            if (!parse_number(argv[++i], options.samples) || options.samples == 0) {
+                return false;
+            }
+        } else if (arg == "--min-time" && has_value) {
+            if (!parse_number(argv[++i], options.min_time_ms) || options.min_time_ms <= 0) {
+                return false;
+            }
+        } else if (arg == "--json" && has_value) {
+            options.json_path = argv[++i];
+        } else if (arg == "--fund" && has_value) {
+            options.fund_binary = argv[++i];
+        } else if (arg == "--alloc" && has_value) {
+            options.alloc_path = argv[++i];
+        } else if (arg == "--list") {
+            options.list = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc == 4 && string(argv[1]) == "--compare") {
+        return compare(argv[2], argv[3]);
+    }
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    // 存活字节需要每块内存带上头，只能从进程启动时开始跟踪
+    if (!options.alloc_path.empty() && !AllocTracker::tracking()) {
+        AllocTracker::restart_with_tracking(argv);
+        perror("execv");
+        return 1;
+    }
+    AllocTracker::count_totals();
+    Logger::instance().set_level(LogLevel::WARN);
+
+    char work_dir_template[] = "/tmp/fundbench.XXXXXX";
+    if (!mkdtemp(work_dir_template)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    const string work_dir = work_dir_template;
+
+    // 一年、二十年的单个基金和 1000 个基金
+    const Fixture small = single_fund_fixture("small", TRADING_DAYS_PER_YEAR);
+    const Fixture twenty_years = single_fund_fixture("20y", 20 * TRADING_DAYS_PER_YEAR);
+    const Fixture universe = universe_fixture(1000);
+    ThreadPool pool(std::thread::hardware_concurrency());
+
+    vector<Case> cases;
+    add_stage_cases(cases, small);
+    add_stage_cases(cases, twenty_years);
+    add_universe_cases(cases, universe, pool, work_dir);
+    if (!options.fund_binary.empty() && !add_end_to_end_case(cases, universe, options.fund_binary, work_dir)) {
+        std::filesystem::remove_all(work_dir);
+        return 1;
+    }
+
+    json report = {
+        {"engine_version", ENGINE_VERSION}, {"compiler", __VERSION__},
+        {"threads", pool.size()}, {"samples", options.samples}, {"min_time_ms", options.min_time_ms},
+        {"universe_funds", universe.series.size()}, {"universe_days", universe.days()}, {"cases", json::array()},
+    };
+    if (!options.list) {
+        print_header();
+    }
+    for (const auto& bench : cases) {
+        if (bench.name.find(options.filter) == string::npos) {
+            continue;
+        }
+        if (options.list) {
+            printf("%s\n", bench.name.c_str());
+            continue;
+        }
+        Measurement m = measure(bench, options);
+        print_measurement(m);
+        report["cases"].push_back(to_json(m));
+    }
+
+    std::filesystem::remove_all(work_dir);
+    if (!options.alloc_path.empty() && !options.list && !AllocTracker::write(options.alloc_path)) {
+        return 1;
+    }
+    if (!options.json_path.empty()) {
+        std::ofstream out(options.json_path);
+        out << report.dump(2) << '\n';
+        if (!out) {
+            fprintf(stderr, "cannot write %s\n", options.json_path.c_str());
+            return 1;
+        }
+    }
+    Logger::instance().shutdown();
+    return 0;
+}
+
+// 编译命令：g++ -O2 -o fundbench fundbench.cpp FundData.cpp GridEngine.cpp ThreadPool.cpp Logger.cpp ReportWriter.cpp SeriesCodec.cpp ResultCache.cpp WorthTrend.cpp SyntheticSeries.cpp UniverseSnapshot.cpp Trace.cpp PerfCounters.cpp AllocTracker.cpp CppSQLite/DataBaseStorage.cpp CppSQLite/CppSQLite3.cpp -lsqlite3 -lpthread -std=c++20
@@ -0,0 +1,314 @@
+// 列式结果文件的查询工具：过滤、按列取前 N 行、分组聚合。
+// 过滤条件先和每块的 min/max 比较，不可能命中的块整块跳过，不解码。
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ColumnStore.hpp"
+#include "Logger.hpp"
+
+using std::string;
+using std::vector;
+
+struct Filter {
+    int column;
+    string op;
+    double value;
+};
+
+struct Query {
+    string path;
+    vector<Filter> filters;
+    vector<int> columns;
+    int top_column = -1;      // --top N COL：按 COL 取前 N 行
+    size_t limit = 20;
+    bool ascending = false;
+    int group_column = -1;    // --group-by COL
+    int aggregate_column = COL_PROFIT;
+    bool info = false;
+};
+
+void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s FILE --info                                      show chunks and column ranges\n"
+        "       %s FILE [--where COL OP VALUE]... [--select COL,...] [--top N COL [--asc]] [--limit N]\n"
+        "       %s FILE [--where COL OP VALUE]... --group-by COL [--agg COL]\n"
+        "OP is one of < <= > >= = !=\n",
+        program, program, program);
+}
+
+bool parse_column(const string& name, int& column) {
+    column = find_result_column(name);
+    if (column < 0) {
+        fprintf(stderr, "Unknown column: %s\n", name.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 整个参数都是合法的数值时才接受，否则打印用法，不把拼错的值当成 0
+template <typename T>
+bool parse_number(const char* text, T& value) {
+    const char* end = text + strlen(text);
+    auto [ptr, error] = std::from_chars(text, end, value);
+    return error == std::errc() && ptr == end && ptr != text;
+}
+
+bool parse_query(int argc, char* argv[], Query& query) {
+    if (argc < 2) {
+        return false;
+    }
+    query.path = argv[1];
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        int remaining = argc - i - 1;
+        if (arg == "--info") {
+            query.info = true;
+        } else if (arg == "--where" && remaining >= 3) {
+            Filter filter;
+            string op = argv[i + 2];
+            if (!parse_column(argv[i + 1], filter.column)
+                || (op != "<" && op != "<=" && op != ">" && op != ">=" && op != "=" && op != "!=")) {
+                return false;
+            }
+            filter.op = op;
+            if (!parse_number(argv[i + 3], filter.value) || std::isnan(filter.value)) {
+                return false;
+            }
+            query.filters.push_back(filter);
+            i += 3;
+        } else if (arg == "--select" && remaining >= 1) {
+            string list = argv[++i];
+            size_t start = 0;
+            while (start <= list.size()) {
+                size_t comma = std::min(list.find(',', start), list.size());
+                int column;
+                if (!parse_column(list.substr(start, comma - start), column)) {
+                    return false;
+                }
+                query.columns.push_back(column);
+                start = comma + 1;
+            }
+        } else if (arg == "--top" && remaining >= 2) {
+            if (!parse_number(argv[i + 1], query.limit) || !parse_column(argv[i + 2], query.top_column)) {
+                return false;
+            }
+            i += 2;
+        } else if (arg == "--asc") {
+            query.ascending = true;
+        } else if (arg == "--limit" && remaining >= 1) {
+            if (!parse_number(argv[++i], query.limit)) {
+                return false;
+            }
+        } else if (arg == "--group-by" && remaining >= 1) {
+            if (!parse_column(argv[++i], query.group_column)) {
+                return false;
+            }
+        } else if (arg == "--agg" && remaining >= 1) {
+            if (!parse_column(argv[++i], query.aggregate_column)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    if (query.columns.empty()) {
+        query.columns = {COL_RUN_ID, COL_FUND_CODE, COL_PERIOD, COL_GRID_SIZE, COL_TOTAL_VALUE, COL_PROFIT};
+    }
+    return true;
+}
+
+bool matches(const Filter& filter, double value) {
+    if (filter.op == "<") return value < filter.value;
+    if (filter.op == "<=") return value <= filter.value;
+    if (filter.op == ">") return value > filter.value;
+    if (filter.op == ">=") return value >= filter.value;
+    if (filter.op == "=") return value == filter.value;
+    return value != filter.value;
+}
+
+// 块内的值都落在 [min, max] 中，据此判断整块是否可能有命中的行
+bool chunk_may_match(const ColumnFile& file, size_t chunk, const vector<Filter>& filters) {
+    for (const auto& filter : filters) {
+        double min = file.chunk_min(chunk, filter.column);
+        double max = file.chunk_max(chunk, filter.column);
+        bool possible = true;
+        if (filter.op == "<") possible = min < filter.value;
+        else if (filter.op == "<=") possible = min <= filter.value;
+        else if (filter.op == ">") possible = max > filter.value;
+        else if (filter.op == ">=") possible = max >= filter.value;
+        else if (filter.op == "=") possible = min <= filter.value && filter.value <= max;
+        else possible = !(min == filter.value && max == filter.value);
+        if (!possible) {
+            return false;
+        }
+    }
+    return true;
+}
+
+string format_value(int column, double value) {
+    char text[32];
+    if (column == COL_FUND_CODE) {
+        snprintf(text, sizeof(text), "%06d", static_cast<int>(value));
+    } else if (result_column(column).type == ColumnType::INT32) {
+        snprintf(text, sizeof(text), "%d", static_cast<int>(value));
+    } else {
+        snprintf(text, sizeof(text), "%.4f", value);
+    }
+    return text;
+}
+
+void print_info(const ColumnFile& file) {
+    printf("chunks: %zu  rows: %zu\n", file.chunk_count(), file.rows());
+    for (int column = 0; column < RESULT_COLUMN_COUNT; ++column) {
+        double min = 0, max = 0;
+        for (size_t chunk = 0; chunk < file.chunk_count(); ++chunk) {
+            min = chunk == 0 ? file.chunk_min(chunk, column) : std::min(min, file.chunk_min(chunk, column));
+            max = chunk == 0 ? file.chunk_max(chunk, column) : std::max(max, file.chunk_max(chunk, column));
+        }
+        printf("%-20s %s  min %s  max %s\n", result_column(column).name,
+            result_column(column).type == ColumnType::INT32 ? "int32  " : "float64",
+            format_value(column, min).c_str(), format_value(column, max).c_str());
+    }
+}
+
+struct Aggregate {
+    size_t count = 0;
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+};
+
+int run_query(const Query& query) {
+    ColumnFile file;
+    if (!file.open(query.path)) {
+        return 1;
+    }
+    if (query.info) {
+        print_info(file);
+        return 0;
+    }
+
+    // 每块只解码用到的列
+    vector<int> needed = query.columns;
+    for (const auto& filter : query.filters) needed.push_back(filter.column);
+    if (query.top_column >= 0) needed.push_back(query.top_column);
+    if (query.group_column >= 0) {
+        needed = {query.group_column, query.aggregate_column};
+        for (const auto& filter : query.filters) needed.push_back(filter.column);
+    }
+    std::sort(needed.begin(), needed.end());
+    needed.erase(std::unique(needed.begin(), needed.end()), needed.end());
+
+    using Row = std::pair<double, vector<double>>;
+    auto better = [&](const Row& a, const Row& b) {
+        return query.ascending ? a.first < b.first : a.first > b.first;
+    };
+    // 堆顶是当前前 N 行中最差的一行
+    std::priority_queue<Row, vector<Row>, decltype(better)> top(better);
+    vector<vector<double>> rows;
+    std::map<double, Aggregate> groups;
+
+    vector<vector<double>> values(RESULT_COLUMN_COUNT);
+    size_t scanned = 0;
+    bool done = false;
+    for (size_t chunk = 0; chunk < file.chunk_count() && !done; ++chunk) {
+        if (!chunk_may_match(file, chunk, query.filters)) {
+            continue;
+        }
+        ++scanned;
+        for (int column : needed) {
+            file.values(chunk, column, values[column]);
+        }
+        for (size_t row = 0; row < file.chunk_rows(chunk); ++row) {
+            bool selected = std::all_of(query.filters.begin(), query.filters.end(), [&](const Filter& filter) {
+                return matches(filter, values[filter.column][row]);
+            });
+            if (!selected) {
+                continue;
+            }
+            if (query.group_column >= 0) {
+                double value = values[query.aggregate_column][row];
+                Aggregate& group = groups[values[query.group_column][row]];
+                group.min = group.count == 0 ? value : std::min(group.min, value);
+                group.max = group.count == 0 ? value : std::max(group.max, value);
+                group.sum += value;
+                group.count++;
+                continue;
+            }
+            vector<double> output;
+            for (int column : query.columns) {
+                output.push_back(values[column][row]);
+            }
+            if (query.top_column < 0) {
+                rows.push_back(std::move(output));
+                if (rows.size() >= query.limit) {
+                    done = true;
+                    break;
+                }
+                continue;
+            }
+            double key = values[query.top_column][row];
+            if (top.size() < query.limit) {
+                top.emplace(key, std::move(output));
+            } else if (query.limit > 0 && better(Row(key, {}), top.top())) {
+                top.pop();
+                top.emplace(key, std::move(output));
+            }
+        }
+    }
+
+    if (query.group_column >= 0) {
+        printf("%s\tcount\tsum(%s)\tavg\tmin\tmax\n", result_column(query.group_column).name,
+            result_column(query.aggregate_column).name);
+        for (const auto& [key, group] : groups) {
+            printf("%s\t%zu\t%.4f\t%.4f\t%.4f\t%.4f\n", format_value(query.group_column, key).c_str(),
+                group.count, group.sum, group.sum / group.count, group.min, group.max);
+        }
+    } else {
+        if (query.top_column >= 0) {
+            while (!top.empty()) {
+                rows.push_back(std::move(const_cast<Row&>(top.top()).second));
+                top.pop();
+            }
+            std::reverse(rows.begin(), rows.end());
+        }
+        for (size_t i = 0; i < query.columns.size(); ++i) {
+            printf("%s%s", i ? "\t" : "", result_column(query.columns[i]).name);
+        }
+        printf("\n");
+        for (const auto& row : rows) {
+            for (size_t i = 0; i < row.size(); ++i) {
+                printf("%s%s", i ? "\t" : "", format_value(query.columns[i], row[i]).c_str());
+            }
+            printf("\n");
+        }
+    }
+    fprintf(stderr, "scanned %zu of %zu chunks (%zu rows)\n", scanned, file.chunk_count(), file.rows());
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    Query query;
+    if (!parse_query(argc, argv, query)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    int exit_code = 1;
+    try {
+        exit_code = run_query(query);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+    }
+    Logger::instance().shutdown();
+    return exit_code;
+}
+
+// 编译命令：g++ -O2 -o fundcol fundcol.cpp ColumnStore.cpp Logger.cpp -lpthread -std=c++20
@@ -0,0 +1,701 @@
+// 差分测试：在大量合成和真实的净值序列、随机的网格参数上，把 run_grid 等实现与 ReferenceEngine 中冻结的参考实现逐项对比：
+// 分位阈值、余额、持仓、收益、最低余额、估值净值和逐笔交易。发现不一致时把输入收缩到仍能复现的最短序列，
+// 写成复现文件，可以用 --replay 重放。优化的实现加入下面的 ENGINES 表即可参与对比
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FundData.hpp"
+#include "GridEngine.hpp"
+#include "Logger.hpp"
+#include "ReferenceEngine.hpp"
+#include "SeriesCodec.hpp"
+#include "SyntheticSeries.hpp"
+#include "ThreadPool.hpp"
+#include "UniverseSnapshot.hpp"
+#include "WorthTrend.hpp"
+#include "CppSQLite/DataBaseStorage.hpp"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+using EngineFunction = GridOutcome (*)(const FundData&, size_t, size_t, const ResultParameters&);
+
+struct Engine
+{
+    const char* name;
+    const char* description;
+    EngineFunction run;
+    bool by_default;
+};
+
+GridOutcome production_engine(const FundData& fund_data, size_t start, size_t end, const ResultParameters& parameters)
+{
+    return run_grid("funddiff", fund_data, start, end, parameters);
+}
+
+// 记录资产曲线的路径不能改变结果
+GridOutcome production_equity_engine(const FundData& fund_data, size_t start, size_t end, const ResultParameters& parameters)
+{
+    vector<double> equity;
+    GridOutcome outcome = run_grid("funddiff", fund_data, start, end, parameters, &equity);
+    if (equity.size() != end - start) {
+        outcome.balance = NAN;
+    }
+    return outcome;
+}
+
+// 故意忽略区间最后一个交易日的实现，用来确认对比和收缩本身有效
+GridOutcome mutant_engine(const FundData& fund_data, size_t start, size_t end, const ResultParameters& parameters)
+{
+    GridOutcome outcome = reference_run_grid(fund_data, start, std::max(start + 1, end - 1), parameters);
+    outcome.end = end;
+    outcome.thresholds = reference_thresholds(fund_data, start, end, parameters);
+    outcome.latest_price = fund_data.price(std::min(end, fund_data.size() - 1));
+    return outcome;
+}
+
+const Engine ENGINES[] = {
+    {"run_grid", "the production engine used by batch runs and the server", production_engine, true},
+    {"run_grid+equity", "run_grid recording the equity curve", production_equity_engine, true},
+    {"mutant", "reference that skips the last day of the range (harness self-check)", mutant_engine, false},
+};
+
+const ResultParameters DEFAULT_PARAMETERS = {0.05, 0.3, 3, 40500, 2000, 0.1, 0.5};
+
+// 一个对比用例：序列的 [start, end) 区间和一组参数
+struct DiffCase
+{
+    string source;
+    std::shared_ptr<const FundData> data;
+    size_t start = 0;
+    size_t end = 0;
+    ResultParameters parameters;
+};
+
+struct Difference
+{
+    string field;
+    string expected;
+    string actual;
+};
+
+// 与平台无关的随机数：mt19937_64 的输出序列由标准规定，取值换算在这里完成
+class Random
+{
+public:
+    Random(uint64_t seed, uint64_t stream) : engine_(seed * 0x9e3779b97f4a7c15ULL + stream) {}
+
+    double uniform() { return static_cast<double>(engine_() >> 11) * 0x1.0p-53; }
+    double uniform(double low, double high) { return low + (high - low) * uniform(); }
+    size_t below(size_t n) { return static_cast<size_t>(engine_() % n); }
+    bool chance(double p) { return uniform() < p; }
+    uint64_t next() { return engine_(); }
+
+private:
+    std::mt19937_64 engine_;
+};
+
+double round_to(double value, double step)
+{
+    return std::round(value / step) * step;
+}
+
+ResultParameters random_parameters(Random& random)
+{
+    ResultParameters parameters;
+    parameters.grid_size = round_to(random.uniform(0.005, 0.12), 0.001);
+    parameters.big_grid_size = round_to(parameters.grid_size * random.uniform(1.5, 8), 0.001);
+    parameters.factor = 1 + static_cast<int>(random.below(5));
+    const double amounts[] = {100, 500, 1000, 2000, 5000};
+    parameters.amount = amounts[random.below(5)];
+    // 偶尔让本金不够一次买入
+    parameters.sum = random.chance(0.05) ? parameters.amount / 2
+        : parameters.amount * static_cast<double>(1 + random.below(40)) + 100 * static_cast<double>(random.below(10));
+    // 阈值在配置中是 float，取两位小数，包括 0 和 1 这样的边界
+    parameters.threshold_low = random.chance(0.1) ? 0 : round_to(random.uniform(0, 0.5), 0.01);
+    parameters.threshold_high = random.chance(0.1) ? 1 : round_to(random.uniform(parameters.threshold_low, 1), 0.01);
+    parameters.threshold_low = static_cast<float>(parameters.threshold_low);
+    parameters.threshold_high = static_cast<float>(parameters.threshold_high);
+    return parameters;
+}
+
+// 整个序列、某个周期或随机的子区间
+void choose_range(Random& random, const FundData& fund_data, size_t& start, size_t& end)
+{
+    const size_t n = fund_data.size();
+    start = 0;
+    end = n;
+    double kind = random.uniform();
+    if (kind < 0.3) {
+        string period = std::to_string(random.below(CUSTOMIZED_TIME + 1));
+        size_t period_start = get_start_date(fund_data, period);
+        size_t period_end = get_end_date(fund_data, period);
+        if (period_start < period_end) {
+            start = period_start;
+            end = period_end;
+        }
+    } else if (kind < 0.6 && n > 1) {
+        start = random.below(n);
+        end = start + 1 + random.below(n - start);
+    }
+}
+
+DiffCase synthetic_case(uint64_t seed, size_t index)
+{
+    Random random(seed, index);
+    SyntheticSpec spec;
+    spec.model = static_cast<SyntheticModel>(random.below(3));
+    spec.drift = random.uniform(-0.3, 0.4);
+    spec.volatility = random.uniform(0.03, 0.8);
+    spec.start_price = round_to(random.uniform(0.3, 5), 0.0001);
+    // 位数少的净值有大量相等的价格，正好落在比较的边界上
+    spec.price_digits = 2 + static_cast<int>(random.below(3));
+    double length = random.uniform();
+    size_t days = length < 0.3 ? 1 + random.below(60)
+        : length < 0.8 ? 60 + random.below(1500) : 1500 + random.below(4500);
+
+    vector<long> timestamps(days);
+    vector<double> prices(days);
+    generate_series(spec, random.next(), index, days, timestamps.data(), prices.data());
+    DiffCase diff_case;
+    const char* const models[] = {"gbm", "regime", "jump"};
+    diff_case.source = "synthetic #" + std::to_string(index) + " (" + models[static_cast<int>(spec.model)] + ", "
+        + std::to_string(days) + " days)";
+    diff_case.data = std::make_shared<const FundData>(std::move(timestamps), std::move(prices));
+    choose_range(random, *diff_case.data, diff_case.start, diff_case.end);
+    diff_case.parameters = random_parameters(random);
+    return diff_case;
+}
+
+string format_number(double value)
+{
+    char text[40];
+    snprintf(text, sizeof(text), "%.17g", value);
+    return text;
+}
+
+// 金额相差不超过 tolerance 视为一致（默认半分钱），tolerance 为 0 时要求完全相同；净值、阈值和交易始终要求完全相同
+vector<Difference> compare_outcomes(const GridOutcome& expected, const GridOutcome& actual, double tolerance)
+{
+    vector<Difference> differences;
+    auto exact = [&differences](const string& field, double a, double b) {
+        if (!(a == b)) {
+            differences.push_back({field, format_number(a), format_number(b)});
+        }
+    };
+    auto money = [&differences, tolerance](const string& field, double a, double b) {
+        if (!(std::abs(a - b) <= tolerance) && !(a == b)) {
+            differences.push_back({field, format_number(a), format_number(b)});
+        }
+    };
+    exact("percentile_high", expected.thresholds.percentile_high, actual.thresholds.percentile_high);
+    exact("percentile_low", expected.thresholds.percentile_low, actual.thresholds.percentile_low);
+    exact("latest_price", expected.latest_price, actual.latest_price);
+    money("balance", expected.balance, actual.balance);
+    money("holdings_value", expected.holdings_value(), actual.holdings_value());
+    money("total_profit", expected.total_profit, actual.total_profit);
+    money("touched_lowest_balance", expected.touched_lowest_balance, actual.touched_lowest_balance);
+    if (tolerance == 0) {
+        exact("holdings", expected.holdings, actual.holdings);
+    }
+    if (expected.operations.size() != actual.operations.size()) {
+        differences.push_back({"operations.size", std::to_string(expected.operations.size()),
+            std::to_string(actual.operations.size())});
+    }
+    size_t common = std::min(expected.operations.size(), actual.operations.size());
+    for (size_t i = 0; i < common; ++i) {
+        const TradeOperation& a = expected.operations[i];
+        const TradeOperation& b = actual.operations[i];
+        string prefix = "operations[" + std::to_string(i) + "].";
+        auto flag = [&](const char* field, bool x, bool y) {
+            if (x != y) {
+                differences.push_back({prefix + field, x ? "true" : "false", y ? "true" : "false"});
+            }
+        };
+        exact(prefix + "buy_timestamp", static_cast<double>(a.buy_timestamp), static_cast<double>(b.buy_timestamp));
+        exact(prefix + "buy_price", a.buy_price, b.buy_price);
+        exact(prefix + "sell_timestamp", static_cast<double>(a.sell_timestamp), static_cast<double>(b.sell_timestamp));
+        exact(prefix + "sell_price", a.sell_price, b.sell_price);
+        flag("money_not_enough", a.money_not_enough, b.money_not_enough);
+        flag("big_grid_size", a.big_grid_size, b.big_grid_size);
+        flag("dealed", a.dealed, b.dealed);
+    }
+    return differences;
+}
+
+vector<Difference> run_case(const Engine& engine, const FundData& fund_data, size_t start, size_t end,
+    const ResultParameters& parameters, double tolerance)
+{
+    GridOutcome expected = reference_run_grid(fund_data, start, end, parameters);
+    GridOutcome actual = engine.run(fund_data, start, end, parameters);
+    return compare_outcomes(expected, actual, tolerance);
+}
+
+// 收缩中的输入：区间之前的交易日已经去掉，区间为 [0, range_days)，之后最多保留一个估值用的交易日
+struct Repro
+{
+    vector<long> timestamps;
+    vector<double> prices;
+    size_t range_days = 0;
+    ResultParameters parameters;
+
+    bool fails(const Engine& engine, double tolerance) const
+    {
+        if (range_days == 0) {
+            return false;
+        }
+        FundData fund_data(timestamps, prices);
+        return !run_case(engine, fund_data, 0, range_days, parameters, tolerance).empty();
+    }
+
+    Repro without(size_t from, size_t count) const
+    {
+        Repro smaller = *this;
+        smaller.timestamps.erase(smaller.timestamps.begin() + from, smaller.timestamps.begin() + from + count);
+        smaller.prices.erase(smaller.prices.begin() + from, smaller.prices.begin() + from + count);
+        smaller.range_days -= std::min(count, range_days > from ? range_days - from : 0);
+        return smaller;
+    }
+};
+
+Repro initial_repro(const DiffCase& diff_case)
+{
+    Repro repro;
+    size_t last = std::min(diff_case.end + 1, diff_case.data->size());
+    for (size_t i = diff_case.start; i < last; ++i) {
+        repro.timestamps.push_back(diff_case.data->timestamp(i));
+        repro.prices.push_back(diff_case.data->price(i));
+    }
+    repro.range_days = diff_case.end - diff_case.start;
+    repro.parameters = diff_case.parameters;
+    return repro;
+}
+
+// 先按块删除交易日（块从一半开始逐次减半，删掉后仍不一致就保留删除），再把净值逐个化简为较少的小数位，
+// 最后把时间戳换成连续的工作日，便于阅读。每一步都保证结果仍然不一致
+Repro shrink(Repro repro, const Engine& engine, double tolerance)
+{
+    for (size_t chunk = std::max<size_t>(repro.prices.size() / 2, 1); chunk >= 1; chunk /= 2) {
+        bool removed = true;
+        while (removed) {
+            removed = false;
+            for (size_t from = 0; from + chunk <= repro.prices.size();) {
+                Repro candidate = repro.without(from, chunk);
+                if (candidate.fails(engine, tolerance)) {
+                    repro = std::move(candidate);
+                    removed = true;
+                } else {
+                    from += chunk;
+                }
+            }
+        }
+        if (chunk == 1) {
+            break;
+        }
+    }
+    for (size_t i = 0; i < repro.prices.size(); ++i) {
+        for (double step : {1.0, 0.1, 0.01, 0.001}) {
+            Repro candidate = repro;
+            candidate.prices[i] = std::max(round_to(repro.prices[i], step), step);
+            if (candidate.prices[i] != repro.prices[i] && candidate.fails(engine, tolerance)) {
+                repro = std::move(candidate);
+                break;
+            }
+        }
+    }
+    Repro renumbered = repro;
+    long day = 20453;  // 与合成序列一样截止于 2025-12-31
+    for (size_t i = renumbered.timestamps.size(); i-- > 0;) {
+        while (((day % 7) + 7) % 7 == 2 || ((day % 7) + 7) % 7 == 3) {
+            --day;
+        }
+        renumbered.timestamps[i] = day-- * 86400 - 8 * 3600;
+    }
+    return renumbered.fails(engine, tolerance) ? renumbered : repro;
+}
+
+bool write_repro(const string& path, const Repro& repro, const string& engine, const string& source)
+{
+    std::ofstream out(path);
+    out << "# funddiff repro: engine " << engine << ", from " << source << '\n'
+        << "grid_size " << format_number(repro.parameters.grid_size) << '\n'
+        << "big_grid_size " << format_number(repro.parameters.big_grid_size) << '\n'
+        << "factor " << repro.parameters.factor << '\n'
+        << "sum " << format_number(repro.parameters.sum) << '\n'
+        << "amount " << format_number(repro.parameters.amount) << '\n'
+        << "threshold_low " << format_number(repro.parameters.threshold_low) << '\n'
+        << "threshold_high " << format_number(repro.parameters.threshold_high) << '\n'
+        << "range_days " << repro.range_days << '\n';
+    for (size_t i = 0; i < repro.prices.size(); ++i) {
+        out << repro.timestamps[i] << ' ' << format_number(repro.prices[i]) << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+bool read_repro(const string& path, Repro& repro)
+{
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        string key;
+        fields >> key;
+        if (key == "grid_size") {
+            fields >> repro.parameters.grid_size;
+        } else if (key == "big_grid_size") {
+            fields >> repro.parameters.big_grid_size;
+        } else if (key == "factor") {
+            fields >> repro.parameters.factor;
+        } else if (key == "sum") {
+            fields >> repro.parameters.sum;
+        } else if (key == "amount") {
+            fields >> repro.parameters.amount;
+        } else if (key == "threshold_low") {
+            fields >> repro.parameters.threshold_low;
+        } else if (key == "threshold_high") {
+            fields >> repro.parameters.threshold_high;
+        } else if (key == "range_days") {
+            fields >> repro.range_days;
+        } else {
+            double price = 0;
+            fields >> price;
+            repro.timestamps.push_back(std::stol(key));
+            repro.prices.push_back(price);
+        }
+    }
+    return repro.range_days > 0 && repro.range_days <= repro.prices.size();
+}
+
+void print_differences(const vector<Difference>& differences)
+{
+    const size_t shown = std::min<size_t>(differences.size(), 8);
+    for (size_t i = 0; i < shown; ++i) {
+        printf("    %-32s reference %-24s engine %s\n", differences[i].field.c_str(),
+            differences[i].expected.c_str(), differences[i].actual.c_str());
+    }
+    if (differences.size() > shown) {
+        printf("    ... %zu more\n", differences.size() - shown);
+    }
+}
+
+void print_repro(const Repro& repro)
+{
+    const ResultParameters& p = repro.parameters;
+    printf("    parameters: grid_size=%g big_grid_size=%g factor=%d sum=%g amount=%g threshold_low=%g threshold_high=%g\n",
+        p.grid_size, p.big_grid_size, p.factor, p.sum, p.amount, p.threshold_low, p.threshold_high);
+    printf("    prices (%zu in range%s):", repro.range_days,
+        repro.prices.size() > repro.range_days ? ", then the valuation price" : "");
+    for (size_t i = 0; i < repro.prices.size() && i < 40; ++i) {
+        printf(" %s%g", i == repro.range_days ? "| " : "", repro.prices[i]);
+    }
+    printf("%s\n", repro.prices.size() > 40 ? " ..." : "");
+}
+
+struct Options
+{
+    size_t cases = 5000;
+    uint64_t seed = 1;
+    vector<string> engines;
+    string db_path;
+    string snapshot_path;
+    vector<string> js_files;
+    size_t parameters_per_series = 20;
+    double tolerance = 0.005;
+    string repro_dir = "funddiff_repros";
+    size_t max_shrink = 3;
+    string replay_path;
+    bool list = false;
+};
+
+// 真实序列：结果库的 TB_PRICE、快照或下载的 pingzhongdata 文件
+vector<std::pair<string, std::shared_ptr<const FundData>>> load_recorded(const Options& options)
+{
+    vector<std::pair<string, std::shared_ptr<const FundData>>> series;
+    if (!options.db_path.empty()) {
+        DatabaseStorage storage(options.db_path);
+        storage.forEachPriceSeries("ACWorthTrend", 0, [&series](const char* code, long, const unsigned char* data, int size) {
+            FundData fund_data;
+            if (decode_series(data, size, fund_data) && !fund_data.empty()) {
+                series.emplace_back(code, std::make_shared<const FundData>(std::move(fund_data)));
+            }
+        });
+    }
+    if (!options.snapshot_path.empty()) {
+        if (auto snapshot = UniverseSnapshot::open(options.snapshot_path)) {
+            for (auto& fund : snapshot->funds()) {
+                if (!fund.data->empty()) {
+                    series.emplace_back(fund.fund_code, fund.data);
+                }
+            }
+        } else {
+            fprintf(stderr, "cannot open snapshot %s\n", options.snapshot_path.c_str());
+        }
+    }
+    for (const auto& path : options.js_files) {
+        std::ifstream in(path);
+        std::stringstream text;
+        text << in.rdbuf();
+        string code = std::filesystem::path(path).stem().string();
+        auto fund_data = std::make_shared<const FundData>(parse_worth_trend(text.str(), "Data_ACWorthTrend", code));
+        if (!fund_data->empty()) {
+            series.emplace_back(code, fund_data);
+        } else {
+            fprintf(stderr, "no prices in %s\n", path.c_str());
+        }
+    }
+    return series;
+}
+
+// 每个真实序列先按配置的默认参数算全部周期，其余用随机参数和区间
+vector<DiffCase> recorded_cases(const Options& options)
+{
+    vector<DiffCase> cases;
+    auto series = load_recorded(options);
+    for (size_t s = 0; s < series.size(); ++s) {
+        const auto& [code, fund_data] = series[s];
+        for (int period = 0; period <= CUSTOMIZED_TIME; ++period) {
+            size_t start = get_start_date(*fund_data, std::to_string(period));
+            size_t end = get_end_date(*fund_data, std::to_string(period));
+            if (start < end) {
+                cases.push_back({code + " period " + std::to_string(period), fund_data, start, end, DEFAULT_PARAMETERS});
+            }
+        }
+        Random random(options.seed, ~static_cast<uint64_t>(s));
+        for (size_t k = 0; k < options.parameters_per_series; ++k) {
+            DiffCase diff_case{code, fund_data, 0, 0, random_parameters(random)};
+            choose_range(random, *fund_data, diff_case.start, diff_case.end);
+            cases.push_back(std::move(diff_case));
+        }
+    }
+    return cases;
+}
+
+struct Mismatch
+{
+    size_t case_index;
+    const Engine* engine;
+    vector<Difference> differences;
+};
+
+int replay(const Options& options, const vector<const Engine*>& engines)
+{
+    Repro repro;
+    if (!read_repro(options.replay_path, repro)) {
+        fprintf(stderr, "cannot read repro %s\n", options.replay_path.c_str());
+        return 2;
+    }
+    FundData fund_data(repro.timestamps, repro.prices);
+    int failures = 0;
+    for (const Engine* engine : engines) {
+        auto differences = run_case(*engine, fund_data, 0, repro.range_days, repro.parameters, options.tolerance);
+        printf("%-20s %s\n", engine->name, differences.empty() ? "matches the reference" : "MISMATCH");
+        print_differences(differences);
+        failures += differences.empty() ? 0 : 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+void print_usage(const char* program)
+{
+    fprintf(stderr,
+        "Usage: %s [--cases N] [--seed S] [--engine NAME]... [--db PATH] [--snapshot PATH] [--js FILE]...\n"
+        "          [--params-per-series K] [--tolerance X] [--repro-dir DIR] [--max-shrink N]\n"
+        "       %s --replay FILE [--engine NAME]...\n"
+        "       %s --list\n"
+        "  --cases N              synthetic series, each with its own parameters and range (default 5000)\n"
+        "  --engine NAME          engine to compare with the reference (default: all but the self-check)\n"
+        "  --db/--snapshot/--js   also use recorded series from TB_PRICE, a snapshot or pingzhongdata files\n"
+        "  --params-per-series K  random parameter sets per recorded series, besides the defaults (default 20)\n"
+        "  --tolerance X          allowed difference of money values (default 0.005, 0 requires identical values)\n"
+        "  --max-shrink N         mismatches to shrink and write to --repro-dir (default 3)\n",
+        program, program, program);
+}
+
+// 整个参数都是合法的数值时才接受，否则打印用法
+template <typename T>
+bool parse_number(const char* text, T& value)
+{
+    const char* end = text + strlen(text);
+    auto [ptr, error] = std::from_chars(text, end, value);
+    return error == std::errc() && ptr == end && ptr != text;
+}
+
+bool parse_options(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--cases" && has_value) {
+            if (!parse_number(argv[++i], options.cases)) {
+                return false;
+            }
+        } else if (arg == "--seed" && has_value) {
+            if (!parse_number(argv[++i], options.seed)) {
+                return false;
+            }
+        } else if (arg == "--engine" && has_value) {
+            options.engines.push_back(argv[++i]);
+        } else if (arg == "--db" && has_value) {
+            options.db_path = argv[++i];
+        } else if (arg == "--snapshot" && has_value) {
+            options.snapshot_path = argv[++i];
+        } else if (arg == "--js" && has_value) {
+            options.js_files.push_back(argv[++i]);
+        } else if (arg == "--params-per-series" && has_value) {
+            if (!parse_number(argv[++i], options.parameters_per_series)) {
+                return false;
+            }
+        } else if (arg == "--tolerance" && has_value) {
+            if (!parse_number(argv[++i], options.tolerance) || !std::isfinite(options.tolerance) || options.tolerance < 0) {
+                return false;
+            }
+        } else if (arg == "--repro-dir" && has_value) {
+            options.repro_dir = argv[++i];
+        } else if (arg == "--max-shrink" && has_value) {
+            if (!parse_number(argv[++i], options.max_shrink)) {
+                return false;
+            }
+        } else if (arg == "--replay" && has_value) {
+            options.replay_path = argv[++i];
+        } else if (arg == "--list") {
+            options.list = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    Logger::instance().set_level(LogLevel::WARN);
+    if (options.list) {
+        for (const Engine& engine : ENGINES) {
+            printf("%-20s %s%s\n", engine.name, engine.description, engine.by_default ? "" : " [not run by default]");
+        }
+        return 0;
+    }
+    vector<const Engine*> engines;
+    for (const Engine& engine : ENGINES) {
+        bool selected = options.engines.empty() ? engine.by_default
+            : std::find(options.engines.begin(), options.engines.end(), engine.name) != options.engines.end();
+        if (selected) {
+            engines.push_back(&engine);
+        }
+    }
+    for (const auto& name : options.engines) {
+        if (std::none_of(engines.begin(), engines.end(), [&name](const Engine* engine) { return name == engine->name; })) {
+            fprintf(stderr, "unknown engine %s, see --list\n", name.c_str());
+            return 2;
+        }
+    }
+    if (!options.replay_path.empty()) {
+        return replay(options, engines);
+    }
+
+    // 合成用例按序号现场生成，真实序列的用例排在其后
+    vector<DiffCase> recorded = recorded_cases(options);
+    const size_t total = options.cases + recorded.size();
+    std::mutex mutex;
+    vector<Mismatch> mismatches;
+    std::atomic<size_t> compared_days{0};
+    {
+        ThreadPool pool(std::thread::hardware_concurrency());
+        const size_t BATCH = 64;
+        for (size_t first = 0; first < total; first += BATCH) {
+            pool.post([&, first]() {
+                for (size_t index = first; index < std::min(first + BATCH, total); ++index) {
+                    DiffCase diff_case = index < options.cases ? synthetic_case(options.seed, index)
+                        : recorded[index - options.cases];
+                    compared_days.fetch_add(diff_case.end - diff_case.start, std::memory_order_relaxed);
+                    for (const Engine* engine : engines) {
+                        auto differences = run_case(*engine, *diff_case.data, diff_case.start, diff_case.end,
+                            diff_case.parameters, options.tolerance);
+                        if (!differences.empty()) {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            mismatches.push_back({index, engine, std::move(differences)});
+                        }
+                    }
+                }
+            });
+        }
+        pool.wait_idle();
+    }
+    std::sort(mismatches.begin(), mismatches.end(), [](const Mismatch& a, const Mismatch& b) {
+        return a.case_index != b.case_index ? a.case_index < b.case_index : a.engine < b.engine;
+    });
+
+    printf("Compared %zu cases (%zu synthetic, %zu recorded, %zu trading days) against the reference engine v%llu: ",
+        total, options.cases, recorded.size(), compared_days.load(),
+        static_cast<unsigned long long>(REFERENCE_ENGINE_VERSION));
+    for (size_t i = 0; i < engines.size(); ++i) {
+        printf("%s%s", i ? ", " : "", engines[i]->name);
+    }
+    printf("\n");
+    if (mismatches.empty()) {
+        printf("All engines match the reference\n");
+        return 0;
+    }
+
+    std::map<string, size_t> per_engine;
+    for (const auto& mismatch : mismatches) {
+        per_engine[mismatch.engine->name]++;
+    }
+    for (const auto& [name, count] : per_engine) {
+        printf("%s: %zu mismatching cases\n", name.c_str(), count);
+    }
+    std::error_code error;
+    std::filesystem::create_directories(options.repro_dir, error);
+    for (size_t i = 0; i < std::min(options.max_shrink, mismatches.size()); ++i) {
+        const Mismatch& mismatch = mismatches[i];
+        DiffCase diff_case = mismatch.case_index < options.cases ? synthetic_case(options.seed, mismatch.case_index)
+            : recorded[mismatch.case_index - options.cases];
+        printf("\n%s on %s, days [%zu, %zu):\n", mismatch.engine->name, diff_case.source.c_str(),
+            diff_case.start, diff_case.end);
+        print_differences(mismatch.differences);
+
+        Repro repro = shrink(initial_repro(diff_case), *mismatch.engine, options.tolerance);
+        FundData fund_data(repro.timestamps, repro.prices);
+        printf("  shrunk to %zu trading days:\n", repro.prices.size());
+        print_differences(run_case(*mismatch.engine, fund_data, 0, repro.range_days, repro.parameters, options.tolerance));
+        print_repro(repro);
+        string path = options.repro_dir + "/case_" + std::to_string(mismatch.case_index) + "_" + mismatch.engine->name + ".txt";
+        if (write_repro(path, repro, mismatch.engine->name, diff_case.source)) {
+            printf("  repro written to %s (rerun with --replay %s --engine %s)\n", path.c_str(), path.c_str(),
+                mismatch.engine->name);
+        }
+    }
+    return 1;
+}
+
+// 编译命令：g++ -O2 -o funddiff funddiff.cpp ReferenceEngine.cpp FundData.cpp GridEngine.cpp ThreadPool.cpp Logger.cpp ReportWriter.cpp SeriesCodec.cpp ResultCache.cpp WorthTrend.cpp SyntheticSeries.cpp UniverseSnapshot.cpp Trace.cpp PerfCounters.cpp AllocTracker.cpp CppSQLite/DataBaseStorage.cpp CppSQLite/CppSQLite3.cpp -lsqlite3 -lpthread -std=c++20
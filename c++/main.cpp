@@ -1,49 +1,62 @@
 #include <iostream>
 #include <string>
 #include <map>
-#include <iomanip>
 #include <curl/curl.h>
-#include <nlohmann/json.hpp>
-#include <fstream>
-#include <future>
+#include <latch>
+#include <mutex>
+#include <atomic>
+#include <ctime>
 #include <thread>
 #include <algorithm>
+#include <filesystem>
+#include <sstream>
+#include <fstream>
+#include <optional>
+#include <csignal>
+#include <charconv>
+#include <cmath>
+#include <cstring>
 
 #include "GetConfig.hpp"
+#include "FundData.hpp"
+#include "GridEngine.hpp"
+#include "ThreadPool.hpp"
+#include "AllocTracker.hpp"
+#include "Trace.hpp"
+#include "PerfCounters.hpp"
+#include "Task.hpp"
+#include "HttpReactor.hpp"
+#include "HttpServer.hpp"
+#include "BacktestService.hpp"
+#include "ShardRunner.hpp"
+#include "Logger.hpp"
+#include "ReportWriter.hpp"
+#include "ColumnStore.hpp"
+#include "SeriesCodec.hpp"
+#include "SyntheticSeries.hpp"
+#include "ResultCache.hpp"
+#include "RunProgress.hpp"
+#include "UniverseSnapshot.hpp"
+#include "WorthTrend.hpp"
 #include "CppSQLite/DataBaseStorage.hpp"
+#include "CppSQLite/ResultWriter.hpp"
+#include "CppSQLite/ResultQuery.hpp"
 
-using json = nlohmann::json;
 using namespace std;
 
-static const double BASE = 1;
 static Config CONFIG;
-
-enum Period {
-    LAST_3_MONTHS = 0,
-    LAST_6_MONTHS,
-    LAST_1_YEAR,
-    LAST_3_YEARS,
-    LAST_5_YEARS,
-    SINCE_ESTABLISHED,
-    CUSTOMIZED_TIME
-};
-
-struct Thredhold {
-    double percentile_high;
-    double percentile_low;
-};
-
-struct TradeOperation {
-    long buy_timestamp = 0;
-    double buy_price = 0;
-
-    long sell_timestamp = 0;
-    double sell_price = 0;
-
-    bool money_not_enough = false; // 剩的钱是否够这次买入
-    bool big_grid_size = false; // 是否是大格子策略
-    bool dealed = false;
-};
+static int RUN_ID = 0; // TB_RUN 中本次运行的编号，写入 TB_FUND.operation_id 并用于关联 TB_OPERATION
+// 结果缓存所在的库：分片工作进程的 db_path 是各自的分片库，缓存仍从合并后的结果库读取
+static string RESULT_CACHE_DB_PATH;
+// --trace FILE：运行结束后写出的跟踪文件，以及需要并入的分片工作进程的跟踪文件
+static string TRACE_PATH;
+static vector<string> TRACE_MERGE_FILES;
+// --perf FILE：运行结束后写出的性能计数器文件，以及需要并入的分片工作进程的计数器文件
+static string PERF_PATH;
+static vector<string> PERF_MERGE_FILES;
+// --alloc FILE：运行结束后写出的分配统计文件，以及需要并入的分片工作进程的统计文件
+static string ALLOC_PATH;
+static vector<string> ALLOC_MERGE_FILES;
 
 // 写入回调函数
 size_t WriteCallback(void* contents, size_t size, size_t nmemb, string* output) {
@@ -52,7 +65,7 @@ size_t WriteCallback(void* contents, size_t size, size_t nmemb, string* output)
     return totalSize;
 }
 
-// 下载网页内容
+// 下载网页内容（同步版本）
 string fetch_url(const string& url, CURLcode& res) {
     CURL* curl;
     string response;
@@ -70,7 +83,7 @@ string fetch_url(const string& url, CURLcode& res) {
 
         res = curl_easy_perform(curl);
         if (res != CURLE_OK) {
-            cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << endl;
+            LOG_ERROR("curl_easy_perform() failed: %s (%s)", curl_easy_strerror(res), url.c_str());
         }
 
         curl_easy_cleanup(curl);
@@ -80,482 +93,944 @@ string fetch_url(const string& url, CURLcode& res) {
 
 map<long, double> generate_data(const string& fund_code) {
     string url = "http://fund.eastmoney.com/pingzhongdata/" + fund_code + ".js";
-    map<long, double> net_worth_dict;
     CURLcode res;
 
     string js_text = fetch_url(url, res);
     if (res != CURLE_OK) {
-        return net_worth_dict;
-    }
-    size_t start = js_text.find("var Data_netWorthTrend = ");
-    if (start != string::npos) {
-        start = js_text.find('[', start);
-        size_t end = js_text.find("];", start);
-        if (start != string::npos && end != string::npos) {
-            string json_str = js_text.substr(start, end - start + 1);
-            json j = json::parse(json_str);
-            for (const auto& item : j) {
-                long timestamp = long(item["x"]) / 1000;
-                double net_value = item["y"];
-                net_worth_dict[timestamp] = net_value;
-            }
-        } else {
-            cerr << "未找到完整的 JSON 数组" << endl;
-        }
+        return map<long, double>();
+    }
+    return parse_worth_trend(js_text, "Data_netWorthTrend", fund_code);
+}
+
+// 获取累计净值数据：下载时协程挂起在 I/O 反应器上，不占用线程，恢复后在计算线程池中解析
+Task<FundData> fetch_fund_data(HttpReactor& reactor, const string fund_code) {
+    string url = "http://fund.eastmoney.com/pingzhongdata/" + fund_code + ".js";
+    uint64_t trace_id = TRACE_ASYNC_BEGIN("download", "http", fund_code.c_str());
+    HttpResponse response = co_await reactor.fetch(url);
+    TRACE_ASYNC_END("download", "http", trace_id, fund_code.c_str());
+    if (response.code != CURLE_OK) {
+        LOG_ERROR("curl failed: %s (%s)", curl_easy_strerror(response.code), url.c_str());
+        co_return FundData();
+    }
+    TRACE_SCOPE("parse", "parse", fund_code.c_str());
+    AllocScope alloc_scope(AllocStage::LOAD, fund_code.c_str());
+    co_return FundData(parse_worth_trend(response.body, "Data_ACWorthTrend", fund_code));
+}
+
+// TB_PRICE 中保存的序列类型，与 fetch_fund_data 下载的一致
+static const char* const PRICE_SERIES = "ACWorthTrend";
+
+using PriceCache = map<string, std::shared_ptr<const FundData>>;
+
+// 本次运行中下载的序列，运行结束后统一写入 TB_PRICE
+struct DownloadedSeries {
+    std::mutex mutex;
+    vector<pair<string, std::shared_ptr<const FundData>>> series;
+};
+
+// 本次运行中各任务共享的输入和输出
+struct RunContext {
+    ResultWriter& results;
+    ReportWriter& reports;
+    const PriceCache& cached_prices;
+    DownloadedSeries& downloaded;
+    const ResultCache& cached_results;
+    RunProgress& progress;
+    std::atomic<size_t> cache_hits{0};
+};
+
+void generate_report(ReportWriter& reports, const string& fund_code, const string& period,
+    const GridOutcome& outcome, const ResultParameters& parameters, const RangeStats& stats)
+{
+    TRACE_SCOPE("report", "report", fund_code.c_str(), period.c_str());
+    AllocScope alloc_scope(AllocStage::REPORT, fund_code.c_str());
+    std::string file_name = "report/" + fund_code + "_" + period + "_report.txt";
+    // 格式化到线程复用的缓冲区，整份报告一次写出
+    ReportBuffer& report = ReportBuffer::thread_local_buffer();
+    format_report(report, outcome, parameters, stats);
+    reports.write(file_name, report);
+}
+
+// 本次运行的网格参数
+ResultParameters config_parameters() {
+    return {CONFIG.grid_size, CONFIG.big_grid_size, CONFIG.factor, CONFIG.sum, CONFIG.amount,
+        CONFIG.threshold_low, CONFIG.threshold_high};
+}
+
+void calculate_profit(
+    const std::string& fund_code, const std::string& period, const FundData& fund_data, RunContext& context)
+{
+    TRACE_SCOPE("period", "engine", fund_code.c_str(), period.c_str());
+    AllocScope alloc_scope(AllocStage::GRID, fund_code.c_str());
+    size_t start = get_start_date(fund_data, period);
+    size_t end = get_end_date(fund_data, period);
+    if (end <= start) {
+        LOG_WARN("Start date is after end date for fund code: %s and period: %s", fund_code.c_str(), period.c_str());
+        context.progress.add(RunProgress::PERIODS_EMPTY);
+        return;
+    }
+    const ResultParameters parameters = config_parameters();
+    long long cache_key = CONFIG.result_cache
+        ? result_cache_key(fund_code, period, fund_data, start, end, parameters, CONFIG.save_operations) : 0;
+    if (cache_key != 0 && context.cached_results.contains(cache_key)) {
+        LOG_DEBUG("%s: period %s unchanged since the cached result, skipped", fund_code.c_str(), period.c_str());
+        context.cache_hits.fetch_add(1, std::memory_order_relaxed);
+        context.progress.add(RunProgress::PERIODS_CACHED);
+        return;
+    }
+    LOG_INFO("%s: period %s start date: %s", fund_code.c_str(), period.c_str(),
+        format_day(day_index(fund_data.timestamp(start))));
+
+    GridOutcome outcome = run_grid(fund_code, fund_data, start, end, parameters);
+    auto stats = fund_data.range_stats(start, end);
+    LOG_INFO("%s: period %s Total money left: %.2f  Total profit: %.2f  Touched Lowest Balance: %.2f",
+        fund_code.c_str(), period.c_str(), outcome.balance, outcome.total_profit, outcome.touched_lowest_balance);
+    generate_report(context.reports, fund_code, period, outcome, parameters, stats);
+    AllocScope results_scope(AllocStage::RESULTS);
+    FundResult result;
+    result.fund_code = fund_code;
+    result.period = period;
+    result.total_value = outcome.total_value();
+    result.balance = outcome.balance;
+    result.holdings_value = outcome.holdings_value();
+    result.profit = outcome.total_profit;
+    result.percentile_70_price = outcome.thresholds.percentile_high;
+    result.percentile_30_price = outcome.thresholds.percentile_low;
+    result.operation_id = RUN_ID;
+    result.cache_key = cache_key;
+    result.parameters = parameters;
+    if (CONFIG.save_operations) {
+        result.operations = operation_records(outcome, parameters);
+    }
+    context.progress.add(RunProgress::PERIODS_COMPUTED);
+    context.progress.result(fund_code, period, result.profit, result.total_value);
+    context.results.add(std::move(result));
+}
+
+// 等待数据下载完成后，在计算线程池中为每个周期提交一个独立任务
+Task<void> run_grid_strategy(HttpReactor& reactor, ThreadPool& cpu_pool, RunContext& context, const string fund_code) {
+    // 整个基金从排队到最后一个周期算完，在时间线上单独成行，耗时最长的基金一眼可见
+    uint64_t trace_id = TRACE_ASYNC_BEGIN("fund", "fund", fund_code.c_str());
+    std::shared_ptr<const FundData> fund_data;
+    auto cached = context.cached_prices.find(fund_code);
+    if (cached != context.cached_prices.end()) {
+        fund_data = cached->second;
+        context.progress.add(RunProgress::SERIES_CACHED);
     } else {
-        cerr << "未找到 Data_netWorthTrend 变量" << endl;
+        fund_data = std::make_shared<const FundData>(co_await fetch_fund_data(reactor, fund_code));
+        if (fund_data->empty()) {
+            LOG_WARN("No data found for fund code: %s", fund_code.c_str());
+            context.progress.add(RunProgress::SERIES_FAILED);
+            context.progress.fund_finished(fund_code, ProgressEvent::FUND_NO_DATA);
+            TRACE_ASYNC_END("fund", "fund", trace_id, fund_code.c_str());
+            co_return;
+        }
+        context.progress.add(RunProgress::SERIES_DOWNLOADED);
+        std::lock_guard<std::mutex> lock(context.downloaded.mutex);
+        context.downloaded.series.emplace_back(fund_code, fund_data);
+    }
+
+    // 最后一个完成的周期任务报告这个基金完成
+    auto remaining = std::make_shared<std::atomic<size_t>>(CONFIG.periods.size());
+    for (const auto& period : CONFIG.periods) {
+        cpu_pool.post([fund_code, period, fund_data, remaining, trace_id, &context]() {
+            calculate_profit(fund_code, period, *fund_data, context);
+            if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                context.progress.add(RunProgress::FUNDS_DONE);
+                context.progress.fund_finished(fund_code, ProgressEvent::FUND_DONE);
+                TRACE_ASYNC_END("fund", "fund", trace_id, fund_code.c_str());
+            }
+        });
     }
-    return net_worth_dict;
 }
 
-// 异步版本的数据获取函数
-std::future<map<long, double>> generate_data_async(const string& fund_code) {
-    return std::async(std::launch::async, [fund_code]() -> map<long, double> {
-        string url = "http://fund.eastmoney.com/pingzhongdata/" + fund_code + ".js";
-        map<long, double> net_worth_dict;
-        CURLcode res;
 
-        string js_text = fetch_url(url, res);
-        if (res != CURLE_OK) {
-            return net_worth_dict;
-        }
-        
-        size_t start = js_text.find("var Data_ACWorthTrend = ");
-        if (start != string::npos) {
-            start = js_text.find('[', start);
-            size_t end = js_text.find("];", start);
-            if (start != string::npos && end != string::npos) {
-                string json_str = js_text.substr(start, end - start + 1);
-                try {
-                    json j = json::parse(json_str);
-                    for (const auto& item : j) {
-                        long timestamp = long(item[0]) / 1000;
-                        double net_value = item[1];
-                        net_worth_dict[timestamp] = net_value;
-                    }
-                } catch (const json::exception& e) {
-                    cerr << "JSON解析错误: " << e.what() << " for fund code: " << fund_code << endl;
+// 记录到 TB_RUN 的参数描述
+string describe_parameters() {
+    std::ostringstream parameters;
+    parameters << "grid_size=" << CONFIG.grid_size << " big_grid_size=" << CONFIG.big_grid_size
+        << " factor=" << CONFIG.factor << " sum=" << CONFIG.sum << " amount=" << CONFIG.amount
+        << " threshold_low=" << CONFIG.threshold_low << " threshold_high=" << CONFIG.threshold_high;
+    return parameters.str();
+}
+
+// 读取 price_cache_hours 小时内更新过的净值序列：先从快照映射，快照中没有的再从 TB_PRICE 解码
+PriceCache load_price_cache(const vector<string>& fund_codes) {
+    TRACE_SCOPE("load price cache", "storage");
+    AllocScope alloc_scope(AllocStage::STORAGE);
+    PriceCache cache;
+    if (CONFIG.price_cache_hours <= 0) {
+        return cache;
+    }
+    long since = time(nullptr) - CONFIG.price_cache_hours * 3600L;
+    if (!CONFIG.snapshot_path.empty()) {
+        if (auto snapshot = UniverseSnapshot::open(CONFIG.snapshot_path)) {
+            for (auto& series : snapshot->funds()) {
+                if (series.updated_at >= since) {
+                    cache.emplace(std::move(series.fund_code), std::move(series.data));
                 }
-            } else {
-                cerr << "未找到完整的 JSON 数组 for fund code: " << fund_code << endl;
             }
+            LOG_INFO("Mapped %zu price series from snapshot %s", cache.size(), CONFIG.snapshot_path.c_str());
+        }
+    }
+    if (std::all_of(fund_codes.begin(), fund_codes.end(), [&cache](const string& code) { return cache.count(code); })) {
+        return cache;
+    }
+    DatabaseStorage storage(CONFIG.price_db_path);
+    storage.forEachPriceSeries(PRICE_SERIES, since, [&cache](const char* code, long, const unsigned char* data, int size) {
+        if (cache.count(code)) {
+            return;
+        }
+        FundData fund_data;
+        if (decode_series(data, size, fund_data)) {
+            cache.emplace(code, std::make_shared<const FundData>(std::move(fund_data)));
         } else {
-            cerr << "未找到 Data_netWorthTrend 变量 for fund code: " << fund_code << endl;
+            LOG_WARN("Cached price series for %s is corrupt, downloading it again", code);
         }
-        return net_worth_dict;
     });
+    LOG_INFO("Loaded %zu cached price series", cache.size());
+    return cache;
 }
 
-// 批量异步获取数据
-std::vector<std::future<std::pair<std::string, map<long, double>>>> 
-batch_generate_data_async(const std::vector<std::string>& fund_codes, size_t batch_size = 10) {
-    std::vector<std::future<std::pair<std::string, map<long, double>>>> futures;
-    
-    for (size_t i = 0; i < fund_codes.size(); i += batch_size) {
-        size_t end = std::min(i + batch_size, fund_codes.size());
-        
-        for (size_t j = i; j < end; ++j) {
-            const auto& fund_code = fund_codes[j];
-            
-            auto future = std::async(std::launch::async, [fund_code]() -> std::pair<std::string, map<long, double>> {
-                string url = "http://fund.eastmoney.com/pingzhongdata/" + fund_code + ".js";
-                map<long, double> net_worth_dict;
-                CURLcode res;
-
-                string js_text = fetch_url(url, res);
-                if (res != CURLE_OK) {
-                    return {fund_code, net_worth_dict};
-                }
-                
-                size_t start = js_text.find("var Data_netWorthTrend = ");
-                if (start != string::npos) {
-                    start = js_text.find('[', start);
-                    size_t end = js_text.find("];", start);
-                    if (start != string::npos && end != string::npos) {
-                        string json_str = js_text.substr(start, end - start + 1);
-                        try {
-                            json j = json::parse(json_str);
-                            for (const auto& item : j) {
-                                long timestamp = long(item["x"]) / 1000;
-                                double net_value = item["y"];
-                                net_worth_dict[timestamp] = net_value;
-                            }
-                        } catch (const json::exception& e) {
-                            cerr << "JSON解析错误: " << e.what() << " for fund code: " << fund_code << endl;
-                        }
-                    }
-                }
-                return {fund_code, net_worth_dict};
-            });
-            
-            futures.push_back(std::move(future));
-        }
-        
-        // 在每个批次之间短暂休息，避免对服务器造成过大压力
-        if (i + batch_size < fund_codes.size()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+// 把下载的序列写入 TB_PRICE：已有序列是新序列的前缀时只追加新的交易日，否则整体重新编码
+void store_price_histories(const vector<pair<string, std::shared_ptr<const FundData>>>& series) {
+    if (series.empty()) {
+        return;
+    }
+    TRACE_SCOPE("store prices", "storage");
+    AllocScope alloc_scope(AllocStage::STORAGE);
+    DatabaseStorage storage(CONFIG.price_db_path);
+    size_t appended = 0;
+    storage.beginTransaction();
+    try {
+        for (const auto& [code, fund_data] : series) {
+            string blob;
+            if (storage.loadPriceSeries(code, PRICE_SERIES, blob) && append_series(blob, *fund_data)) {
+                appended++;
+            } else if (!encode_series(*fund_data, blob)) {
+                LOG_WARN("Cannot encode price series for %s", code.c_str());
+                continue;
+            }
+            int days = static_cast<int>(fund_data->size());
+            storage.savePriceSeries(code, PRICE_SERIES, blob, days, day_index(fund_data->timestamps().back()));
+            storage.setSeriesLength(code, days);
         }
+        storage.commitTransaction();
+    } catch (CppSQLite3Exception& e) {
+        LOG_ERROR("Failed to store price series: %s", e.errorMessage());
+        storage.rollbackTransaction();
+        return;
     }
-    
-    return futures;
+    LOG_INFO("Stored %zu price series (%zu appended to existing ones)", series.size(), appended);
 }
 
-void generate_report(
-    double balance, string fund_code,
-    double holdings, double latest_price, double profit,
-    const vector<TradeOperation>& operations,
-    const string& period, double touched_lowest_balance) 
-{
-    std::string file_name = "report/" + fund_code + "_" + period + "_report.txt";
-    std::ofstream report(file_name);
-    if (!report.is_open()) {
-        std::cerr << "无法打开报告文件: " << file_name << std::endl;
-        return;
+// 读取结果库中已有结果的键
+ResultCache load_result_cache() {
+    if (!CONFIG.result_cache) {
+        return ResultCache();
     }
-    report << std::fixed << std::setprecision(2);
-    report << "SUM: " << CONFIG.sum << "  Amount: " << CONFIG.amount << "  Grid Size: " << CONFIG.grid_size << endl;
-    report << "Holdings Value: " << holdings * latest_price << "(holds " << holdings << " at price " << latest_price << ")" << "  Balance: " << balance << " Total Value: " << holdings * latest_price + balance << endl;
-    report << "PS: If Total Value (Holdings Value + Balance) < SUM, that shows you lost money at this moment!!!" << endl;
-    report << "Profit: " << profit << "  Loss" << endl;
-    report << "Touched Lowest Balance: " << touched_lowest_balance << endl;
-
-    int dealed_count = 0, not_dealed_count = 0;
-    std::for_each(operations.begin(), operations.end(), [&](const TradeOperation& operation) {
-        if (operation.dealed) { dealed_count++; }
-        else if (!operation.money_not_enough) { not_dealed_count++; }
-    });
-    report << endl << "dealed trade: " << dealed_count << "  not dealed trade: " << not_dealed_count << endl;
-    report << "================================== trade operations ==================================" << endl;
+    ResultCache cache(DatabaseStorage(RESULT_CACHE_DB_PATH).resultCacheKeys());
+    LOG_INFO("Loaded %zu cached result keys", cache.size());
+    return cache;
+}
 
-    for (const auto& operation : operations) {
-        if (operation.money_not_enough) {
-            report << "Not enough money to buy" << endl;
+// 把 TB_PRICE 中的全部序列写成快照
+bool build_snapshot(const string& path) {
+    vector<SnapshotSeries> series;
+    DatabaseStorage storage(CONFIG.price_db_path);
+    storage.forEachPriceSeries(PRICE_SERIES, 0, [&series](const char* code, long updated_at, const unsigned char* data, int size) {
+        FundData fund_data;
+        if (decode_series(data, size, fund_data)) {
+            series.push_back({code, updated_at, std::make_shared<const FundData>(std::move(fund_data))});
+        } else {
+            LOG_WARN("Price series for %s is corrupt, not included in the snapshot", code);
         }
-        report << "Buy Time: " << put_time(std::localtime(&operation.buy_timestamp), "%Y-%m-%d") << ",    Price: " << operation.buy_price << endl;
+    });
+    return write_snapshot(path, series);
+}
+
+// TB_PRICE 中有比快照更新的序列时重建快照
+void refresh_snapshot() {
+    if (CONFIG.snapshot_path.empty()) {
+        return;
+    }
+    auto snapshot = UniverseSnapshot::open(CONFIG.snapshot_path);
+    long last_update = DatabaseStorage(CONFIG.price_db_path).lastPriceUpdate(PRICE_SERIES);
+    if (!snapshot || snapshot->last_update() < last_update) {
+        build_snapshot(CONFIG.snapshot_path);
+    }
+}
 
-        if (operation.dealed) {
-            report << "Sell Time: " << put_time(std::localtime(&operation.sell_timestamp), "%Y-%m-%d") << ",    Price: " << operation.sell_price << endl;
+// 回测服务启动时常驻内存的序列：快照中的全部序列，加上 TB_PRICE 中快照没有或比快照新的序列
+vector<SnapshotSeries> load_resident_series() {
+    map<string, SnapshotSeries> resident;
+    if (!CONFIG.snapshot_path.empty()) {
+        if (auto snapshot = UniverseSnapshot::open(CONFIG.snapshot_path)) {
+            for (auto& series : snapshot->funds()) {
+                resident[series.fund_code] = std::move(series);
+            }
         }
-        else {
-            report << "Sell Time: " << operation.sell_timestamp << ",    Price: " << operation.sell_price << endl;
+    }
+    DatabaseStorage storage(CONFIG.price_db_path);
+    storage.forEachPriceSeries(PRICE_SERIES, 0, [&resident](const char* code, long updated_at, const unsigned char* data, int size) {
+        auto found = resident.find(code);
+        if (found != resident.end() && found->second.updated_at >= updated_at) {
+            return;
         }
-        if (operation.big_grid_size) {
-            report << "Big Grid Size Operation" << endl;
+        FundData fund_data;
+        if (decode_series(data, size, fund_data)) {
+            resident[code] = {code, updated_at, std::make_shared<const FundData>(std::move(fund_data))};
         }
-        report << "----------------------------------------------------------" << endl;
+    });
+    vector<SnapshotSeries> series;
+    for (auto& [code, item] : resident) {
+        series.push_back(std::move(item));
     }
-    report.close();
+    LOG_INFO("%zu price series resident in memory", series.size());
+    return series;
 }
 
-std::map<long, double>::const_iterator get_start_date(const map<long, double>& net_worth_data, const std::string& period) {
-    auto latest_it = --net_worth_data.end();
-    long latest_timestamp = latest_it->first;
-    long last_timestamp = 0;
-
-    switch (static_cast<Period>(std::stoi(period))) {
-        case LAST_3_MONTHS:
-            last_timestamp = latest_timestamp - 90 * 24 * 3600;
-            break;
-        case LAST_6_MONTHS:
-            last_timestamp = latest_timestamp - 180 * 24 * 3600;
-            break;
-        case LAST_1_YEAR:
-            last_timestamp = latest_timestamp - 365 * 24 * 3600;
-            break;
-        case LAST_3_YEARS:
-            last_timestamp = latest_timestamp - 3 * 365 * 24 * 3600;
-            break;
-        case LAST_5_YEARS:
-            last_timestamp = latest_timestamp - 5 * 365 * 24 * 3600;
-            break;
-        case SINCE_ESTABLISHED:
-            return net_worth_data.begin();
-        case CUSTOMIZED_TIME:
-            last_timestamp = latest_timestamp - 5 * 365 * 24 * 3600;
-            break;
-        default:
-            return net_worth_data.begin();
-    }
-    auto it = net_worth_data.lower_bound(last_timestamp);
-    return it;
+// 回测服务下载的序列同样写入 TB_PRICE，供之后的批量运行使用
+Task<void> download_series(HttpReactor& reactor, std::mutex& store_mutex, const string fund_code,
+    std::function<void(std::shared_ptr<const FundData>)> done) {
+    auto fund_data = std::make_shared<const FundData>(co_await fetch_fund_data(reactor, fund_code));
+    done(fund_data);
+    if (!fund_data->empty()) {
+        std::lock_guard<std::mutex> lock(store_mutex);
+        store_price_histories({{fund_code, fund_data}});
+    }
 }
 
-std::map<long, double>::const_iterator get_end_date(const map<long, double>& net_worth_data, const std::string& period) {
-    auto latest_it = --net_worth_data.end();
-    long latest_timestamp = latest_it->first;
-    long last_timestamp = latest_timestamp;
-
-    switch (static_cast<Period>(std::stoi(period))) {
-        case LAST_3_MONTHS:
-        case LAST_6_MONTHS:
-        case LAST_1_YEAR:
-        case LAST_3_YEARS:
-        case LAST_5_YEARS:
-        case SINCE_ESTABLISHED:
-            return net_worth_data.end();
-        case CUSTOMIZED_TIME:
-            last_timestamp = 1726761600; // 2024-09-20 00:00:00 黎明前
-            break;
-        default:
-            return net_worth_data.end();
-    }
-    auto it = net_worth_data.lower_bound(last_timestamp);
-    return it;
+static HttpServer* ACTIVE_SERVER = nullptr;
+
+void stop_server(int) {
+    if (ACTIVE_SERVER) {
+        ACTIVE_SERVER->stop();
+    }
 }
 
-Thredhold calculate_thresholds(std::map<long, double>::const_iterator start_it, std::map<long, double>::const_iterator end_it)
-{
-    vector<double> values;
-    for (auto it = start_it; it != end_it; ++it) {
-        values.push_back(it->second);
-    }
-    sort(values.begin(), values.end());
-
-    size_t n = values.size();
-    Thredhold thresholds;
-    if (n > 0) {
-        size_t high_index = std::min(static_cast<size_t>(n * CONFIG.threshold_high), n - 1);
-        size_t low_index = std::min(static_cast<size_t>(n * CONFIG.threshold_low), n - 1);
-        
-        thresholds.percentile_high = values[high_index];
-        thresholds.percentile_low = values[low_index];
-    }
-    return thresholds;
+// fund serve：常驻的回测服务，直到 SIGINT/SIGTERM
+int run_server(int port) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    const long MAX_CONCURRENT_DOWNLOADS = 10;
+    ThreadPool cpu_pool(std::thread::hardware_concurrency());
+    std::optional<HttpReactor> reactor;
+    reactor.emplace(cpu_pool, MAX_CONCURRENT_DOWNLOADS);
+    std::mutex store_mutex;
+
+    BacktestService::Options options;
+    options.defaults = config_parameters();
+    options.default_period = CONFIG.periods.empty() ? std::to_string(SINCE_ESTABLISHED) : CONFIG.periods.front();
+    options.cache_entries = static_cast<size_t>(std::max(CONFIG.server_cache_entries, 0));
+    options.refresh_seconds = CONFIG.server_refresh_minutes * 60L;
+    auto loader = [&reactor, &store_mutex](const string& code, std::function<void(std::shared_ptr<const FundData>)> done) {
+        spawn(download_series(*reactor, store_mutex, code, std::move(done)), [code](std::exception_ptr error) {
+            if (error) {
+                try {
+                    std::rethrow_exception(error);
+                } catch (const std::exception& e) {
+                    LOG_ERROR("Download of %s failed: %s", code.c_str(), e.what());
+                }
+            }
+        });
+    };
+    BacktestService service(cpu_pool, loader, options);
+    service.preload(load_resident_series());
+
+    int exit_code = 0;
+    try {
+        HttpServer server(CONFIG.server_address, port, [&service](const HttpRequest& request, HttpServer::Responder respond) {
+            service.handle(request, std::move(respond));
+        });
+        ACTIVE_SERVER = &server;
+        std::signal(SIGINT, stop_server);
+        std::signal(SIGTERM, stop_server);
+        LOG_INFO("Backtest server listening on %s:%d", CONFIG.server_address.c_str(), server.port());
+        server.run();
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        ACTIVE_SERVER = nullptr;
+    } catch (const std::runtime_error& e) {
+        LOG_ERROR("%s", e.what());
+        exit_code = 1;
+    }
+    // 先停下载，让在途的下载和计算在服务析构前结束
+    reactor.reset();
+    cpu_pool.wait_idle();
+    curl_global_cleanup();
+    LOG_INFO("Backtest server stopped");
+    return exit_code;
 }
 
-void calculate_profit(
-    const std::string& fund_code, const std::string& period, const map<long, double>& net_worth_data)
-{
-    auto start_date_it = get_start_date(net_worth_data, period);
-    cout << "Start date: " << put_time(std::localtime(&start_date_it->first), "%Y-%m-%d") << endl;
-    auto end_date_it = get_end_date(net_worth_data, period);
-    if (std::distance(start_date_it, end_date_it) <= 0) {
-        cerr << "Start date is after end date for fund code: " << fund_code << " and period: " << period << endl;
-        return;
+// 跟踪或统计分配时包装结果落地方式：写线程中每个事务是时间线上的一段，其中的分配记在结果阶段上
+class InstrumentedSink : public ResultSink {
+public:
+    explicit InstrumentedSink(std::unique_ptr<ResultSink> sink) : sink_(std::move(sink)) {}
+
+    void insert(const FundResult& result) override {
+        AllocScope alloc_scope(AllocStage::RESULTS);
+        sink_->insert(result);
+    }
+    void beginTransaction() override {
+        TRACE_THREAD_NAME("result writer");
+        TRACE_BEGIN("commit results", "storage");
+        AllocScope alloc_scope(AllocStage::RESULTS);
+        sink_->beginTransaction();
+    }
+    void commitTransaction() override {
+        AllocScope alloc_scope(AllocStage::RESULTS);
+        sink_->commitTransaction();
+        TRACE_END();
+    }
+    void rollbackTransaction() override {
+        sink_->rollbackTransaction();
+        TRACE_END();
+    }
+
+private:
+    std::unique_ptr<ResultSink> sink_;
+};
+
+// 按配置打开结果落地方式
+std::unique_ptr<ResultSink> open_result_sink() {
+    std::unique_ptr<ResultSink> sink;
+    if (CONFIG.result_sink == "columnar") {
+        sink = std::make_unique<ColumnarSink>(CONFIG.columnar_path, CONFIG.columnar_chunk_rows, CONFIG.columnar_compress);
+    } else {
+        sink = std::make_unique<DatabaseStorage>(CONFIG.db_path);
+    }
+    if (Tracer::enabled() || AllocTracker::tracking()) {
+        sink = std::make_unique<InstrumentedSink>(std::move(sink));
+    }
+    return sink;
+}
+
+// 在本进程内处理一组基金；run_id 为 0 时新建一次运行
+int run_batch(const vector<string>& fund_codes, int run_id = 0) {
+    RUN_ID = DatabaseStorage(CONFIG.db_path).beginRun(describe_parameters(), run_id);
+    LOG_INFO("Starting batch processing for %zu fund codes (run %d)...", fund_codes.size(), RUN_ID);
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    // 计算任务使用与核数相同的工作线程；所有下载由一个反应器线程驱动，
+    // 同时在途的连接数由 curl 限制，其余请求排队而不占用线程
+    const long MAX_CONCURRENT_DOWNLOADS = 10;
+    ResultWriter results(open_result_sink(), CONFIG.db_batch_rows, std::chrono::milliseconds(CONFIG.db_flush_ms));
+    ReportWriter reports(CONFIG.async_reports);
+    PriceCache cached_prices = load_price_cache(fund_codes);
+    DownloadedSeries downloaded;
+    ResultCache cached_results = load_result_cache();
+    RunProgress progress(fund_codes.size(), {CONFIG.progress_socket, CONFIG.progress_port,
+        CONFIG.progress_interval_ms, static_cast<size_t>(std::max(CONFIG.progress_top, 0))});
+    RunContext context{results, reports, cached_prices, downloaded, cached_results, progress};
+    ThreadPool cpu_pool(std::thread::hardware_concurrency());
+    HttpReactor reactor(cpu_pool, MAX_CONCURRENT_DOWNLOADS);
+    std::latch remaining(static_cast<std::ptrdiff_t>(fund_codes.size()));
+
+    for (size_t i = 0; i < fund_codes.size(); ++i) {
+        const auto& code = fund_codes[i];
+        LOG_INFO("Queuing fund code: %s (%zu/%zu)", code.c_str(), i + 1, fund_codes.size());
+        progress.add(RunProgress::FUNDS_QUEUED);
+        spawn(run_grid_strategy(reactor, cpu_pool, context, code), [&remaining, &progress, code](std::exception_ptr error) {
+            if (error) {
+                try {
+                    std::rethrow_exception(error);
+                } catch (const std::exception& e) {
+                    LOG_ERROR("Fund %s failed: %s", code.c_str(), e.what());
+                }
+                progress.fund_finished(code, ProgressEvent::FUND_FAILED);
+            }
+            remaining.count_down();
+        });
     }
 
-    auto thresholds = calculate_thresholds(start_date_it, end_date_it);
-    double current_balance = CONFIG.sum;
-    double touched_lowest_balance = current_balance;
-    double current_holdings = 0;
-    double total_profit = 0;
-    double current_base_price = start_date_it->second;
-    double current_big_base_price = start_date_it->second;
-    vector<TradeOperation> operations;
-    for_each(start_date_it, end_date_it, [&](const auto& item) {
-        long timestamp = item.first;
-        double price = item.second;
-        // cout << "Timestamp: " << timestamp << ", Price: " << price << ", base: " << current_base_price << ", big_base: " << current_big_base_price << endl;
-        if (current_base_price * (BASE - CONFIG.grid_size) >= price and price < thresholds.percentile_high and price >= thresholds.percentile_low) {
-            TradeOperation operation;
-            if (current_balance < CONFIG.amount) {
-                operation.money_not_enough = true;
-                operation.buy_timestamp = timestamp;
-                operation.buy_price = price;
-                operations.push_back(operation);
-                cout << fund_code << ": Not enough money for this operation." << endl;
+    // 所有周期任务都在对应协程结束前提交，因此先等协程再等线程池即可
+    remaining.wait();
+    cpu_pool.wait_idle();
+    {
+        TRACE_SCOPE("flush results", "storage");
+        results.flush();
+    }
+    progress.finish();
+    store_price_histories(downloaded.series);
+    curl_global_cleanup();
+    if (context.cache_hits > 0) {
+        LOG_INFO("Skipped %zu results that were already in the result cache", context.cache_hits.load());
+    }
+
+    LOG_INFO("All fund codes processed successfully!");
+    return 0;
+}
+
+// 整个参数都是合法的数值时才接受；命令行中的数值都经过这里，出错时打印用法而不是抛出异常
+template <typename T>
+bool parse_number(const char* text, T& value) {
+    const char* end = text + strlen(text);
+    auto [ptr, error] = std::from_chars(text, end, value);
+    return error == std::errc() && ptr == end && ptr != text;
+}
+
+struct CommandLine {
+    size_t workers = 0;       // --workers N：本机启动 N 个工作进程并合并结果
+    size_t plan_shards = 0;   // --plan-only N：只生成分片计划文件，用于多机运行
+    long shard_index = -1;    // --shard i/N：只处理第 i 个分片
+    size_t shard_count = 0;
+    string plan_path;         // --plan FILE：分片计划文件
+    int run_id = 0;           // --run ID：没有计划文件时各节点共用的 run_id
+    string shard_dir = "shards";
+    string db_path;           // --db PATH：覆盖配置中的结果数据库
+    vector<string> merge_files; // --merge A.db B.col ...
+    string trace_path;        // --trace FILE：写出 Chrome / Perfetto 的跟踪文件
+    string perf_path;         // --perf FILE：写出各基金、各阶段的性能计数器
+    string alloc_path;        // --alloc FILE：写出各阶段、各基金的分配统计
+};
+
+void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [--db PATH] [--trace FILE] [--perf FILE] [--alloc FILE]\n"
+        "          --trace writes a Chrome/Perfetto timeline of the run, --perf per-fund and per-stage\n"
+        "          cycles, instructions, branch and LLC misses (perf_event_open, where the machine allows),\n"
+        "          --alloc per-stage and per-fund allocation counts, bytes and peak live bytes\n"
+        "       %s --workers N [--shard-dir DIR]      run N local worker processes and merge their results\n"
+        "       %s --plan-only N [--shard-dir DIR]    write DIR/plan.txt for running shards on several machines\n"
+        "       %s --shard i/N [--plan FILE | --run ID] [--db PATH]\n"
+        "          without --plan every node splits fund_codes evenly by position, and all nodes must pass the same --run ID\n"
+        "       %s --merge SHARD.db|SHARD.col...      merge worker databases into db_path, columnar files into columnar_path\n"
+        "       %s query top|list|funds|out-of-money [OPTIONS]   query results in db_path (see %s query --help)\n"
+        "       %s snapshot [PATH]                    write TB_PRICE to a memory-mapped snapshot (default snapshot_path)\n"
+        "       %s serve [--port N]                   serve backtests over HTTP/JSON with the price series kept in memory\n"
+        "       %s generate PATH [OPTIONS]            generate a synthetic universe (see %s generate --help)\n",
+        program, program, program, program, program, program, program, program, program, program, program);
+}
+
+bool parse_command_line(int argc, char* argv[], CommandLine& args) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--workers" && has_value) {
+            if (!parse_number(argv[++i], args.workers)) {
+                return false;
             }
-            else {
-                current_balance -= CONFIG.amount;
-                touched_lowest_balance = std::min(touched_lowest_balance, current_balance);
-                current_holdings += CONFIG.amount / price;
-                current_base_price = price;
-                operation.buy_timestamp = timestamp;
-                operation.buy_price = price;
-                operations.push_back(operation);
+        } else if (arg == "--plan-only" && has_value) {
+            if (!parse_number(argv[++i], args.plan_shards)) {
+                return false;
             }
-        }
-        else if (current_big_base_price * (BASE - CONFIG.grid_size) >= price and price < thresholds.percentile_low) {
-            TradeOperation operation;
-            if (current_balance < CONFIG.amount * CONFIG.factor) {
-                operation.money_not_enough = true;
-                operation.buy_timestamp = timestamp;
-                operation.buy_price = price;
-                operation.big_grid_size = true;
-                operations.push_back(operation);
-                cout << fund_code << ": Not enough money for this operation." << endl;
+        } else if (arg == "--run" && has_value) {
+            if (!parse_number(argv[++i], args.run_id) || args.run_id <= 0) {
+                return false;
             }
-            else {
-                current_balance -= CONFIG.amount * CONFIG.factor;
-                touched_lowest_balance = std::min(touched_lowest_balance, current_balance);
-                current_holdings += CONFIG.amount * CONFIG.factor / price;
-                current_big_base_price = price;
-                operation.buy_timestamp = timestamp;
-                operation.buy_price = price;
-                operation.big_grid_size = true;
-                operations.push_back(operation);
+        } else if (arg == "--shard" && has_value) {
+            if (sscanf(argv[++i], "%ld/%zu", &args.shard_index, &args.shard_count) != 2
+                || args.shard_index < 0 || static_cast<size_t>(args.shard_index) >= args.shard_count) {
+                return false;
             }
-        }
-        else if (current_base_price * (BASE + CONFIG.grid_size) <= price) {
-            current_base_price = price; // 更新基准价格
-            for (auto& operation : operations) {
-                if (operation.money_not_enough || operation.dealed || operation.big_grid_size || operation.buy_price * (BASE + CONFIG.grid_size) > price) {
-                    continue;
-                }
-                operation.sell_timestamp = timestamp;
-                operation.sell_price = price;
-                double profit = (CONFIG.amount / operation.buy_price) * operation.sell_price - CONFIG.amount;
-                total_profit += profit;
-                current_balance += (CONFIG.amount / operation.buy_price) * operation.sell_price;
-                current_holdings -= CONFIG.amount / operation.buy_price;
-                operation.dealed = true;
+        } else if (arg == "--plan" && has_value) {
+            args.plan_path = argv[++i];
+        } else if (arg == "--shard-dir" && has_value) {
+            args.shard_dir = argv[++i];
+        } else if (arg == "--db" && has_value) {
+            args.db_path = argv[++i];
+        } else if (arg == "--trace" && has_value) {
+            args.trace_path = argv[++i];
+        } else if (arg == "--perf" && has_value) {
+            args.perf_path = argv[++i];
+        } else if (arg == "--alloc" && has_value) {
+            args.alloc_path = argv[++i];
+        } else if (arg == "--merge") {
+            while (i + 1 < argc) {
+                args.merge_files.push_back(argv[++i]);
             }
+        } else {
+            return false;
         }
-        else if (current_big_base_price * (BASE + CONFIG.big_grid_size) <= price) {
-            current_big_base_price = price; // 更新基准价格
-            for (auto& operation : operations) {
-                if (operation.money_not_enough || operation.dealed || !operation.big_grid_size || operation.buy_price * (BASE + CONFIG.big_grid_size) > price) {
-                    continue;
-                }
-                operation.sell_timestamp = timestamp;
-                operation.sell_price = price;
-                double profit = (CONFIG.amount * CONFIG.factor / operation.buy_price) * operation.sell_price - CONFIG.amount * CONFIG.factor;
-                total_profit += profit;
-                current_balance += (CONFIG.amount * CONFIG.factor / operation.buy_price) * operation.sell_price;
-                current_holdings -= CONFIG.amount * CONFIG.factor / operation.buy_price;
-                operation.dealed = true;
-            }
+    }
+    return true;
+}
+
+// 工作进程的列式结果与其结果库同名，扩展名为 .col
+string shard_columnar_path(const string& db_path) {
+    return std::filesystem::path(db_path).replace_extension(".col").string();
+}
+
+bool merge_shards(const vector<string>& shard_files) {
+    DatabaseStorage db_storage(CONFIG.db_path);
+    bool ok = true;
+    for (const auto& file : shard_files) {
+        if (std::filesystem::path(file).extension() == ".col") {
+            LOG_INFO("Merging %s into %s", file.c_str(), CONFIG.columnar_path.c_str());
+            ok = append_column_file(CONFIG.columnar_path, file) && ok;
+            continue;
         }
-    });
-    double latest_price = end_date_it->second;
-    cout << fund_code << ": Total money left: " << current_balance << endl;
-    cout << fund_code << ": Total profit: " << total_profit << endl;
-    cout << fund_code << ": Touched Lowest Balance: " << touched_lowest_balance << endl;
-    generate_report(current_balance, fund_code,
-        current_holdings, latest_price, total_profit, operations, period, touched_lowest_balance
-    );
-    DatabaseStorage db_storage;
-    db_storage.add(fund_code, period, current_holdings * latest_price + current_balance,
-        current_balance, current_holdings * latest_price, total_profit, 0,
-        thresholds.percentile_high, thresholds.percentile_low, 0);
+        LOG_INFO("Merging %s into %s", file.c_str(), CONFIG.db_path.c_str());
+        ok = db_storage.merge(file) && ok;
+    }
+    return ok;
 }
 
-void run_grid_strategy(const string fund_code) {
-    // 使用异步版本获取数据
-    auto data_future = generate_data_async(fund_code);
-    
-    // 这里可以做其他工作，比如处理配置验证等
-    if (CONFIG.periods.empty()) {
-        cerr << "No periods specified in the configuration." << endl;
-        return;
+void print_query_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s query top [N] [--by profit|total_value] [--asc] [FILTERS]   rank results (default top 20 by profit)\n"
+        "       %s query list [--limit N] [FILTERS]                         results ordered by fund and period\n"
+        "       %s query funds [FILTERS]                                    per-fund count and profit statistics\n"
+        "       %s query out-of-money [FILTERS]                             funds that could not afford a grid\n"
+        "FILTERS: --fund CODE --period P --run RUN_ID --min-profit X --max-profit X --db PATH\n",
+        program, program, program, program);
+}
+
+// fund query 子命令：结果逐行以制表符分隔输出，第一行是列名
+int run_query_command(const char* program, int argc, char* argv[]) {
+    if (argc < 1) {
+        print_query_usage(program);
+        return 2;
     }
-    
-    // 等待网络请求完成
-    const auto& net_worth_data = data_future.get();
-    if (net_worth_data.empty()) {
-        cerr << "No data found for fund code: " << fund_code << endl;
-        return;
+    string kind = argv[0];
+    ResultFilter filter;
+    string order_column = "profit";
+    bool ascending = false;
+    int limit = kind == "top" ? 20 : 0;
+    int i = 1;
+    if (kind == "top" && i < argc && isdigit(static_cast<unsigned char>(argv[i][0]))) {
+        if (!parse_number(argv[i++], limit)) {
+            print_query_usage(program);
+            return 2;
+        }
+    }
+    for (; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--fund" && has_value) {
+            filter.fund_code = argv[++i];
+        } else if (arg == "--period" && has_value) {
+            filter.period = argv[++i];
+        } else if (arg == "--run" && has_value) {
+            if (!parse_number(argv[++i], filter.run_id) || filter.run_id <= 0) {
+                print_query_usage(program);
+                return 2;
+            }
+        } else if (arg == "--min-profit" && has_value) {
+            filter.hasMinProfit = true;
+            if (!parse_number(argv[++i], filter.minProfit)) {
+                print_query_usage(program);
+                return 2;
+            }
+        } else if (arg == "--max-profit" && has_value) {
+            filter.hasMaxProfit = true;
+            if (!parse_number(argv[++i], filter.maxProfit)) {
+                print_query_usage(program);
+                return 2;
+            }
+        } else if (arg == "--by" && has_value && kind == "top") {
+            order_column = argv[++i];
+            if (order_column != "profit" && order_column != "total_value") {
+                print_query_usage(program);
+                return 2;
+            }
+        } else if (arg == "--asc" && kind == "top") {
+            ascending = true;
+        } else if (arg == "--limit" && has_value) {
+            if (!parse_number(argv[++i], limit)) {
+                print_query_usage(program);
+                return 2;
+            }
+        } else if (arg == "--db" && has_value) {
+            CONFIG.db_path = argv[++i];
+        } else {
+            print_query_usage(program);
+            return 2;
+        }
+    }
+    if (limit < 0) {
+        print_query_usage(program);
+        return 2;
     }
 
-    for (const auto& period : CONFIG.periods) {
-
-        calculate_profit(fund_code, period, net_worth_data);
-        std::cout << std::endl;
+    bool header_printed = false;
+    auto print_row = [&header_printed](CppSQLite3Query& row) {
+        if (!header_printed) {
+            for (int field = 0; field < row.numFields(); ++field) {
+                printf("%s%s", field ? "\t" : "", row.fieldName(field));
+            }
+            printf("\n");
+            header_printed = true;
+        }
+        for (int field = 0; field < row.numFields(); ++field) {
+            printf("%s%s", field ? "\t" : "", row.getStringField(field));
+        }
+        printf("\n");
+    };
+    try {
+        ResultQuery query(CONFIG.db_path);
+        if (kind == "top") {
+            query.top(filter, order_column, ascending, limit, print_row);
+        } else if (kind == "list") {
+            query.list(filter, limit, print_row);
+        } else if (kind == "funds") {
+            query.perFund(filter, print_row);
+        } else if (kind == "out-of-money") {
+            query.outOfMoney(filter, print_row);
+        } else {
+            print_query_usage(program);
+            return 2;
+        }
+    } catch (CppSQLite3Exception& e) {
+        LOG_ERROR("Query failed: %s", e.errorMessage());
+        return 1;
     }
+    fflush(stdout);
+    return 0;
 }
 
-// 异步版本的网格策略执行函数
-std::future<void> run_grid_strategy_async(const string fund_code) {
-    return std::async(std::launch::async, [fund_code]() {
-        run_grid_strategy(fund_code);
-    });
+void print_generate_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s generate PATH [--funds N] [--years Y] [--min-years Y] [--model gbm|regime|jump] [--seed S]\n"
+        "                        [--drift D] [--volatility V] [--js]\n"
+        "  writes a memory-mapped snapshot to PATH (use it as snapshot_path), or with --js one pingzhongdata\n"
+        "  script per fund into the directory PATH; the fund codes are written to PATH.codes in config format.\n"
+        "  Fund lengths are uniform in [min-years, years] (default 5 and 5), drift and volatility are annual\n",
+        program);
 }
 
+// 合成序列的最大年数（约 25 万个交易日）
+const double MAX_SYNTHETIC_YEARS = 1000;
 
-int main() {
-    GetConfig get_config("config.txt");
-    CONFIG = get_config.Get();
+// fund generate 子命令：合成净值序列，用于超出真实规模的性能测试
+int run_generate_command(const char* program, int argc, char* argv[]) {
+    if (argc < 1 || argv[0][0] == '-') {
+        print_generate_usage(program);
+        return 2;
+    }
+    string path = argv[0];
+    SyntheticSpec spec;
+    SyntheticUniverse universe;
+    double years = 5, min_years = -1;
+    bool scripts = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        bool parsed = true;
+        if (arg == "--funds" && has_value) {
+            parsed = parse_number(argv[++i], universe.funds);
+        } else if (arg == "--years" && has_value) {
+            parsed = parse_number(argv[++i], years);
+        } else if (arg == "--min-years" && has_value) {
+            parsed = parse_number(argv[++i], min_years) && min_years >= 0;
+        } else if (arg == "--model" && has_value) {
+            parsed = parse_synthetic_model(argv[++i], spec.model);
+        } else if (arg == "--seed" && has_value) {
+            parsed = parse_number(argv[++i], universe.seed);
+        } else if (arg == "--drift" && has_value) {
+            parsed = parse_number(argv[++i], spec.drift) && std::isfinite(spec.drift);
+        } else if (arg == "--volatility" && has_value) {
+            parsed = parse_number(argv[++i], spec.volatility) && std::isfinite(spec.volatility) && spec.volatility >= 0;
+        } else if (arg == "--js") {
+            scripts = true;
+        } else {
+            parsed = false;
+        }
+        if (!parsed) {
+            print_generate_usage(program);
+            return 2;
+        }
+    }
+    // 年数换算为交易日数，超过上限时换算会溢出或生成不可用的巨大文件
+    if (universe.funds == 0 || universe.funds > 1000000 || !(years > 0 && years <= MAX_SYNTHETIC_YEARS)
+        || min_years > MAX_SYNTHETIC_YEARS) {
+        print_generate_usage(program);
+        return 2;
+    }
+    universe.max_days = std::max<size_t>(static_cast<size_t>(years * TRADING_DAYS_PER_YEAR), 1);
+    universe.min_days = min_years < 0 ? universe.max_days
+        : std::min(std::max<size_t>(static_cast<size_t>(min_years * TRADING_DAYS_PER_YEAR), 1), universe.max_days);
 
-    std::cout << "Starting batch processing for " << CONFIG.fund_codes.size() << " fund codes..." << std::endl;
-    
-    // 方法1: 使用限制并发数的方式
-    const size_t hardware_threads = std::thread::hardware_concurrency();
-    const size_t MAX_CONCURRENT_THREADS = std::min(static_cast<size_t>(10), hardware_threads > 0 ? hardware_threads * 2 : 4);
-    std::vector<std::future<void>> futures;
-    
-    for (size_t i = 0; i < CONFIG.fund_codes.size(); ++i) {
-        const auto& code = CONFIG.fund_codes[i];
-        std::cout << "Queuing fund code: " << code << " (" << (i+1) << "/" << CONFIG.fund_codes.size() << ")" << std::endl;
-        
-        // 如果达到最大并发数，等待一些任务完成
-        if (futures.size() >= MAX_CONCURRENT_THREADS) {
-            // 等待第一个任务完成
-            futures.front().get();
-            futures.erase(futures.begin());
-        }
-        
-        // 启动新的异步任务
-        futures.push_back(run_grid_strategy_async(code));
-    }
-    
-    // 等待所有剩余任务完成
-    std::cout << "Waiting for remaining " << futures.size() << " tasks to complete..." << std::endl;
-    for (auto& future : futures) {
-        future.get();
-    }
-    
-    std::cout << "All fund codes processed successfully!" << std::endl;
+    ThreadPool pool(std::thread::hardware_concurrency());
+    bool ok = scripts ? write_synthetic_scripts(path, spec, universe, pool)
+        : write_synthetic_snapshot(path, spec, universe, pool);
+    if (!ok) {
+        return 1;
+    }
+    std::ofstream codes(path + ".codes");
+    codes << "fund_codes = [";
+    for (size_t i = 0; i < universe.funds; ++i) {
+        codes << (i ? "," : "") << synthetic_fund_code(i);
+    }
+    codes << "]\n";
+    if (!codes) {
+        LOG_ERROR("Cannot write %s.codes", path.c_str());
+        return 1;
+    }
     return 0;
 }
 
-// 备选的批量处理版本 - 如果你想使用批量网络请求
-/*
-int main_batch_version() {
-    GetConfig get_config("config.txt");
-    CONFIG = get_config.Get();
-
-    std::cout << "Starting batch network requests for " << CONFIG.fund_codes.size() << " fund codes..." << std::endl;
-    
-    // 批量获取所有数据
-    const size_t BATCH_SIZE = 10; // 每批处理10个
-    auto data_futures = batch_generate_data_async(CONFIG.fund_codes, BATCH_SIZE);
-    
-    // 收集所有数据
-    std::map<std::string, map<long, double>> all_data;
-    size_t completed = 0;
-    
-    for (auto& future : data_futures) {
-        auto [fund_code, net_worth_data] = future.get();
-        all_data[fund_code] = std::move(net_worth_data);
-        ++completed;
-        
-        if (completed % 50 == 0 || completed == data_futures.size()) {
-            std::cout << "Downloaded data for " << completed << "/" << data_futures.size() << " fund codes" << std::endl;
-        }
-    }
-    
-    // 现在处理所有数据
-    std::cout << "Processing downloaded data..." << std::endl;
-    std::vector<std::future<void>> processing_futures;
-    
-    for (const auto& [fund_code, net_worth_data] : all_data) {
-        if (net_worth_data.empty()) {
-            cerr << "No data found for fund code: " << fund_code << endl;
-            continue;
+int run_command(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "query") {
+        return run_query_command(argv[0], argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "generate") {
+        return run_generate_command(argv[0], argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "snapshot") {
+        string path = argc > 2 ? argv[2] : CONFIG.snapshot_path;
+        if (path.empty() || argc > 3) {
+            print_usage(argv[0]);
+            return 2;
         }
-        
-        auto future = std::async(std::launch::async, [fund_code, &net_worth_data]() {
-            if (CONFIG.periods.empty()) {
-                cerr << "No periods specified in the configuration." << endl;
-                return;
+        if (CONFIG.price_db_path.empty()) {
+            CONFIG.price_db_path = CONFIG.db_path;
+        }
+        return build_snapshot(path) ? 0 : 1;
+    }
+    if (argc > 1 && string(argv[1]) == "serve") {
+        int port = CONFIG.server_port;
+        if (argc == 4 && string(argv[2]) == "--port") {
+            if (!parse_number(argv[3], port) || port <= 0 || port > 65535) {
+                print_usage(argv[0]);
+                return 2;
             }
+        } else if (argc != 2) {
+            print_usage(argv[0]);
+            return 2;
+        }
+        if (CONFIG.price_db_path.empty()) {
+            CONFIG.price_db_path = CONFIG.db_path;
+        }
+        return run_server(port);
+    }
+    CommandLine args;
+    if (!parse_command_line(argc, argv, args)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    // 分片工作进程的结果库由 --db 指定，净值缓存和结果缓存仍使用配置中的库
+    if (CONFIG.price_db_path.empty()) {
+        CONFIG.price_db_path = CONFIG.db_path;
+    }
+    RESULT_CACHE_DB_PATH = CONFIG.db_path;
+    // 结果缓存登记在结果库中，列式结果不经过结果库
+    if (CONFIG.result_sink == "columnar") {
+        CONFIG.result_cache = false;
+    }
+    if (!args.db_path.empty()) {
+        CONFIG.db_path = args.db_path;
+        CONFIG.columnar_path = shard_columnar_path(args.db_path);
+    }
+    if (!args.merge_files.empty()) {
+        return merge_shards(args.merge_files) ? 0 : 1;
+    }
+    if (!args.alloc_path.empty()) {
+        // 每块内存都要带上记录阶段的头，只能从进程启动时开始跟踪
+        if (!AllocTracker::tracking()) {
+            AllocTracker::restart_with_tracking(argv);
+            LOG_ERROR("Cannot restart with %s=1 for allocation tracking", ALLOC_TRACK_ENV);
+            return 1;
+        }
+        ALLOC_PATH = args.alloc_path;
+    }
+    if (!args.trace_path.empty()) {
+        TRACE_PATH = args.trace_path;
+        Tracer::instance().start();
+        TRACE_THREAD_NAME("main");
+    }
+    if (!args.perf_path.empty()) {
+        PERF_PATH = args.perf_path;
+        PerfProfile::instance().start();
+    }
+    if (CONFIG.periods.empty()) {
+        LOG_ERROR("No periods specified in the configuration.");
+        return 1;
+    }
 
-            for (const auto& period : CONFIG.periods) {
-                auto start_date_it = get_start_date(net_worth_data, period);
-                calculate_profit(fund_code, period, net_worth_data);
+    // 协调者：按上次运行记录的序列长度分片，启动工作进程，最后合并各分片结果库
+    size_t shard_count = std::max(args.workers, args.plan_shards);
+    if (shard_count > 0) {
+        std::filesystem::create_directories(args.shard_dir);
+        string plan_path = args.shard_dir + "/plan.txt";
+        ShardPlan plan;
+        int run_id = 0;
+        {
+            DatabaseStorage db_storage(CONFIG.db_path);
+            plan = plan_shards(CONFIG.fund_codes, db_storage.seriesLengths(), shard_count);
+            run_id = db_storage.beginRun(describe_parameters());
+        }
+        if (!write_shard_plan(plan_path, plan, run_id)) {
+            return 1;
+        }
+        if (args.workers == 0) {
+            LOG_INFO("Shard plan written to %s", plan_path.c_str());
+            return 0;
+        }
+        size_t failures = run_shard_workers(plan_path, args.shard_dir, shard_count, TRACE_PATH, PERF_PATH, ALLOC_PATH);
+        for (size_t shard = 0; shard < shard_count; ++shard) {
+            if (!TRACE_PATH.empty()) {
+                TRACE_MERGE_FILES.push_back(shard_trace_path(TRACE_PATH, shard));
             }
-        });
-        
-        processing_futures.push_back(std::move(future));
+            if (!PERF_PATH.empty()) {
+                PERF_MERGE_FILES.push_back(shard_trace_path(PERF_PATH, shard));
+            }
+            if (!ALLOC_PATH.empty()) {
+                ALLOC_MERGE_FILES.push_back(shard_trace_path(ALLOC_PATH, shard));
+            }
+        }
+        vector<string> shard_files;
+        for (size_t shard = 0; shard < shard_count; ++shard) {
+            string shard_db = shard_db_path(args.shard_dir, shard);
+            if (std::filesystem::exists(shard_db)) {
+                shard_files.push_back(shard_db);
+            }
+            if (CONFIG.result_sink == "columnar" && std::filesystem::exists(shard_columnar_path(shard_db))) {
+                shard_files.push_back(shard_columnar_path(shard_db));
+            }
+        }
+        bool merged = merge_shards(shard_files);
+        refresh_snapshot();
+        return failures == 0 && merged ? 0 : 1;
     }
-    
-    // 等待所有处理任务完成
-    for (auto& future : processing_futures) {
-        future.get();
+
+    // 工作进程：只处理自己的分片
+    if (args.shard_count > 0) {
+        // 没有计划文件时只按基金列表等权分片：各节点的 TB_SERIES 不同，按序列长度分会得到不同的计划
+        int run_id = args.run_id;
+        auto plan = args.plan_path.empty()
+            ? plan_shards(CONFIG.fund_codes, {}, args.shard_count)
+            : read_shard_plan(args.plan_path, &run_id);
+        if (run_id <= 0) {
+            LOG_ERROR("--shard needs --run ID (or a --plan file) so that all nodes record the same run");
+            return 2;
+        }
+        if (plan.size() != args.shard_count) {
+            LOG_ERROR("Shard plan has %zu shards, expected %zu", plan.size(), args.shard_count);
+            return 1;
+        }
+        // 各工作进程在自己的套接字和端口上发布进度
+        if (!CONFIG.progress_socket.empty()) {
+            CONFIG.progress_socket += "." + std::to_string(args.shard_index);
+        }
+        if (CONFIG.progress_port > 0) {
+            CONFIG.progress_port += 1 + static_cast<int>(args.shard_index);
+        }
+        return run_batch(plan[args.shard_index], run_id);
     }
-    
-    std::cout << "All fund codes processed successfully!" << std::endl;
-    return 0;
+    int exit_code = run_batch(CONFIG.fund_codes);
+    refresh_snapshot();
+    return exit_code;
 }
-*/
-// 编译命令：g++ -g -o fund main.cpp GetConfig.cpp CppSQLite/DataBaseStorage.cpp CppSQLite/CppSQLite3.cpp -lcurl -lsqlite3 -std=c++17
\ No newline at end of file
+
+int main(int argc, char* argv[]) {
+    GetConfig get_config("config.txt");
+    CONFIG = get_config.Get();
+    Logger::instance().set_level(parse_log_level(CONFIG.log_level));
+
+    int exit_code = run_command(argc, argv);
+    if (!TRACE_PATH.empty() && !Tracer::instance().write(TRACE_PATH, TRACE_MERGE_FILES)) {
+        exit_code = exit_code == 0 ? 1 : exit_code;
+    }
+    if (!PERF_PATH.empty() && !PerfProfile::instance().write(PERF_PATH, PERF_MERGE_FILES)) {
+        exit_code = exit_code == 0 ? 1 : exit_code;
+    }
+    if (!ALLOC_PATH.empty() && !AllocTracker::write(ALLOC_PATH, ALLOC_MERGE_FILES)) {
+        exit_code = exit_code == 0 ? 1 : exit_code;
+    }
+    Logger::instance().shutdown();
+    return exit_code;
+}
+
+// 编译命令：g++ -g -o fund main.cpp GetConfig.cpp FundData.cpp GridEngine.cpp ThreadPool.cpp Logger.cpp ReportWriter.cpp ColumnStore.cpp SeriesCodec.cpp ResultCache.cpp UniverseSnapshot.cpp HttpReactor.cpp HttpServer.cpp BacktestService.cpp Downsample.cpp RunProgress.cpp WorthTrend.cpp SyntheticSeries.cpp Trace.cpp PerfCounters.cpp AllocTracker.cpp ShardRunner.cpp CppSQLite/DataBaseStorage.cpp CppSQLite/ResultWriter.cpp CppSQLite/ResultQuery.cpp CppSQLite/CppSQLite3.cpp -lcurl -lsqlite3 -lpthread -std=c++20
+// 加 -DFUND_NO_TRACE 编译时去掉全部跟踪点（--trace 仍可使用，但时间线为空）
@@ -1,22 +1,44 @@
 import React, { useState } from "react";
 import "./style.css";
 
-function parseFundData(jsText) {
-  const start = jsText.indexOf("var Data_netWorthTrend = ");
-  if (start === -1) return null;
-  const jsonStart = jsText.indexOf("[", start);
-  const jsonEnd = jsText.indexOf("];", jsonStart);
-  if (jsonStart === -1 || jsonEnd === -1) return null;
-  const jsonStr = jsText.substring(jsonStart, jsonEnd + 1);
-  try {
-    return JSON.parse(jsonStr).map(item => ({
-      timestamp: item.x / 1000,
-      price: item.y,
-    }));
-  } catch (e) {
-    console.error("JSON parse error", e);
-    return null;
+// 回测由 C++ 引擎的 fund serve 计算，与批量运行使用同一份逻辑
+const BACKTEST_URL = import.meta.env.VITE_BACKTEST_URL ?? "http://127.0.0.1:8080";
+
+const PERIODS = [
+  ["0", "近 3 个月"],
+  ["1", "近 6 个月"],
+  ["2", "近 1 年"],
+  ["3", "近 3 年"],
+  ["4", "近 5 年"],
+  ["5", "成立以来"],
+  ["6", "成立到 2024.9.20"],
+];
+
+function formatReport(result) {
+  const { parameters, summary } = result;
+  let text =
+    `${result.fund_code}  ${result.start_date} ~ ${result.end_date}\n` +
+    `SUM: ${parameters.sum}, Amount: ${parameters.amount}, Grid Size: ${parameters.grid_size}\n` +
+    `Holdings Value: ${summary.holdings_value.toFixed(2)} (holds ${summary.holdings.toFixed(2)} at price ${summary.latest_price})\n` +
+    `Balance: ${summary.balance.toFixed(2)}  Total Value: ${summary.total_value.toFixed(2)}\n` +
+    `Total Profit: ${summary.profit.toFixed(2)}\n` +
+    `Touched Lowest Balance: ${summary.touched_lowest_balance.toFixed(2)}\n` +
+    `Trades: ${summary.sold} completed, ${summary.open} open, ${summary.not_enough_money} not enough money\n` +
+    `============================ Trades ============================\n`;
+  for (const trade of result.trades ?? []) {
+    if (trade.status === "not_enough_money") {
+      text += `Not enough money to buy\n`;
+    }
+    text += `Buy: ${trade.buy_date} at ${trade.buy_price}\n`;
+    if (trade.sell_date) {
+      text += `Sell: ${trade.sell_date} at ${trade.sell_price}\n`;
+    }
+    if (trade.grid === "big") {
+      text += `Big Grid Size Operation\n`;
+    }
+    text += `----------------------------------------------------------\n`;
   }
+  return text;
 }
 
 function App() {
@@ -24,67 +46,22 @@ function App() {
   const [gridSize, setGridSize] = useState(0.05);
   const [sum, setSum] = useState(10000);
   const [amount, setAmount] = useState(1000);
+  const [period, setPeriod] = useState("5");
   const [report, setReport] = useState("");
 
   const runGridStrategy = async () => {
-    const proxyUrl = "https://cors-anywhere.herokuapp.com/";
-    const url = `https://fund.eastmoney.com/pingzhongdata/${fundCode}.js`;
-    const res = await fetch(proxyUrl+url);
-    const jsText = await res.text();
-    const netWorthData = parseFundData(jsText);
-    if (!netWorthData) {
-      setReport("无法获取或解析基金数据");
-      return;
-    }
-
-    let currentBalance = sum;
-    let currentHoldings = 0;
-    let totalProfit = 0;
-    let currentBasePrice = netWorthData[0].price;
-    const operations = [];
-    const transacted = [];
-    const BASE = 1;
-
-    for (const { timestamp, price } of netWorthData) {
-      if (price <= currentBasePrice * (BASE - gridSize)) {
-        if (currentBalance < amount) continue;
-        operations.push({ buy_timestamp: timestamp, buy_price: price });
-        currentHoldings += amount / price;
-        currentBalance -= amount;
-        currentBasePrice = price;
-      } else if (price >= currentBasePrice * (BASE + gridSize)) {
-        while (operations.length) {
-          const op = operations[operations.length - 1];
-          if (price < op.buy_price * (BASE + gridSize)) break;
-          operations.pop();
-          const sellAmount = (amount / op.buy_price) * price;
-          totalProfit += sellAmount - amount;
-          currentBalance += sellAmount;
-          currentHoldings -= amount / op.buy_price;
-          transacted.push({ ...op, sell_timestamp: timestamp, sell_price: price });
-        }
-        currentBasePrice = price;
-      }
-    }
-
-    const latestPrice = netWorthData[netWorthData.length - 1].price;
-    const holdingsValue = currentHoldings * latestPrice;
-    let profitString =
-      `SUM: ${sum}, Amount: ${amount}, Grid Size: ${gridSize}\n` +
-      `Holdings Value: ${holdingsValue.toFixed(2)} (holds ${currentHoldings.toFixed(2)} at price ${latestPrice})\n` +
-      `Balance: ${currentBalance.toFixed(2)}\n` +
-      `Total Profit: ${totalProfit.toFixed(2)}\n` +
-      `Trades: ${transacted.length} completed, ${operations.length} open\n` +
-      `============================ Trades ============================\n`;
-    const allOps = [...operations, ...transacted].sort((a, b) => a.buy_timestamp - b.buy_timestamp);
-    for (const op of allOps) {
-      profitString += `Buy: ${new Date(op.buy_timestamp * 1000).toLocaleDateString()} at ${op.buy_price}\n`;
-      if (op.sell_timestamp) {
-        profitString += `Sell: ${new Date(op.sell_timestamp * 1000).toLocaleDateString()} at ${op.sell_price}\n`;
-      }
-      profitString += `----------------------------------------------------------\n`;
+    try {
+      const res = await fetch(`${BACKTEST_URL}/backtest`, {
+        method: "POST",
+        headers: { "Content-Type": "application/json" },
+        body: JSON.stringify({ fund_code: fundCode, period, grid_size: gridSize, sum, amount }),
+      });
+      const result = await res.json();
+      setReport(res.ok ? formatReport(result) : `回测失败：${result.error}`);
+    } catch (e) {
+      console.error("backtest request failed", e);
+      setReport(`无法连接回测服务 ${BACKTEST_URL}（先运行 fund serve）`);
     }
-    setReport(profitString);
   };
 
   return (
@@ -96,6 +73,11 @@ function App() {
         onChange={e => setFundCode(e.target.value)}
         className="input"
       />
+      <select value={period} onChange={e => setPeriod(e.target.value)} className="input">
+        {PERIODS.map(([value, label]) => (
+          <option key={value} value={value}>{label}</option>
+        ))}
+      </select>
       <div className="grid-two-cols">
         <input
           type="number"